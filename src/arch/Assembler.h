@@ -0,0 +1,414 @@
+// src/arch/Assembler.h
+#pragma once
+
+#include "Instruction.h"
+#include "../sim/Log.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+// Text form of kernels, in the syntax Instruction::toString() produces:
+//
+//     LOAD R0, Mem[0]
+//     LOAD R1, Mem[100]
+//     ADD R2, R0, R1      ; comments start with ';', '#' or '//'
+//     STORE Mem[200], R2
+//     HALT
+//
+// One instruction per line; blank lines are ignored. Opcodes and the R/P/Mem
+// prefixes are case-insensitive, and operands are separated by commas.
+//
+// Control flow uses predicates, branch targets and labels:
+//
+//     MOVI R0, 0
+//     MOVI R1, 1
+//     MOVI R2, 4
+//   loop:
+//     ADD R0, R0, R1
+//     SETP.LT P0, R0, R2
+//     @P0 BRA loop        ; '@!P0' branches when P0 is false
+//     HALT
+//
+// A branch target is a label or an instruction index. A label names the
+// next instruction and may share its line.
+//
+// Shared memory is addressed per thread in the block, optionally offset by a
+// register:
+//
+//     STS Shared[0], R0        ; Shared[thread in block] = R0
+//     BAR                      ; wait for the block's other warps
+//     LDS R1, Shared[1 + R2]   ; R1 = Shared[1 + thread in block + R2]
+//
+// Atomics address global memory without the thread ID, so lanes can share a
+// word; the destination receives the old value and may be left out:
+//
+//     ATOM.ADD Mem[64 + R0], R1     ; Mem[64 + R0] += R1
+//     ATOM.MAX R2, Mem[8], R1       ; R2 = Mem[8]; Mem[8] = max(Mem[8], R1)
+//     ATOM.CAS R2, Mem[8], R3       ; if Mem[8] == R2: Mem[8] = R3; R2 = old
+class KernelAssembler {
+private:
+    struct PendingBranch {
+        size_t index;
+        std::string label;
+        int line_number;
+    };
+
+    struct Context {
+        std::unordered_map<std::string, int> labels;
+        std::vector<PendingBranch> branches;
+    };
+
+    static bool isIdentifier(const std::string& text) {
+        if (text.empty() || std::isdigit(static_cast<unsigned char>(text[0]))) {
+            return false;
+        }
+        for (char c : text) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static std::string trim(const std::string& text) {
+        size_t begin = 0;
+        size_t end = text.size();
+        while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) {
+            ++begin;
+        }
+        while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+            --end;
+        }
+        return text.substr(begin, end - begin);
+    }
+
+    static std::string upper(std::string text) {
+        for (char& c : text) {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        return text;
+    }
+
+    static bool parseInt(const std::string& text, int& value) {
+        if (text.empty()) {
+            return false;
+        }
+        errno = 0;
+        char* end = nullptr;
+        long parsed = std::strtol(text.c_str(), &end, 10);
+        if (errno != 0 || *end != '\0' || parsed < INT_MIN || parsed > INT_MAX) {
+            return false;
+        }
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    // "R<n>"
+    static bool parseRegister(const std::string& operand, int& reg) {
+        return operand.size() > 1 && std::toupper(static_cast<unsigned char>(operand[0])) == 'R'
+            && parseInt(operand.substr(1), reg);
+    }
+
+    // "P<n>"
+    static bool parsePredicate(const std::string& operand, int& pred) {
+        return operand.size() > 1 && std::toupper(static_cast<unsigned char>(operand[0])) == 'P'
+            && parseInt(operand.substr(1), pred) && pred >= 0 && pred < kNumPredicateRegisters;
+    }
+
+    static bool parseCompare(const std::string& suffix, CompareOp& compare) {
+        static const CompareOp kCompares[] = {CompareOp::EQ, CompareOp::NE, CompareOp::LT,
+                                              CompareOp::LE, CompareOp::GT, CompareOp::GE};
+        for (CompareOp candidate : kCompares) {
+            if (suffix == compareOpToString(candidate)) {
+                compare = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool parseAtomic(const std::string& suffix, AtomicOp& atomic_op) {
+        static const AtomicOp kAtomics[] = {AtomicOp::ADD, AtomicOp::MAX, AtomicOp::CAS};
+        for (AtomicOp candidate : kAtomics) {
+            if (suffix == atomicOpToString(candidate)) {
+                atomic_op = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // "Mem[<n>]"
+    static bool parseMemory(const std::string& operand, int& address) {
+        std::string prefix = upper(operand.substr(0, 4));
+        if (prefix != "MEM[" || operand.back() != ']') {
+            return false;
+        }
+        return parseInt(trim(operand.substr(4, operand.size() - 5)), address);
+    }
+
+    // "<space>[<n>]" or "<space>[<n> + R<m>]" for space "SHARED" or "MEM";
+    // offset_reg is -1 without a register.
+    static bool parseIndexed(const std::string& operand, const std::string& space, int& address, int& offset_reg) {
+        std::string prefix = upper(operand.substr(0, space.size() + 1));
+        if (prefix != space + "[" || operand.back() != ']') {
+            return false;
+        }
+        std::string inner = operand.substr(space.size() + 1, operand.size() - space.size() - 2);
+        size_t plus = inner.find('+');
+        offset_reg = -1;
+        if (plus != std::string::npos && !parseRegister(trim(inner.substr(plus + 1)), offset_reg)) {
+            return false;
+        }
+        return parseInt(trim(inner.substr(0, plus)), address);
+    }
+
+    static size_t commentStart(const std::string& line) {
+        size_t pos = line.find_first_of(";#");
+        size_t slashes = line.find("//");
+        return std::min(pos, slashes);
+    }
+
+    static bool fail(std::string* error, int line_number, const std::string& message) {
+        std::string text = "line " + std::to_string(line_number) + ": " + message;
+        GPU_SIM_LOG(Error, "Error: Kernel assembly failed at " << text);
+        if (error) {
+            *error = text;
+        }
+        return false;
+    }
+
+    static bool parseLine(const std::string& line, int line_number, KernelProgram& program,
+                          Context& context, std::string* error) {
+        std::string code = trim(line.substr(0, commentStart(line)));
+        size_t colon = code.find(':');
+        if (colon != std::string::npos) {
+            std::string label = trim(code.substr(0, colon));
+            if (!isIdentifier(label)) {
+                return fail(error, line_number, "invalid label '" + label + "'");
+            }
+            if (!context.labels.emplace(label, static_cast<int>(program.size())).second) {
+                return fail(error, line_number, "duplicate label '" + label + "'");
+            }
+            code = trim(code.substr(colon + 1));
+        }
+        if (code.empty()) {
+            return true;
+        }
+
+        // "@P<n>" / "@!P<n>" guard.
+        int guard = -1;
+        bool guard_negate = false;
+        if (code[0] == '@') {
+            size_t end = 1;
+            while (end < code.size() && !std::isspace(static_cast<unsigned char>(code[end]))) {
+                ++end;
+            }
+            std::string predicate = code.substr(1, end - 1);
+            guard_negate = !predicate.empty() && predicate[0] == '!';
+            if (!parsePredicate(guard_negate ? predicate.substr(1) : predicate, guard)) {
+                return fail(error, line_number, "expected a guard predicate, got '@" + predicate + "'");
+            }
+            code = trim(code.substr(end));
+        }
+
+        size_t split = 0;
+        while (split < code.size() && !std::isspace(static_cast<unsigned char>(code[split]))) {
+            ++split;
+        }
+        std::string mnemonic = upper(code.substr(0, split));
+        std::vector<std::string> operands;
+        std::string rest = trim(code.substr(split));
+        if (!rest.empty()) {
+            std::stringstream stream(rest);
+            std::string operand;
+            while (std::getline(stream, operand, ',')) {
+                operands.push_back(trim(operand));
+            }
+            if (rest.back() == ',') {
+                operands.push_back("");
+            }
+        }
+
+        auto expectOperands = [&](size_t count) {
+            if (operands.size() != count) {
+                return fail(error, line_number, mnemonic + " expects " + std::to_string(count)
+                            + " operand(s), got " + std::to_string(operands.size()));
+            }
+            return true;
+        };
+        auto badOperand = [&](const std::string& operand, const char* expected) {
+            return fail(error, line_number, "expected " + std::string(expected) + ", got '" + operand + "'");
+        };
+
+        int dest = -1;
+        int src1 = -1;
+        int src2 = -1;
+        int address = -1;
+        if (guard >= 0 && mnemonic != "BRA") {
+            return fail(error, line_number, "only BRA can be guarded by a predicate");
+        }
+        if (mnemonic == "ADD" || mnemonic == "MUL") {
+            if (!expectOperands(3)) {
+                return false;
+            }
+            if (!parseRegister(operands[0], dest)) return badOperand(operands[0], "a register");
+            if (!parseRegister(operands[1], src1)) return badOperand(operands[1], "a register");
+            if (!parseRegister(operands[2], src2)) return badOperand(operands[2], "a register");
+            program.emplace_back(mnemonic == "ADD" ? OpCode::ADD : OpCode::MUL, dest, src1, src2);
+        } else if (mnemonic == "LOAD") {
+            if (!expectOperands(2)) {
+                return false;
+            }
+            if (!parseRegister(operands[0], dest)) return badOperand(operands[0], "a register");
+            if (!parseMemory(operands[1], address)) return badOperand(operands[1], "Mem[address]");
+            program.emplace_back(OpCode::LOAD, dest, -1, -1, address);
+        } else if (mnemonic == "STORE") {
+            if (!expectOperands(2)) {
+                return false;
+            }
+            if (!parseMemory(operands[0], address)) return badOperand(operands[0], "Mem[address]");
+            if (!parseRegister(operands[1], src1)) return badOperand(operands[1], "a register");
+            program.emplace_back(OpCode::STORE, -1, src1, -1, address);
+        } else if (mnemonic == "LDS") {
+            if (!expectOperands(2)) {
+                return false;
+            }
+            if (!parseRegister(operands[0], dest)) return badOperand(operands[0], "a register");
+            if (!parseIndexed(operands[1], "SHARED", address, src1)) return badOperand(operands[1], "Shared[address]");
+            program.push_back(Instruction::loadShared(dest, address, src1));
+        } else if (mnemonic == "STS") {
+            if (!expectOperands(2)) {
+                return false;
+            }
+            if (!parseIndexed(operands[0], "SHARED", address, src2)) return badOperand(operands[0], "Shared[address]");
+            if (!parseRegister(operands[1], src1)) return badOperand(operands[1], "a register");
+            program.push_back(Instruction::storeShared(address, src1, src2));
+        } else if (mnemonic == "BAR") {
+            if (!expectOperands(0)) {
+                return false;
+            }
+            program.emplace_back(OpCode::BAR);
+        } else if (mnemonic == "HALT") {
+            if (!expectOperands(0)) {
+                return false;
+            }
+            program.emplace_back(OpCode::HALT);
+        } else if (mnemonic == "MOVI") {
+            int value = 0;
+            if (!expectOperands(2)) {
+                return false;
+            }
+            if (!parseRegister(operands[0], dest)) return badOperand(operands[0], "a register");
+            if (!parseInt(operands[1], value)) return badOperand(operands[1], "an integer");
+            program.push_back(Instruction::movi(dest, value));
+        } else if (mnemonic.compare(0, 5, "SETP.") == 0) {
+            CompareOp compare = CompareOp::EQ;
+            if (!parseCompare(mnemonic.substr(5), compare)) {
+                return fail(error, line_number, "unknown comparison '" + mnemonic.substr(5) + "'");
+            }
+            if (!expectOperands(3)) {
+                return false;
+            }
+            if (!parsePredicate(operands[0], dest)) return badOperand(operands[0], "a predicate P0-P3");
+            if (!parseRegister(operands[1], src1)) return badOperand(operands[1], "a register");
+            if (!parseRegister(operands[2], src2)) return badOperand(operands[2], "a register");
+            program.push_back(Instruction::setp(compare, dest, src1, src2));
+        } else if (mnemonic.compare(0, 5, "ATOM.") == 0) {
+            AtomicOp atomic_op = AtomicOp::ADD;
+            if (!parseAtomic(mnemonic.substr(5), atomic_op)) {
+                return fail(error, line_number, "unknown atomic operation '" + mnemonic.substr(5) + "'");
+            }
+            if (operands.size() != 2 && !expectOperands(3)) {
+                return false;
+            }
+            size_t next = 0;
+            if (operands.size() == 3 && !parseRegister(operands[next++], dest)) {
+                return badOperand(operands[0], "a register");
+            }
+            if (!parseIndexed(operands[next], "MEM", address, src2)) return badOperand(operands[next], "Mem[address]");
+            if (!parseRegister(operands[next + 1], src1)) return badOperand(operands[next + 1], "a register");
+            program.push_back(Instruction::atomic(atomic_op, dest, address, src1, src2));
+        } else if (mnemonic == "BRA") {
+            int target = 0;
+            if (!expectOperands(1)) {
+                return false;
+            }
+            if (!parseInt(operands[0], target)) {
+                if (!isIdentifier(operands[0])) return badOperand(operands[0], "a label or instruction index");
+                context.branches.push_back({program.size(), operands[0], line_number});
+            }
+            program.push_back(Instruction::branch(target, guard, guard_negate));
+        } else {
+            return fail(error, line_number, "unknown opcode '" + mnemonic + "'");
+        }
+        return true;
+    }
+
+public:
+    // Parses source into program (replacing its contents). On failure the
+    // first error is logged and stored in *error, and program is left empty.
+    static bool assemble(const std::string& source, KernelProgram& program, std::string* error = nullptr) {
+        program.clear();
+        Context context;
+        std::stringstream stream(source);
+        std::string line;
+        int line_number = 0;
+        while (std::getline(stream, line)) {
+            ++line_number;
+            if (!parseLine(line, line_number, program, context, error)) {
+                program.clear();
+                return false;
+            }
+        }
+        for (const PendingBranch& branch : context.branches) {
+            auto it = context.labels.find(branch.label);
+            if (it == context.labels.end()) {
+                program.clear();
+                return fail(error, branch.line_number, "undefined label '" + branch.label + "'");
+            }
+            program[branch.index].immediate = it->second;
+        }
+        return true;
+    }
+
+    static bool readSource(const std::string& path, std::string& source) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            GPU_SIM_LOG(Error, "Error: Could not open kernel source " << path << ".");
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        source = buffer.str();
+        return true;
+    }
+
+    static bool assembleFile(const std::string& path, KernelProgram& program, std::string* error = nullptr) {
+        std::string source;
+        if (!readSource(path, source)) {
+            if (error) {
+                *error = "could not open " + path;
+            }
+            return false;
+        }
+        return assemble(source, program, error);
+    }
+
+    // The inverse of assemble(): one toString() line per instruction.
+    static std::string disassemble(const KernelProgram& program) {
+        std::string text;
+        for (const Instruction& instr : program) {
+            text += instr.toString();
+            text += '\n';
+        }
+        return text;
+    }
+};
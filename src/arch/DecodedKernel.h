@@ -0,0 +1,552 @@
+// src/arch/DecodedKernel.h
+#pragma once
+
+#include "Instruction.h"
+#include "../sim/Log.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+// Operations of the decoded form. Faulty instructions are rewritten when the
+// kernel is decoded, so the interpreter never has to check operands:
+// an ADD/MUL/MOVI/SETP/LDS with an invalid destination becomes Nop, a LOAD
+// with an invalid destination becomes LoadDiscard (it still performs the
+// memory reads), an ATOM with one discards the old values (kAtomicDiscard),
+// and branches with an invalid target or predicate as well as unknown
+// opcodes become Nop. The order matches Warp's handler table.
+//
+// The ops after Atomic are superinstructions that only appear in a kernel's
+// fused code (see DecodedKernel::fusedData()).
+enum class DecodedOp : uint8_t {
+    Add,
+    Mul,
+    Load,
+    LoadDiscard,
+    Store,
+    Halt,
+    Nop,
+    Movi,
+    SetP,
+    Bra,
+    BraPred,
+    LoadShared,
+    StoreShared,
+    Barrier,
+    Atomic,
+    LoadLoadAddStore,   // LOAD a; LOAD b; ADD d, a, b; STORE d
+    LoadLoadMulStore,   // LOAD a; LOAD b; MUL d, a, b; STORE d
+    AddStore,           // ADD d, x, y; STORE d
+    MulStore            // MUL d, x, y; STORE d
+};
+
+constexpr size_t kNumDecodedOps = 19;
+
+// Ops a decoded instruction outside the fused code can have.
+constexpr size_t kNumUnfusedDecodedOps = 15;
+
+// DecodedInstruction::modifier bits of BraPred.
+constexpr uint8_t kBranchNegate = 1;
+
+// DecodedInstruction::modifier of Atomic: the AtomicOp in the low bits, and
+// kAtomicDiscard when the old values are not written to a register.
+constexpr uint8_t kAtomicOpMask = 0x0F;
+constexpr uint8_t kAtomicDiscard = 0x80;
+
+// DecodedInstruction::modifier bits of a superinstruction: the registers it
+// has to write because they are read after the fused sequence. The others
+// are overwritten first, so their values never leave the lane loop.
+constexpr uint8_t kFusedWriteFirst = 1;     // The first LOAD's destination.
+constexpr uint8_t kFusedWriteSecond = 2;    // The second LOAD's destination.
+constexpr uint8_t kFusedWriteResult = 4;    // The ADD/MUL destination.
+
+// One instruction with register operands already resolved to register file
+// rows: every index is below the register count, and invalid source registers
+// point at the all-zero row (index == register count). SETP's dest and
+// BraPred's src1 are predicate register indices; MOVI's value and a branch
+// target are kept in mem_address, SETP's CompareOp in modifier. The offset
+// register of LoadShared (src1), StoreShared (src2) and Atomic (src2) is the
+// all-zero row when the instruction has none. Atomic's dest is also CAS's
+// compare value, and the all-zero row with kAtomicDiscard.
+struct DecodedInstruction {
+    DecodedOp op;
+    uint8_t modifier;
+    uint16_t dest;
+    uint16_t src1;
+    uint16_t src2;
+    int32_t mem_address;
+
+    bool isMemoryAccess() const {
+        return op == DecodedOp::Load || op == DecodedOp::LoadDiscard || op == DecodedOp::Store;
+    }
+
+    bool isLoad() const {
+        return op == DecodedOp::Load || op == DecodedOp::LoadDiscard;
+    }
+
+    bool isBranch() const {
+        return op == DecodedOp::Bra || op == DecodedOp::BraPred;
+    }
+
+    bool isSharedAccess() const {
+        return op == DecodedOp::LoadShared || op == DecodedOp::StoreShared;
+    }
+
+    bool isAtomic() const {
+        return op == DecodedOp::Atomic;
+    }
+};
+
+// A KernelProgram validated and decoded once, at launch, for warps with
+// num_registers registers per thread. The source program is kept for
+// disassembly in traces and reports.
+//
+// Decoding also computes each instruction's immediate post-dominator, the
+// point where lanes that diverge at a conditional branch there reconverge.
+//
+// A peephole pass then builds the fused code: a copy of the code in which the
+// first instruction of each LOAD/LOAD/ADD|MUL/STORE or ADD|MUL/STORE sequence
+// is replaced by a superinstruction that reads its operands from the
+// instructions it covers. Those keep their places, so branch targets and PCs
+// are unchanged. Warp::run() executes the fused code; step(), which the
+// cycle-level ShaderCore uses, issues the original instructions one by one.
+class DecodedKernel {
+private:
+    KernelProgram source;
+    std::vector<DecodedInstruction> code;
+    std::vector<DecodedInstruction> fused_code;
+    std::vector<int> reconvergence_pc;
+    int num_registers;
+    size_t num_rewritten;
+    size_t num_fused;
+
+    // Immediate post-dominators over the instruction-level CFG, using the
+    // Cooper-Harvey-Kennedy iterative algorithm on the reversed graph rooted
+    // at a virtual exit node (index size()). Instructions that cannot reach
+    // the exit (infinite loops) reconverge at the exit, i.e. never.
+    void computeReconvergence() {
+        const int n = static_cast<int>(code.size());
+        const int exit_node = n;
+        auto successors = [&](int pc, int out[2]) {
+            const DecodedInstruction& instr = code[pc];
+            int count = 0;
+            switch (instr.op) {
+                case DecodedOp::Halt:
+                    out[count++] = exit_node;
+                    break;
+                case DecodedOp::Bra:
+                    out[count++] = std::min(static_cast<int>(instr.mem_address), exit_node);
+                    break;
+                case DecodedOp::BraPred:
+                    out[count++] = std::min(static_cast<int>(instr.mem_address), exit_node);
+                    out[count++] = pc + 1;
+                    break;
+                default:
+                    out[count++] = pc + 1;
+                    break;
+            }
+            return count;
+        };
+
+        std::vector<std::vector<int>> predecessors(n + 1);
+        for (int pc = 0; pc < n; ++pc) {
+            int succ[2];
+            int count = successors(pc, succ);
+            for (int i = 0; i < count; ++i) {
+                predecessors[succ[i]].push_back(pc);
+            }
+        }
+
+        // Postorder of the reversed CFG from the exit node.
+        std::vector<int> postorder_index(n + 1, -1);
+        std::vector<int> postorder;
+        std::vector<char> visited(n + 1, 0);
+        std::vector<std::pair<int, size_t>> stack;
+        stack.emplace_back(exit_node, 0);
+        visited[exit_node] = 1;
+        while (!stack.empty()) {
+            int node = stack.back().first;
+            size_t& next = stack.back().second;
+            if (next < predecessors[node].size()) {
+                int pred = predecessors[node][next++];
+                if (!visited[pred]) {
+                    visited[pred] = 1;
+                    stack.emplace_back(pred, 0);
+                }
+            } else {
+                postorder_index[node] = static_cast<int>(postorder.size());
+                postorder.push_back(node);
+                stack.pop_back();
+            }
+        }
+
+        std::vector<int> ipdom(n + 1, -1);
+        ipdom[exit_node] = exit_node;
+        auto intersect = [&](int a, int b) {
+            while (a != b) {
+                while (postorder_index[a] < postorder_index[b]) {
+                    a = ipdom[a];
+                }
+                while (postorder_index[b] < postorder_index[a]) {
+                    b = ipdom[b];
+                }
+            }
+            return a;
+        };
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto it = postorder.rbegin(); it != postorder.rend(); ++it) {
+                int node = *it;
+                if (node == exit_node) {
+                    continue;
+                }
+                int succ[2];
+                int count = successors(node, succ);
+                int new_ipdom = -1;
+                for (int i = 0; i < count; ++i) {
+                    if (ipdom[succ[i]] == -1) {
+                        continue;
+                    }
+                    new_ipdom = new_ipdom == -1 ? succ[i] : intersect(succ[i], new_ipdom);
+                }
+                if (new_ipdom != ipdom[node]) {
+                    ipdom[node] = new_ipdom;
+                    changed = true;
+                }
+            }
+        }
+
+        reconvergence_pc.assign(n, exit_node);
+        for (int pc = 0; pc < n; ++pc) {
+            if (ipdom[pc] >= 0) {
+                reconvergence_pc[pc] = ipdom[pc];
+            }
+        }
+    }
+
+    static bool readsRegister(const DecodedInstruction& instr, uint16_t reg) {
+        switch (instr.op) {
+            case DecodedOp::Add:
+            case DecodedOp::Mul:
+            case DecodedOp::SetP:
+                return instr.src1 == reg || instr.src2 == reg;
+            case DecodedOp::Store:
+            case DecodedOp::LoadShared:
+                return instr.src1 == reg;
+            case DecodedOp::StoreShared:
+                return instr.src1 == reg || instr.src2 == reg;
+            case DecodedOp::Atomic:
+                return instr.src1 == reg || instr.src2 == reg
+                    || ((instr.modifier & kAtomicOpMask) == static_cast<uint8_t>(AtomicOp::CAS) && instr.dest == reg);
+            default:
+                return false;
+        }
+    }
+
+    static bool writesDest(const DecodedInstruction& instr) {
+        return instr.op == DecodedOp::Add || instr.op == DecodedOp::Mul || instr.op == DecodedOp::Load
+            || instr.op == DecodedOp::Movi || instr.op == DecodedOp::LoadShared
+            || (instr.op == DecodedOp::Atomic && !(instr.modifier & kAtomicDiscard));
+    }
+
+    static bool writesRegister(const DecodedInstruction& instr, uint16_t reg) {
+        return writesDest(instr) && instr.dest == reg;
+    }
+
+    // Whether reg may be read after the instruction at pc. Only the
+    // straight-line code up to the next branch or HALT is examined; a value
+    // that reaches either, or the end of the kernel, is treated as live, so
+    // the register file a warp exits with is the same fused or not.
+    bool isLiveAfter(size_t pc, uint16_t reg) const {
+        for (size_t next = pc + 1; next < code.size(); ++next) {
+            const DecodedInstruction& instr = code[next];
+            if (readsRegister(instr, reg) || instr.isBranch() || instr.op == DecodedOp::Halt) {
+                return true;
+            }
+            if (writesRegister(instr, reg)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool isArithmetic(const DecodedInstruction& instr) {
+        return instr.op == DecodedOp::Add || instr.op == DecodedOp::Mul;
+    }
+
+    void fuseSuperinstructions() {
+        fused_code = code;
+        num_fused = 0;
+        for (size_t pc = 0; pc < code.size(); ++pc) {
+            DecodedInstruction& head = fused_code[pc];
+            if (pc + 3 < code.size() && code[pc].op == DecodedOp::Load && code[pc + 1].op == DecodedOp::Load
+                && isArithmetic(code[pc + 2]) && code[pc + 3].op == DecodedOp::Store) {
+                const uint16_t first = code[pc].dest;
+                const uint16_t second = code[pc + 1].dest;
+                const DecodedInstruction& arithmetic = code[pc + 2];
+                const bool reads_loads = (arithmetic.src1 == first && arithmetic.src2 == second)
+                    || (arithmetic.src1 == second && arithmetic.src2 == first);
+                if (first != second && reads_loads && code[pc + 3].src1 == arithmetic.dest) {
+                    head.op = arithmetic.op == DecodedOp::Add ? DecodedOp::LoadLoadAddStore : DecodedOp::LoadLoadMulStore;
+                    head.modifier = 0;
+                    if (first != arithmetic.dest && isLiveAfter(pc + 3, first)) {
+                        head.modifier |= kFusedWriteFirst;
+                    }
+                    if (second != arithmetic.dest && isLiveAfter(pc + 3, second)) {
+                        head.modifier |= kFusedWriteSecond;
+                    }
+                    if (isLiveAfter(pc + 3, arithmetic.dest)) {
+                        head.modifier |= kFusedWriteResult;
+                    }
+                    num_fused++;
+                    continue;
+                }
+            }
+            if (pc + 1 < code.size() && isArithmetic(code[pc]) && code[pc + 1].op == DecodedOp::Store
+                && code[pc + 1].src1 == code[pc].dest) {
+                head.op = code[pc].op == DecodedOp::Add ? DecodedOp::AddStore : DecodedOp::MulStore;
+                head.modifier = isLiveAfter(pc + 1, code[pc].dest) ? kFusedWriteResult : 0;
+                num_fused++;
+            }
+        }
+        if (num_fused == 0) {
+            fused_code.clear();
+        }
+    }
+
+    static bool isValidRegister(int reg, int num_regs) {
+        return reg >= 0 && reg < num_regs;
+    }
+
+    static uint16_t sourceRow(int reg, int num_regs, bool& valid) {
+        valid = valid && isValidRegister(reg, num_regs);
+        return static_cast<uint16_t>(isValidRegister(reg, num_regs) ? reg : num_regs);
+    }
+
+    // A shared memory offset register; -1 means none and reads the zero row.
+    static uint16_t offsetRow(int reg, int num_regs, bool& valid) {
+        return reg < 0 ? static_cast<uint16_t>(num_regs) : sourceRow(reg, num_regs, valid);
+    }
+
+public:
+    // Register counts above this cannot be encoded in a DecodedInstruction.
+    static constexpr int kMaxRegisters = 0xFFFF;
+
+    DecodedKernel() : num_registers(0), num_rewritten(0), num_fused(0) {}
+
+    // fuse = false skips the peephole pass, so run() executes the original
+    // instructions too.
+    DecodedKernel(const KernelProgram& program, int num_registers_per_thread, bool fuse = true)
+        : source(program), num_registers(num_registers_per_thread), num_rewritten(0), num_fused(0) {
+        if (num_registers < 0 || num_registers > kMaxRegisters) {
+            GPU_SIM_LOG(Error, "Error: Cannot decode a kernel for " << num_registers << " registers per thread.");
+            num_registers = num_registers < 0 ? 0 : kMaxRegisters;
+        }
+        code.reserve(source.size());
+        for (size_t pc = 0; pc < source.size(); ++pc) {
+            bool valid = true;
+            code.push_back(decode(source[pc], num_registers, valid, source.size()));
+            if (!valid) {
+                num_rewritten++;
+                GPU_SIM_LOG(Error, "Error: Kernel instruction " << pc << " (" << source[pc].toString()
+                            << ") has invalid operands for " << num_registers << " registers per thread.");
+            }
+        }
+        computeReconvergence();
+        if (fuse) {
+            fuseSuperinstructions();
+        }
+    }
+
+    // Rebuilds a kernel from an already decoded form (e.g. a cached kernel
+    // binary). Only the operand ranges are checked, which is much cheaper
+    // than decoding; returns false if code does not fit num_registers_per_thread.
+    static bool fromDecoded(KernelProgram program, const DecodedInstruction* decoded, int num_registers_per_thread,
+                            size_t rewritten, DecodedKernel& kernel) {
+        if (num_registers_per_thread < 0 || num_registers_per_thread > kMaxRegisters) {
+            return false;
+        }
+        const uint16_t max_row = static_cast<uint16_t>(num_registers_per_thread);
+        for (size_t pc = 0; pc < program.size(); ++pc) {
+            const DecodedInstruction& instr = decoded[pc];
+            if (static_cast<size_t>(instr.op) >= kNumUnfusedDecodedOps || instr.dest > max_row
+                || instr.src1 > max_row || instr.src2 > max_row
+                || (writesDest(instr) && instr.dest == max_row)
+                || (instr.isAtomic() && (instr.modifier & kAtomicOpMask) > static_cast<uint8_t>(AtomicOp::CAS))
+                || (instr.op == DecodedOp::SetP && (instr.dest >= kNumPredicateRegisters
+                                                    || instr.modifier > static_cast<uint8_t>(CompareOp::GE)))
+                || (instr.op == DecodedOp::BraPred && instr.src1 >= kNumPredicateRegisters)
+                || (instr.isBranch() && (instr.mem_address < 0
+                                         || static_cast<size_t>(instr.mem_address) > program.size()))) {
+                return false;
+            }
+        }
+        kernel.code.assign(decoded, decoded + program.size());
+        kernel.source = std::move(program);
+        kernel.num_registers = num_registers_per_thread;
+        kernel.num_rewritten = rewritten;
+        kernel.computeReconvergence();
+        kernel.fuseSuperinstructions();
+        return true;
+    }
+
+    // Decodes a single instruction of a kernel of kernel_size instructions.
+    // valid is cleared if an operand had to be replaced (an invalid source
+    // reads zero; an invalid destination, predicate or branch target turns
+    // the instruction into a Nop).
+    static DecodedInstruction decode(const Instruction& instr, int num_regs, bool& valid, size_t kernel_size) {
+        DecodedInstruction decoded{DecodedOp::Nop, 0, 0, 0, 0, instr.mem_address};
+        const bool valid_dest = isValidRegister(instr.dest_reg, num_regs);
+        switch (instr.opcode) {
+            case OpCode::ADD:
+            case OpCode::MUL:
+                decoded.op = !valid_dest ? DecodedOp::Nop
+                           : instr.opcode == OpCode::ADD ? DecodedOp::Add : DecodedOp::Mul;
+                decoded.dest = static_cast<uint16_t>(valid_dest ? instr.dest_reg : 0);
+                decoded.src1 = sourceRow(instr.src1_reg, num_regs, valid);
+                decoded.src2 = sourceRow(instr.src2_reg, num_regs, valid);
+                valid = valid && valid_dest;
+                break;
+            case OpCode::LOAD:
+                decoded.op = valid_dest ? DecodedOp::Load : DecodedOp::LoadDiscard;
+                decoded.dest = static_cast<uint16_t>(valid_dest ? instr.dest_reg : 0);
+                valid = valid && valid_dest;
+                break;
+            case OpCode::STORE:
+                decoded.op = DecodedOp::Store;
+                decoded.src1 = sourceRow(instr.src1_reg, num_regs, valid);
+                break;
+            case OpCode::HALT:
+                decoded.op = DecodedOp::Halt;
+                break;
+            case OpCode::MOVI:
+                decoded.op = valid_dest ? DecodedOp::Movi : DecodedOp::Nop;
+                decoded.dest = static_cast<uint16_t>(valid_dest ? instr.dest_reg : 0);
+                decoded.mem_address = instr.immediate;
+                valid = valid && valid_dest;
+                break;
+            case OpCode::SETP: {
+                const bool valid_pred = instr.dest_reg >= 0 && instr.dest_reg < kNumPredicateRegisters;
+                decoded.op = valid_pred ? DecodedOp::SetP : DecodedOp::Nop;
+                decoded.modifier = static_cast<uint8_t>(instr.compare);
+                decoded.dest = static_cast<uint16_t>(valid_pred ? instr.dest_reg : 0);
+                decoded.src1 = sourceRow(instr.src1_reg, num_regs, valid);
+                decoded.src2 = sourceRow(instr.src2_reg, num_regs, valid);
+                valid = valid && valid_pred;
+                break;
+            }
+            case OpCode::BRA: {
+                const bool valid_target = instr.immediate >= 0 && static_cast<size_t>(instr.immediate) <= kernel_size;
+                const bool conditional = instr.pred_reg >= 0;
+                const bool valid_pred = !conditional || instr.pred_reg < kNumPredicateRegisters;
+                decoded.mem_address = instr.immediate;
+                if (valid_target && valid_pred) {
+                    decoded.op = conditional ? DecodedOp::BraPred : DecodedOp::Bra;
+                    decoded.src1 = static_cast<uint16_t>(conditional ? instr.pred_reg : 0);
+                    decoded.modifier = conditional && instr.pred_negate ? kBranchNegate : 0;
+                } else {
+                    decoded.mem_address = 0;
+                    valid = false;
+                }
+                break;
+            }
+            case OpCode::LDS:
+                decoded.op = valid_dest ? DecodedOp::LoadShared : DecodedOp::Nop;
+                decoded.dest = static_cast<uint16_t>(valid_dest ? instr.dest_reg : 0);
+                decoded.src1 = offsetRow(instr.src1_reg, num_regs, valid);
+                valid = valid && valid_dest;
+                break;
+            case OpCode::STS:
+                decoded.op = DecodedOp::StoreShared;
+                decoded.src1 = sourceRow(instr.src1_reg, num_regs, valid);
+                decoded.src2 = offsetRow(instr.src2_reg, num_regs, valid);
+                break;
+            case OpCode::BAR:
+                decoded.op = DecodedOp::Barrier;
+                break;
+            case OpCode::ATOM: {
+                const bool valid_op = instr.atomic_op == AtomicOp::ADD || instr.atomic_op == AtomicOp::MAX
+                    || instr.atomic_op == AtomicOp::CAS;
+                decoded.op = valid_op ? DecodedOp::Atomic : DecodedOp::Nop;
+                decoded.modifier = static_cast<uint8_t>(valid_op ? instr.atomic_op : AtomicOp::ADD);
+                if (!valid_dest) {
+                    decoded.modifier |= kAtomicDiscard;
+                }
+                // Leaving out the destination is allowed; a bad one is not.
+                decoded.dest = static_cast<uint16_t>(valid_dest ? instr.dest_reg : num_regs);
+                decoded.src1 = sourceRow(instr.src1_reg, num_regs, valid);
+                decoded.src2 = offsetRow(instr.src2_reg, num_regs, valid);
+                valid = valid && valid_op && (valid_dest || instr.dest_reg == -1);
+                break;
+            }
+            default:
+                valid = false;
+                break;
+        }
+        return decoded;
+    }
+
+    size_t size() const {
+        return code.size();
+    }
+
+    bool empty() const {
+        return code.empty();
+    }
+
+    const DecodedInstruction& operator[](size_t pc) const {
+        return code[pc];
+    }
+
+    const DecodedInstruction* data() const {
+        return code.data();
+    }
+
+    // The code with superinstructions, the same length as data(); the
+    // original code when the kernel was decoded without fusion.
+    const DecodedInstruction* fusedData() const {
+        return fused_code.empty() ? code.data() : fused_code.data();
+    }
+
+    // Superinstructions in the fused code.
+    size_t getNumFused() const {
+        return num_fused;
+    }
+
+    // Where lanes diverging at pc reconverge; size() means at kernel exit.
+    int getReconvergencePC(size_t pc) const {
+        return reconvergence_pc[pc];
+    }
+
+    const Instruction& getSourceInstruction(size_t pc) const {
+        return source[pc];
+    }
+
+    const KernelProgram& getSource() const {
+        return source;
+    }
+
+    int getNumRegisters() const {
+        return num_registers;
+    }
+
+    // Whether blocks running the kernel need shared memory.
+    bool usesSharedMemory() const {
+        return std::any_of(code.begin(), code.end(),
+                           [](const DecodedInstruction& instr) { return instr.isSharedAccess(); });
+    }
+
+    // Whether the kernel has a BAR its block's warps must meet at.
+    bool usesBarriers() const {
+        return std::any_of(code.begin(), code.end(),
+                           [](const DecodedInstruction& instr) { return instr.op == DecodedOp::Barrier; });
+    }
+
+    // Instructions whose operands were replaced during decoding.
+    size_t getNumRewritten() const {
+        return num_rewritten;
+    }
+};
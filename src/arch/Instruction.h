@@ -10,18 +10,124 @@ enum class OpCode {
     MUL,
     LOAD,
     STORE,
-    HALT
+    HALT,
+    MOVI,   // dest_reg = immediate
+    SETP,   // predicate dest_reg = src1_reg <compare> src2_reg
+    BRA,    // jump to immediate, optionally guarded by a predicate
+    LDS,    // dest_reg = Shared[mem_address + thread in block + src1_reg]
+    STS,    // Shared[mem_address + thread in block + src2_reg] = src1_reg
+    BAR,    // wait until every warp of the block has reached a BAR
+    ATOM    // dest_reg = Mem[mem_address + src2_reg], updated with src1_reg (see AtomicOp)
 };
 
+constexpr size_t kNumOpCodes = 12;
+
+// Per-thread 1-bit predicate registers P0 .. P3, written by SETP and read by
+// predicated branches.
+constexpr int kNumPredicateRegisters = 4;
+
+// Signed comparisons available to SETP.
+enum class CompareOp {
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE
+};
+
+inline const char* compareOpToString(CompareOp compare) {
+    switch (compare) {
+        case CompareOp::EQ: return "EQ";
+        case CompareOp::NE: return "NE";
+        case CompareOp::LT: return "LT";
+        case CompareOp::LE: return "LE";
+        case CompareOp::GT: return "GT";
+        case CompareOp::GE: return "GE";
+        default:            return "UNKNOWN_COMPARE";
+    }
+}
+
+// Read-modify-write operations of ATOM. Each lane's update of its word is
+// indivisible and returns the word's previous value. CAS stores the value
+// only if the word equals the destination register's current value, like
+// x86 CMPXCHG.
+enum class AtomicOp {
+    ADD,
+    MAX,
+    CAS
+};
+
+inline const char* atomicOpToString(AtomicOp atomic) {
+    switch (atomic) {
+        case AtomicOp::ADD: return "ADD";
+        case AtomicOp::MAX: return "MAX";
+        case AtomicOp::CAS: return "CAS";
+        default:            return "UNKNOWN_ATOMIC";
+    }
+}
+
 struct Instruction {
     OpCode opcode;
     int dest_reg;
     int src1_reg;
     int src2_reg;
     int mem_address;
+    int immediate;        // MOVI: the value; BRA: the target instruction index.
+    int pred_reg;         // BRA guard predicate, -1 for an unconditional branch.
+    bool pred_negate;     // Branch when the guard predicate is false.
+    CompareOp compare;    // SETP comparison.
+    AtomicOp atomic_op;   // ATOM operation.
 
     Instruction(OpCode op, int dr = -1, int s1r = -1, int s2r = -1, int mem_addr = -1)
-        : opcode(op), dest_reg(dr), src1_reg(s1r), src2_reg(s2r), mem_address(mem_addr) {}
+        : opcode(op), dest_reg(dr), src1_reg(s1r), src2_reg(s2r), mem_address(mem_addr),
+          immediate(0), pred_reg(-1), pred_negate(false), compare(CompareOp::EQ), atomic_op(AtomicOp::ADD) {}
+
+    static Instruction movi(int dest, int value) {
+        Instruction instr(OpCode::MOVI, dest);
+        instr.immediate = value;
+        return instr;
+    }
+
+    static Instruction setp(CompareOp compare_op, int pred_dest, int src1, int src2) {
+        Instruction instr(OpCode::SETP, pred_dest, src1, src2);
+        instr.compare = compare_op;
+        return instr;
+    }
+
+    // A branch to target; with pred >= 0 only lanes whose predicate is true
+    // (false when negate is set) take it.
+    static Instruction branch(int target, int pred = -1, bool negate = false) {
+        Instruction instr(OpCode::BRA);
+        instr.immediate = target;
+        instr.pred_reg = pred;
+        instr.pred_negate = negate;
+        return instr;
+    }
+
+    // LDS/STS with no offset register (-1) address Shared[mem_address +
+    // thread in block], the shared memory counterpart of LOAD/STORE.
+    static Instruction loadShared(int dest, int address, int offset_reg = -1) {
+        return Instruction(OpCode::LDS, dest, offset_reg, -1, address);
+    }
+
+    static Instruction storeShared(int address, int src, int offset_reg = -1) {
+        return Instruction(OpCode::STS, -1, src, offset_reg, address);
+    }
+
+    // ATOM on Mem[address + offset_reg], or Mem[address] for every lane when
+    // offset_reg is -1. Unlike LOAD/STORE the address does not include the
+    // thread ID, so lanes can update the same word (a reduction) or words
+    // they computed (a histogram). dest -1 discards the previous values.
+    static Instruction atomic(AtomicOp atomic_op, int dest, int address, int value, int offset_reg = -1) {
+        Instruction instr(OpCode::ATOM, dest, value, offset_reg, address);
+        instr.atomic_op = atomic_op;
+        return instr;
+    }
+
+    bool isControlFlow() const {
+        return opcode == OpCode::BRA;
+    }
 
     std::string opcodeToString() const {
         switch (opcode) {
@@ -30,10 +136,26 @@ struct Instruction {
             case OpCode::LOAD:  return "LOAD";
             case OpCode::STORE: return "STORE";
             case OpCode::HALT:  return "HALT";
+            case OpCode::MOVI:  return "MOVI";
+            case OpCode::SETP:  return "SETP";
+            case OpCode::BRA:   return "BRA";
+            case OpCode::LDS:   return "LDS";
+            case OpCode::STS:   return "STS";
+            case OpCode::BAR:   return "BAR";
+            case OpCode::ATOM:  return "ATOM";
             default:            return "UNKNOWN_OPCODE";
         }
     }
 
+    // "<space>[<mem_address>]" or "<space>[<mem_address> + R<offset_reg>]".
+    std::string indexedOperand(const char* space, int offset_reg) const {
+        std::string operand = std::string(space) + "[" + std::to_string(mem_address);
+        if (offset_reg >= 0) {
+            operand += " + R" + std::to_string(offset_reg);
+        }
+        return operand + "]";
+    }
+
     std::string toString() const {
         std::string s = opcodeToString();
         switch (opcode) {
@@ -49,6 +171,34 @@ struct Instruction {
                 break;
             case OpCode::HALT:
                 break;
+            case OpCode::MOVI:
+                s += " R" + std::to_string(dest_reg) + ", " + std::to_string(immediate);
+                break;
+            case OpCode::SETP:
+                s += std::string(".") + compareOpToString(compare) + " P" + std::to_string(dest_reg)
+                     + ", R" + std::to_string(src1_reg) + ", R" + std::to_string(src2_reg);
+                break;
+            case OpCode::BRA:
+                if (pred_reg >= 0) {
+                    s = std::string("@") + (pred_negate ? "!" : "") + "P" + std::to_string(pred_reg) + " " + s;
+                }
+                s += " " + std::to_string(immediate);
+                break;
+            case OpCode::LDS:
+                s += " R" + std::to_string(dest_reg) + ", " + indexedOperand("Shared", src1_reg);
+                break;
+            case OpCode::STS:
+                s += " " + indexedOperand("Shared", src2_reg) + ", R" + std::to_string(src1_reg);
+                break;
+            case OpCode::BAR:
+                break;
+            case OpCode::ATOM:
+                s += std::string(".") + atomicOpToString(atomic_op) + " ";
+                if (dest_reg >= 0) {
+                    s += "R" + std::to_string(dest_reg) + ", ";
+                }
+                s += indexedOperand("Mem", src2_reg) + ", R" + std::to_string(src1_reg);
+                break;
             default:
                 s += " (Invalid Instruction)";
                 break;
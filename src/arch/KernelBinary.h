@@ -0,0 +1,257 @@
+// src/arch/KernelBinary.h
+#pragma once
+
+#include "Instruction.h"
+#include "DecodedKernel.h"
+#include "../sim/Log.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// On-disk kernel format: a KernelBinaryHeader, instruction_count
+// EncodedInstructions and, when the file caches a decoded kernel,
+// instruction_count DecodedInstructions for num_registers registers per
+// thread. Everything is fixed-size and in host byte order, so a file can be
+// mmapped and used in place.
+constexpr char kKernelBinaryMagic[8] = {'G', 'P', 'U', 'S', 'I', 'M', 'K', 'B'};
+// Version 2 added the control-flow fields (immediate, predicate, compare).
+// ATOM's operation went into a byte that was reserved (zero) before, so it
+// did not need a new version.
+constexpr uint32_t kKernelBinaryVersion = 2;
+
+struct KernelBinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t instruction_count;
+    int32_t num_registers;      // -1 when there is no decoded section.
+    uint32_t num_rewritten;     // DecodedKernel::getNumRewritten() of the decoded section.
+    uint64_t content_hash;      // kernelContentHash() of the encoded instructions.
+};
+
+static_assert(sizeof(KernelBinaryHeader) == 32, "KernelBinaryHeader must stay 32 bytes");
+
+// An Instruction with its -1 sentinels kept; registers must fit in 16 bits.
+struct EncodedInstruction {
+    uint8_t opcode;    // OpCode
+    uint8_t compare;   // CompareOp
+    int8_t pred_reg;
+    uint8_t flags;     // kEncodedPredNegate
+    int16_t dest_reg;
+    int16_t src1_reg;
+    int16_t src2_reg;
+    uint8_t atomic_op; // AtomicOp
+    uint8_t reserved;
+    int32_t mem_address;
+    int32_t immediate;
+};
+
+constexpr uint8_t kEncodedPredNegate = 1;
+
+static_assert(sizeof(EncodedInstruction) == 20, "EncodedInstruction must stay 20 bytes");
+static_assert(sizeof(DecodedInstruction) == 12, "DecodedInstruction must stay 12 bytes");
+
+constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ull;
+
+// 64-bit FNV-1a; seed chains several buffers into one hash.
+inline uint64_t fnv1aHash(const void* data, size_t size, uint64_t seed = kFnvOffsetBasis) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+inline uint64_t kernelContentHash(const std::vector<EncodedInstruction>& encoded) {
+    return fnv1aHash(encoded.data(), encoded.size() * sizeof(EncodedInstruction));
+}
+
+inline bool encodeKernel(const KernelProgram& program, std::vector<EncodedInstruction>& encoded) {
+    encoded.clear();
+    encoded.reserve(program.size());
+    auto fits = [](int reg) {
+        return reg >= std::numeric_limits<int16_t>::min() && reg <= std::numeric_limits<int16_t>::max();
+    };
+    for (size_t pc = 0; pc < program.size(); ++pc) {
+        const Instruction& instr = program[pc];
+        if (!fits(instr.dest_reg) || !fits(instr.src1_reg) || !fits(instr.src2_reg)
+            || instr.pred_reg < std::numeric_limits<int8_t>::min() || instr.pred_reg > std::numeric_limits<int8_t>::max()) {
+            GPU_SIM_LOG(Error, "Error: Kernel instruction " << pc << " (" << instr.toString()
+                        << ") has a register index too large to encode.");
+            encoded.clear();
+            return false;
+        }
+        EncodedInstruction record{};
+        record.opcode = static_cast<uint8_t>(instr.opcode);
+        record.dest_reg = static_cast<int16_t>(instr.dest_reg);
+        record.src1_reg = static_cast<int16_t>(instr.src1_reg);
+        record.src2_reg = static_cast<int16_t>(instr.src2_reg);
+        record.mem_address = instr.mem_address;
+        record.immediate = instr.immediate;
+        record.pred_reg = static_cast<int8_t>(instr.pred_reg);
+        record.flags = instr.pred_negate ? kEncodedPredNegate : 0;
+        record.compare = static_cast<uint8_t>(instr.compare);
+        record.atomic_op = static_cast<uint8_t>(instr.atomic_op);
+        encoded.push_back(record);
+    }
+    return true;
+}
+
+inline KernelProgram decodeKernelBinary(const EncodedInstruction* encoded, size_t count) {
+    KernelProgram program;
+    program.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        Instruction instr(static_cast<OpCode>(encoded[i].opcode), encoded[i].dest_reg,
+                          encoded[i].src1_reg, encoded[i].src2_reg, encoded[i].mem_address);
+        instr.immediate = encoded[i].immediate;
+        instr.pred_reg = encoded[i].pred_reg;
+        instr.pred_negate = (encoded[i].flags & kEncodedPredNegate) != 0;
+        instr.compare = static_cast<CompareOp>(encoded[i].compare);
+        instr.atomic_op = static_cast<AtomicOp>(encoded[i].atomic_op);
+        program.push_back(instr);
+    }
+    return program;
+}
+
+// Writes program (and, if given, its decoded form) to path. The file is
+// written under a temporary name and renamed into place, so concurrent
+// readers never observe a partial file.
+inline bool writeKernelBinary(const std::string& path, const KernelProgram& program,
+                              const DecodedKernel* decoded = nullptr) {
+    std::vector<EncodedInstruction> encoded;
+    if (!encodeKernel(program, encoded)) {
+        return false;
+    }
+    if (decoded && decoded->size() != program.size()) {
+        GPU_SIM_LOG(Error, "Error: Decoded kernel does not match the program written to " << path << ".");
+        return false;
+    }
+
+    KernelBinaryHeader header{};
+    std::memcpy(header.magic, kKernelBinaryMagic, sizeof(header.magic));
+    header.version = kKernelBinaryVersion;
+    header.instruction_count = static_cast<uint32_t>(encoded.size());
+    header.num_registers = decoded ? decoded->getNumRegisters() : -1;
+    header.num_rewritten = decoded ? static_cast<uint32_t>(decoded->getNumRewritten()) : 0;
+    header.content_hash = kernelContentHash(encoded);
+
+    std::string temp_path = path + ".tmp." + std::to_string(::getpid());
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        GPU_SIM_LOG(Error, "Error: Could not open kernel binary " << temp_path << " for writing.");
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(encoded.data(), sizeof(EncodedInstruction), encoded.size(), file) == encoded.size()
+        && (!decoded || std::fwrite(decoded->data(), sizeof(DecodedInstruction), decoded->size(), file) == decoded->size());
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        GPU_SIM_LOG(Error, "Error: Failed to write kernel binary " << path << ".");
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// A read-only mapping of a kernel binary. The header, sizes and content hash
+// are checked on open; isValid() is false for missing or corrupt files.
+class MappedKernelBinary {
+private:
+    void* mapping;
+    size_t mapping_size;
+    bool valid;
+
+    const KernelBinaryHeader* header() const {
+        return static_cast<const KernelBinaryHeader*>(mapping);
+    }
+
+    bool verify(const std::string& path) const {
+        if (mapping_size < sizeof(KernelBinaryHeader)
+            || std::memcmp(header()->magic, kKernelBinaryMagic, sizeof(kKernelBinaryMagic)) != 0
+            || header()->version != kKernelBinaryVersion) {
+            GPU_SIM_LOG(Warning, "Warning: " << path << " is not a version " << kKernelBinaryVersion << " kernel binary.");
+            return false;
+        }
+        size_t count = header()->instruction_count;
+        size_t expected = sizeof(KernelBinaryHeader) + count * sizeof(EncodedInstruction)
+            + (header()->num_registers >= 0 ? count * sizeof(DecodedInstruction) : 0);
+        if (mapping_size != expected) {
+            GPU_SIM_LOG(Warning, "Warning: Kernel binary " << path << " is truncated or has trailing data.");
+            return false;
+        }
+        if (fnv1aHash(getInstructions(), count * sizeof(EncodedInstruction)) != header()->content_hash) {
+            GPU_SIM_LOG(Warning, "Warning: Kernel binary " << path << " failed its content hash check.");
+            return false;
+        }
+        return true;
+    }
+
+public:
+    explicit MappedKernelBinary(const std::string& path) : mapping(nullptr), mapping_size(0), valid(false) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat file_stat;
+        if (::fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+            mapping_size = static_cast<size_t>(file_stat.st_size);
+            mapping = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+                mapping_size = 0;
+            }
+        }
+        ::close(fd);
+        valid = mapping && verify(path);
+    }
+
+    ~MappedKernelBinary() {
+        if (mapping) {
+            ::munmap(mapping, mapping_size);
+        }
+    }
+
+    MappedKernelBinary(const MappedKernelBinary&) = delete;
+    MappedKernelBinary& operator=(const MappedKernelBinary&) = delete;
+
+    bool isValid() const {
+        return valid;
+    }
+
+    const KernelBinaryHeader& getHeader() const {
+        return *header();
+    }
+
+    size_t size() const {
+        return valid ? header()->instruction_count : 0;
+    }
+
+    const EncodedInstruction* getInstructions() const {
+        return reinterpret_cast<const EncodedInstruction*>(static_cast<const char*>(mapping) + sizeof(KernelBinaryHeader));
+    }
+
+    bool hasDecoded() const {
+        return valid && header()->num_registers >= 0;
+    }
+
+    const DecodedInstruction* getDecoded() const {
+        if (!hasDecoded()) {
+            return nullptr;
+        }
+        return reinterpret_cast<const DecodedInstruction*>(getInstructions() + header()->instruction_count);
+    }
+
+    KernelProgram toProgram() const {
+        return valid ? decodeKernelBinary(getInstructions(), size()) : KernelProgram();
+    }
+};
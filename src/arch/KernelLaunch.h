@@ -0,0 +1,47 @@
+// src/arch/KernelLaunch.h
+#pragma once
+
+#include <algorithm>
+
+// Geometry of one kernel launch, used to materialize a block's warps on
+// demand instead of building every warp of the grid up front. Threads are
+// numbered linearly (block * threads_per_block + thread in block); a block is
+// split into warps of threads_per_warp lanes, the last one possibly partial.
+// A launch of part of a grid runs blocks first_block onwards, with the warp
+// and thread IDs they have in the whole grid.
+struct KernelLaunchConfig {
+    long long total_blocks;
+    long long first_block = 0;
+    int threads_per_block;
+    int threads_per_warp;
+    int warps_per_block;
+    int registers_per_thread;
+
+    KernelLaunchConfig(long long num_blocks, int block_threads, int warp_threads, int num_registers)
+        : total_blocks(num_blocks),
+          threads_per_block(block_threads),
+          threads_per_warp(warp_threads),
+          warps_per_block(warp_threads > 0 ? (block_threads + warp_threads - 1) / warp_threads : 0),
+          registers_per_thread(num_registers) {}
+
+    long long totalWarps() const {
+        return total_blocks * warps_per_block;
+    }
+
+    long long totalThreads() const {
+        return total_blocks * threads_per_block;
+    }
+
+    int warpID(long long block, int warp_in_block) const {
+        return static_cast<int>((first_block + block) * warps_per_block + warp_in_block);
+    }
+
+    int firstThreadID(long long block, int warp_in_block) const {
+        return static_cast<int>((first_block + block) * threads_per_block
+                                + static_cast<long long>(warp_in_block) * threads_per_warp);
+    }
+
+    int lanesInWarp(int warp_in_block) const {
+        return std::min(threads_per_warp, threads_per_block - warp_in_block * threads_per_warp);
+    }
+};
@@ -0,0 +1,366 @@
+// src/arch/LaneKernels.h
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define GPU_SIM_HAS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define GPU_SIM_HAS_X86_SIMD 0
+#endif
+
+enum class LaneKernelISA {
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+// Element-wise kernels over one register row (or one contiguous span of global
+// memory) of a warp. The widest implementation the host CPU supports is picked
+// at runtime; forceScalar(true), or setting GPU_SIM_FORCE_SCALAR to a value
+// other than 0 in the environment, pins the portable loops, e.g. to compare
+// the paths. Arithmetic wraps in two's complement on every path, so all
+// implementations produce identical results.
+//
+// Every ISA also has tables specialized at compile time for the common warp
+// widths (4, 8, 16, 32 and 64 lanes), whose loops have a fixed trip count and
+// are fully unrolled. A warp looks up its width class once, when it is set
+// up; other widths use the generic tables, which take the width at runtime.
+class LaneKernels {
+public:
+    using BinaryFn = void (*)(int* dest, const int* src1, const int* src2, int lanes);
+    using CopyFn = void (*)(int* dest, const int* src, int lanes);
+
+    struct Table {
+        LaneKernelISA isa;
+        int width;              // Lanes the kernels are specialized for, 0 for any width.
+        BinaryFn add;
+        BinaryFn mul;
+        CopyFn copy;
+    };
+
+    // Width class 0 is the generic table; 1 .. 5 are 4, 8, 16, 32 and 64 lanes.
+    static constexpr int kNumWidthClasses = 6;
+
+    static int widthClass(int lanes) {
+        switch (lanes) {
+            case 4:  return 1;
+            case 8:  return 2;
+            case 16: return 3;
+            case 32: return 4;
+            case 64: return 5;
+            default: return 0;
+        }
+    }
+
+    static const Table& active(int width_class = 0) {
+        return activeTables()[width_class];
+    }
+
+    // The table a warp of the given width runs with.
+    static const Table& forWidth(int lanes) {
+        return active(widthClass(lanes));
+    }
+
+    // Switches between the detected ISA and the scalar fallback. Only call this
+    // between kernel launches, never while warps are executing.
+    static void forceScalar(bool scalar_only) {
+        activeTables() = scalar_only ? scalarTables() : detectedTables();
+    }
+
+    static bool isScalarForced() {
+        return activeTables() == scalarTables() && detectedTables()[0].isa != LaneKernelISA::Scalar;
+    }
+
+    static LaneKernelISA detectISA() {
+#if GPU_SIM_HAS_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return LaneKernelISA::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return LaneKernelISA::AVX2;
+        }
+#endif
+        return LaneKernelISA::Scalar;
+    }
+
+    static const char* isaToString(LaneKernelISA isa) {
+        switch (isa) {
+            case LaneKernelISA::Scalar: return "scalar";
+            case LaneKernelISA::AVX2:   return "AVX2";
+            case LaneKernelISA::AVX512: return "AVX-512";
+            default:                    return "unknown";
+        }
+    }
+
+private:
+    static int wrappingAdd(int a, int b) {
+        return static_cast<int>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+    }
+
+    static int wrappingMul(int a, int b) {
+        return static_cast<int>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+    }
+
+    static void addScalar(int* dest, const int* src1, const int* src2, int lanes) {
+        for (int i = 0; i < lanes; ++i) {
+            dest[i] = wrappingAdd(src1[i], src2[i]);
+        }
+    }
+
+    static void mulScalar(int* dest, const int* src1, const int* src2, int lanes) {
+        for (int i = 0; i < lanes; ++i) {
+            dest[i] = wrappingMul(src1[i], src2[i]);
+        }
+    }
+
+    static void copyScalar(int* dest, const int* src, int lanes) {
+        for (int i = 0; i < lanes; ++i) {
+            dest[i] = src[i];
+        }
+    }
+
+    // Width-specialized kernels ignore their lanes argument.
+    template <int Width>
+    static void addScalarFixed(int* dest, const int* src1, const int* src2, int) {
+        addScalar(dest, src1, src2, Width);
+    }
+
+    template <int Width>
+    static void mulScalarFixed(int* dest, const int* src1, const int* src2, int) {
+        mulScalar(dest, src1, src2, Width);
+    }
+
+    template <int Width>
+    static void copyScalarFixed(int* dest, const int* src, int) {
+        copyScalar(dest, src, Width);
+    }
+
+#if GPU_SIM_HAS_X86_SIMD
+    __attribute__((target("avx2")))
+    static void addAVX2(int* dest, const int* src1, const int* src2, int lanes) {
+        int i = 0;
+        for (; i + 8 <= lanes; i += 8) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src2 + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_add_epi32(a, b));
+        }
+        addScalar(dest + i, src1 + i, src2 + i, lanes - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void mulAVX2(int* dest, const int* src1, const int* src2, int lanes) {
+        int i = 0;
+        for (; i + 8 <= lanes; i += 8) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src2 + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_mullo_epi32(a, b));
+        }
+        mulScalar(dest + i, src1 + i, src2 + i, lanes - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void copyAVX2(int* dest, const int* src, int lanes) {
+        int i = 0;
+        for (; i + 8 <= lanes; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), v);
+        }
+        copyScalar(dest + i, src + i, lanes - i);
+    }
+
+    // A 4-lane remainder (Width % 8 == 4) is one SSE operation.
+    template <int Width>
+    __attribute__((target("avx2")))
+    static void addAVX2Fixed(int* dest, const int* src1, const int* src2, int) {
+#pragma GCC unroll 8
+        for (int i = 0; i + 8 <= Width; i += 8) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src2 + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_add_epi32(a, b));
+        }
+        if (Width % 8 == 4) {
+            constexpr int i = Width - 4;
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src2 + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_add_epi32(a, b));
+        }
+    }
+
+    template <int Width>
+    __attribute__((target("avx2")))
+    static void mulAVX2Fixed(int* dest, const int* src1, const int* src2, int) {
+#pragma GCC unroll 8
+        for (int i = 0; i + 8 <= Width; i += 8) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + i));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src2 + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_mullo_epi32(a, b));
+        }
+        if (Width % 8 == 4) {
+            constexpr int i = Width - 4;
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src2 + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_mullo_epi32(a, b));
+        }
+    }
+
+    template <int Width>
+    __attribute__((target("avx2")))
+    static void copyAVX2Fixed(int* dest, const int* src, int) {
+#pragma GCC unroll 8
+        for (int i = 0; i + 8 <= Width; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), v);
+        }
+        if (Width % 8 == 4) {
+            constexpr int i = Width - 4;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void addAVX512(int* dest, const int* src1, const int* src2, int lanes) {
+        int i = 0;
+        for (; i + 16 <= lanes; i += 16) {
+            __m512i a = _mm512_loadu_si512(src1 + i);
+            __m512i b = _mm512_loadu_si512(src2 + i);
+            _mm512_storeu_si512(dest + i, _mm512_add_epi32(a, b));
+        }
+        if (i < lanes) {
+            __mmask16 tail = static_cast<__mmask16>((1u << (lanes - i)) - 1);
+            __m512i a = _mm512_maskz_loadu_epi32(tail, src1 + i);
+            __m512i b = _mm512_maskz_loadu_epi32(tail, src2 + i);
+            _mm512_mask_storeu_epi32(dest + i, tail, _mm512_add_epi32(a, b));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void mulAVX512(int* dest, const int* src1, const int* src2, int lanes) {
+        int i = 0;
+        for (; i + 16 <= lanes; i += 16) {
+            __m512i a = _mm512_loadu_si512(src1 + i);
+            __m512i b = _mm512_loadu_si512(src2 + i);
+            _mm512_storeu_si512(dest + i, _mm512_mullo_epi32(a, b));
+        }
+        if (i < lanes) {
+            __mmask16 tail = static_cast<__mmask16>((1u << (lanes - i)) - 1);
+            __m512i a = _mm512_maskz_loadu_epi32(tail, src1 + i);
+            __m512i b = _mm512_maskz_loadu_epi32(tail, src2 + i);
+            _mm512_mask_storeu_epi32(dest + i, tail, _mm512_mullo_epi32(a, b));
+        }
+    }
+
+    __attribute__((target("avx512f")))
+    static void copyAVX512(int* dest, const int* src, int lanes) {
+        int i = 0;
+        for (; i + 16 <= lanes; i += 16) {
+            _mm512_storeu_si512(dest + i, _mm512_loadu_si512(src + i));
+        }
+        if (i < lanes) {
+            __mmask16 tail = static_cast<__mmask16>((1u << (lanes - i)) - 1);
+            _mm512_mask_storeu_epi32(dest + i, tail, _mm512_maskz_loadu_epi32(tail, src + i));
+        }
+    }
+
+    // Only instantiated for multiples of 16 lanes; narrower warps use the
+    // AVX2 kernels on AVX-512 hosts too.
+    template <int Width>
+    __attribute__((target("avx512f")))
+    static void addAVX512Fixed(int* dest, const int* src1, const int* src2, int) {
+        static_assert(Width % 16 == 0, "AVX-512 kernels cover whole vectors");
+#pragma GCC unroll 4
+        for (int i = 0; i < Width; i += 16) {
+            _mm512_storeu_si512(dest + i, _mm512_add_epi32(_mm512_loadu_si512(src1 + i), _mm512_loadu_si512(src2 + i)));
+        }
+    }
+
+    template <int Width>
+    __attribute__((target("avx512f")))
+    static void mulAVX512Fixed(int* dest, const int* src1, const int* src2, int) {
+        static_assert(Width % 16 == 0, "AVX-512 kernels cover whole vectors");
+#pragma GCC unroll 4
+        for (int i = 0; i < Width; i += 16) {
+            _mm512_storeu_si512(dest + i, _mm512_mullo_epi32(_mm512_loadu_si512(src1 + i), _mm512_loadu_si512(src2 + i)));
+        }
+    }
+
+    template <int Width>
+    __attribute__((target("avx512f")))
+    static void copyAVX512Fixed(int* dest, const int* src, int) {
+        static_assert(Width % 16 == 0, "AVX-512 kernels cover whole vectors");
+#pragma GCC unroll 4
+        for (int i = 0; i < Width; i += 16) {
+            _mm512_storeu_si512(dest + i, _mm512_loadu_si512(src + i));
+        }
+    }
+#endif
+
+    template <int Width>
+    static Table scalarFixedTable() {
+        return Table{LaneKernelISA::Scalar, Width, &addScalarFixed<Width>, &mulScalarFixed<Width>,
+                     &copyScalarFixed<Width>};
+    }
+
+    // The tables of one ISA, indexed by width class.
+    static const Table* scalarTables() {
+        static const Table tables[kNumWidthClasses] = {
+            {LaneKernelISA::Scalar, 0, &addScalar, &mulScalar, &copyScalar},
+            scalarFixedTable<4>(), scalarFixedTable<8>(), scalarFixedTable<16>(),
+            scalarFixedTable<32>(), scalarFixedTable<64>()
+        };
+        return tables;
+    }
+
+#if GPU_SIM_HAS_X86_SIMD
+    template <int Width>
+    static Table avx2FixedTable(LaneKernelISA isa) {
+        return Table{isa, Width, &addAVX2Fixed<Width>, &mulAVX2Fixed<Width>, &copyAVX2Fixed<Width>};
+    }
+
+    template <int Width>
+    static Table avx512FixedTable() {
+        return Table{LaneKernelISA::AVX512, Width, &addAVX512Fixed<Width>, &mulAVX512Fixed<Width>,
+                     &copyAVX512Fixed<Width>};
+    }
+#endif
+
+    static const Table* detectedTables() {
+#if GPU_SIM_HAS_X86_SIMD
+        static const Table avx512[kNumWidthClasses] = {
+            {LaneKernelISA::AVX512, 0, &addAVX512, &mulAVX512, &copyAVX512},
+            avx2FixedTable<4>(LaneKernelISA::AVX512), avx2FixedTable<8>(LaneKernelISA::AVX512),
+            avx512FixedTable<16>(), avx512FixedTable<32>(), avx512FixedTable<64>()
+        };
+        static const Table avx2[kNumWidthClasses] = {
+            {LaneKernelISA::AVX2, 0, &addAVX2, &mulAVX2, &copyAVX2},
+            avx2FixedTable<4>(LaneKernelISA::AVX2), avx2FixedTable<8>(LaneKernelISA::AVX2),
+            avx2FixedTable<16>(LaneKernelISA::AVX2), avx2FixedTable<32>(LaneKernelISA::AVX2),
+            avx2FixedTable<64>(LaneKernelISA::AVX2)
+        };
+        static const LaneKernelISA isa = detectISA();
+        if (isa == LaneKernelISA::AVX512) {
+            return avx512;
+        }
+        if (isa == LaneKernelISA::AVX2) {
+            return avx2;
+        }
+#endif
+        return scalarTables();
+    }
+
+    // GPU_SIM_FORCE_SCALAR is set to something other than empty or "0".
+    static bool scalarRequestedByEnvironment() {
+        const char* value = std::getenv("GPU_SIM_FORCE_SCALAR");
+        return value != nullptr && value[0] != '\0' && std::strcmp(value, "0") != 0;
+    }
+
+    static const Table*& activeTables() {
+        static const Table* tables = scalarRequestedByEnvironment() ? scalarTables() : detectedTables();
+        return tables;
+    }
+};
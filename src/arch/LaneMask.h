@@ -0,0 +1,137 @@
+// src/arch/LaneMask.h
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// One bit per lane of a warp of any width. Used for the active mask of the
+// SIMT stack and for predicate registers.
+class LaneMask {
+private:
+    std::vector<uint64_t> words;
+    int num_lanes;
+
+    uint64_t lastWordMask() const {
+        int tail = num_lanes % 64;
+        return tail == 0 ? ~uint64_t{0} : (uint64_t{1} << tail) - 1;
+    }
+
+public:
+    explicit LaneMask(int lanes = 0, bool value = false) : num_lanes(0) {
+        reset(lanes, value);
+    }
+
+    // Resizes to lanes and sets every lane to value, reusing storage.
+    void reset(int lanes, bool value) {
+        num_lanes = lanes > 0 ? lanes : 0;
+        words.assign((static_cast<size_t>(num_lanes) + 63) / 64, value ? ~uint64_t{0} : 0);
+        if (value && !words.empty()) {
+            words.back() &= lastWordMask();
+        }
+    }
+
+    // Copies other into this mask without reallocating when sizes match.
+    void assign(const LaneMask& other) {
+        num_lanes = other.num_lanes;
+        words.assign(other.words.begin(), other.words.end());
+    }
+
+    int getNumLanes() const {
+        return num_lanes;
+    }
+
+    // Raw 64-lane words, lane 0 in bit 0 of the first word (for checkpoints).
+    const std::vector<uint64_t>& getWords() const {
+        return words;
+    }
+
+    // Restores a mask saved with getWords(); false if the sizes disagree.
+    bool assignWords(int lanes, const std::vector<uint64_t>& saved) {
+        if (lanes < 0 || saved.size() != (static_cast<size_t>(lanes) + 63) / 64) {
+            return false;
+        }
+        num_lanes = lanes;
+        words = saved;
+        if (!words.empty()) {
+            words.back() &= lastWordMask();
+        }
+        return true;
+    }
+
+    bool test(int lane) const {
+        return (words[static_cast<size_t>(lane) / 64] >> (lane % 64)) & 1;
+    }
+
+    void set(int lane, bool value) {
+        uint64_t bit = uint64_t{1} << (lane % 64);
+        uint64_t& word = words[static_cast<size_t>(lane) / 64];
+        word = value ? (word | bit) : (word & ~bit);
+    }
+
+    bool none() const {
+        for (uint64_t word : words) {
+            if (word != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool all() const {
+        if (words.empty()) {
+            return true;
+        }
+        for (size_t i = 0; i + 1 < words.size(); ++i) {
+            if (words[i] != ~uint64_t{0}) {
+                return false;
+            }
+        }
+        return words.back() == lastWordMask();
+    }
+
+    int count() const {
+        int total = 0;
+        for (uint64_t word : words) {
+            total += __builtin_popcountll(word);
+        }
+        return total;
+    }
+
+    // this &= other (or &= ~other when invert is set).
+    void andWith(const LaneMask& other, bool invert = false) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] &= invert ? ~other.words[i] : other.words[i];
+        }
+    }
+
+    // this = a & b (or a & ~b when invert is set).
+    void assignAnd(const LaneMask& a, const LaneMask& b, bool invert = false) {
+        num_lanes = a.num_lanes;
+        words.resize(a.words.size());
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] = a.words[i] & (invert ? ~b.words[i] : b.words[i]);
+        }
+    }
+
+    bool operator==(const LaneMask& other) const {
+        return num_lanes == other.num_lanes && words == other.words;
+    }
+
+    bool operator!=(const LaneMask& other) const {
+        return !(*this == other);
+    }
+
+    // Calls fn(lane) for every set lane in ascending order.
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t word = words[w];
+            while (word) {
+                int bit = __builtin_ctzll(word);
+                fn(static_cast<int>(w * 64) + bit);
+                word &= word - 1;
+            }
+        }
+    }
+};
@@ -0,0 +1,124 @@
+// src/arch/PerfCounters.h
+#pragma once
+
+#include "Instruction.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Why a resident warp did not issue in a cycle.
+enum class StallReason : uint8_t {
+    MemoryLatency,      // Waiting for the data of its last load.
+    MemoryThrottle,     // Waiting for the memory channel to accept its last store.
+    SharedMemory,       // Waiting for its last LDS/STS, including bank conflicts.
+    Barrier,            // Waiting at a BAR for the rest of its block.
+    Atomic,             // Waiting for its last ATOM, including contention.
+    NotSelected         // Ready, but the scheduler issued other warps.
+};
+
+constexpr size_t kNumStallReasons = 6;
+
+inline const char* stallReasonToString(StallReason reason) {
+    switch (reason) {
+        case StallReason::MemoryLatency:  return "memory latency";
+        case StallReason::MemoryThrottle: return "memory throttle";
+        case StallReason::SharedMemory:   return "shared memory";
+        case StallReason::Barrier:        return "barrier";
+        case StallReason::Atomic:         return "atomic";
+        case StallReason::NotSelected:    return "not selected";
+        default:                          return "unknown";
+    }
+}
+
+// Simulated hardware counters of a warp, or summed over the warps of an SM
+// or kernel. active_cycles is the warp's residency; for an SM it is the span
+// from its first block admission to its last warp retiring, and summed over
+// SMs for a kernel. Stall cycles are warp-cycles, so on an SM with several
+// resident warps they can exceed active_cycles.
+struct PerfCounters {
+    long long instructions_issued = 0;
+    long long active_cycles = 0;
+    long long stall_cycles[kNumStallReasons] = {};
+    long long opcode_counts[kNumOpCodes] = {};
+    long long shared_requests = 0;          // Warp LDS/STS accesses.
+    long long bank_conflict_cycles = 0;     // Extra cycles they took because of bank conflicts.
+    long long atomic_requests = 0;          // Warp ATOM accesses.
+    long long atomic_contention_cycles = 0; // Extra cycles their serialized updates took.
+
+    void recordIssue(OpCode opcode) {
+        instructions_issued++;
+        opcode_counts[static_cast<size_t>(opcode)]++;
+    }
+
+    long long totalStallCycles() const {
+        long long total = 0;
+        for (long long cycles : stall_cycles) {
+            total += cycles;
+        }
+        return total;
+    }
+
+    void merge(const PerfCounters& other) {
+        instructions_issued += other.instructions_issued;
+        active_cycles += other.active_cycles;
+        for (size_t i = 0; i < kNumStallReasons; ++i) {
+            stall_cycles[i] += other.stall_cycles[i];
+        }
+        for (size_t i = 0; i < kNumOpCodes; ++i) {
+            opcode_counts[i] += other.opcode_counts[i];
+        }
+        shared_requests += other.shared_requests;
+        bank_conflict_cycles += other.bank_conflict_cycles;
+        atomic_requests += other.atomic_requests;
+        atomic_contention_cycles += other.atomic_contention_cycles;
+    }
+};
+
+// Counters of one kernel instruction. Stall cycles are charged to the
+// instruction a warp was waiting to issue, so the cycles a load's consumer
+// waits show up on the consumer.
+struct InstructionCounters {
+    long long issued = 0;           // Warp instructions.
+    long long active_lanes = 0;     // Lanes active, summed over issues.
+    long long stall_cycles[kNumStallReasons] = {};
+
+    long long totalStallCycles() const {
+        long long total = 0;
+        for (long long cycles : stall_cycles) {
+            total += cycles;
+        }
+        return total;
+    }
+
+    void merge(const InstructionCounters& other) {
+        issued += other.issued;
+        active_lanes += other.active_lanes;
+        for (size_t i = 0; i < kNumStallReasons; ++i) {
+            stall_cycles[i] += other.stall_cycles[i];
+        }
+    }
+};
+
+struct SMCounters {
+    int sm_id;
+    PerfCounters counters;
+};
+
+struct WarpCounters {
+    int warp_id;
+    int sm_id;
+    long long admit_cycle;      // SM cycles, counted from the start of the launch.
+    long long retire_cycle;
+    PerfCounters counters;
+};
+
+// Every counter of one kernel launch, broken down by SM, warp and PC.
+struct KernelCounters {
+    PerfCounters totals;
+    std::vector<SMCounters> sms;
+    std::vector<WarpCounters> warps;                    // By warp ID.
+    std::vector<InstructionCounters> instructions;      // By PC.
+    std::vector<std::string> listing;                   // Instruction::toString() by PC.
+};
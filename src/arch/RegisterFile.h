@@ -0,0 +1,118 @@
+// src/arch/RegisterFile.h
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+// Minimal allocator that hands out storage aligned to Alignment bytes, so a
+// register row can be loaded with aligned vector instructions.
+template <typename T, size_t Alignment>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+        void* ptr = std::aligned_alloc(Alignment, bytes == 0 ? Alignment : bytes);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t) noexcept {
+        std::free(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+// Warp-wide register file stored structure-of-arrays as [reg][lane].
+//
+// Each register is one contiguous row holding that register for every lane of
+// the warp, and rows are padded to a multiple of kRowAlignment bytes so every
+// row starts aligned. One extra all-zero row follows the architectural
+// registers; it stands in for an out-of-range source register so the lane
+// loops never need a per-lane bounds check.
+class WarpRegisterFile {
+public:
+    static constexpr size_t kRowAlignment = 64;
+
+private:
+    static constexpr size_t kLanesPerAlignment = kRowAlignment / sizeof(int);
+
+    int num_registers;
+    int num_lanes;
+    size_t lane_stride;
+    std::vector<int, AlignedAllocator<int, kRowAlignment>> data;
+
+public:
+    WarpRegisterFile(int num_regs, int lanes)
+        : num_registers(std::max(num_regs, 0)),
+          num_lanes(std::max(lanes, 0)),
+          lane_stride((static_cast<size_t>(std::max(lanes, 0)) + kLanesPerAlignment - 1)
+                      / kLanesPerAlignment * kLanesPerAlignment),
+          data(lane_stride * (num_registers + 1), 0) {}
+
+    // Reshapes the register file for a new warp and zeroes it, reusing the
+    // existing allocation when it is large enough.
+    void reset(int num_regs, int lanes) {
+        num_registers = std::max(num_regs, 0);
+        num_lanes = std::max(lanes, 0);
+        lane_stride = (static_cast<size_t>(num_lanes) + kLanesPerAlignment - 1)
+                      / kLanesPerAlignment * kLanesPerAlignment;
+        data.assign(lane_stride * (num_registers + 1), 0);
+    }
+
+    int getNumRegisters() const {
+        return num_registers;
+    }
+
+    int getNumLanes() const {
+        return num_lanes;
+    }
+
+    size_t getLaneStride() const {
+        return lane_stride;
+    }
+
+    bool isValidRegister(int reg) const {
+        return reg >= 0 && reg < num_registers;
+    }
+
+    int* row(int reg) {
+        return data.data() + static_cast<size_t>(reg) * lane_stride;
+    }
+
+    const int* row(int reg) const {
+        return data.data() + static_cast<size_t>(reg) * lane_stride;
+    }
+
+    const int* zeroRow() const {
+        return row(num_registers);
+    }
+
+    int get(int reg, int lane) const {
+        return row(reg)[lane];
+    }
+
+    void set(int reg, int lane, int value) {
+        row(reg)[lane] = value;
+    }
+};
@@ -0,0 +1,106 @@
+// src/arch/SampledSimulation.h
+#pragma once
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+// Sampled simulation of kernel launches. Each SM cuts the blocks it is
+// assigned into units of unit_blocks consecutive blocks and simulates about
+// one unit in sample_period (at least three, spread evenly from a seeded
+// random start) cycle by cycle, back to back as if they were all of its
+// work; the other units run functionally, with no timing, caches, counters
+// or timeline events. The SM's cycles are extrapolated from the detailed
+// units. A sample_period of 0 or 1 simulates every block in detail.
+struct SamplingConfig {
+    int sample_period = 0;
+    int unit_blocks = 0;        // 0: four waves of the blocks the SM holds at once.
+    uint32_t seed = 1;
+};
+
+// Extrapolated cycles of a sampled launch, on one SM or the whole device.
+// error_cycles is the half-width of a 95% confidence interval around cycles;
+// it is 0 when every block ran in detail.
+struct SampledCycles {
+    long long detailed_blocks = 0;
+    long long total_blocks = 0;
+    long long cycles = 0;
+    long long error_cycles = 0;
+
+    bool isSampled() const {
+        return detailed_blocks < total_blocks;
+    }
+};
+
+// Which of total_units units to run in detail: systematic sampling with a
+// random start, so every unit has the same chance of being picked.
+inline std::vector<char> chooseSampleUnits(long long total_units, int sample_period, uint32_t seed) {
+    std::vector<char> detailed(static_cast<size_t>(std::max(total_units, 0LL)), 0);
+    if (total_units <= 0) {
+        return detailed;
+    }
+    long long samples = sample_period > 1 ? (total_units + sample_period - 1) / sample_period : total_units;
+    samples = std::min(total_units, std::max(samples, 3LL));
+    std::mt19937 random(seed);
+    double start = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+    for (long long i = 0; i < samples; ++i) {
+        detailed[static_cast<size_t>((i + start) * total_units / samples)] = 1;
+    }
+    return detailed;
+}
+
+// Ratio estimator of a launch's cycles on one SM. The detailed units run
+// back to back, and each unit but the last is timed from admitting its first
+// block to admitting the next unit's first block, which in steady state is
+// the unit's share of the SM's throughput whatever the occupancy. The cycles
+// per block of those units are scaled to all of the SM's blocks but the last
+// detailed unit's, whose time to the end of the run (with the pipeline
+// drain) is added as measured.
+class SampleEstimator {
+private:
+    std::vector<long long> unit_blocks;
+    std::vector<long long> unit_cycles;
+
+public:
+    // Adds the next detailed unit, in run order. For the last one, cycles is
+    // its time to the end of the run.
+    void addUnit(long long blocks, long long cycles) {
+        unit_blocks.push_back(blocks);
+        unit_cycles.push_back(cycles);
+    }
+
+    SampledCycles estimate(long long total_blocks, long long total_units) const {
+        SampledCycles result;
+        result.total_blocks = total_blocks;
+        for (size_t i = 0; i < unit_blocks.size(); ++i) {
+            result.detailed_blocks += unit_blocks[i];
+            result.cycles += unit_cycles[i];
+        }
+        if (unit_blocks.size() < 2 || !result.isSampled()) {
+            return result;
+        }
+        size_t samples = unit_blocks.size() - 1;
+        long long steady_blocks = 0;
+        long long steady_cycles = 0;
+        for (size_t i = 0; i < samples; ++i) {
+            steady_blocks += unit_blocks[i];
+            steady_cycles += unit_cycles[i];
+        }
+        double ratio = static_cast<double>(steady_cycles) / std::max(steady_blocks, 1LL);
+        result.cycles = std::llround(ratio * (total_blocks - unit_blocks.back())) + unit_cycles.back();
+        if (samples > 1) {
+            double residuals = 0.0;
+            for (size_t i = 0; i < samples; ++i) {
+                double residual = unit_cycles[i] - ratio * unit_blocks[i];
+                residuals += residual * residual;
+            }
+            double variance = residuals / (samples - 1);
+            double population = static_cast<double>(total_units - 1);
+            double unsampled_share = std::max(0.0, 1.0 - samples / population);
+            result.error_cycles = std::llround(1.96 * population * std::sqrt(unsampled_share * variance / samples));
+        }
+        return result;
+    }
+};
@@ -3,21 +3,435 @@
 
 #include "Warp.h"
 #include "Instruction.h"
+#include "DecodedKernel.h"
+#include "KernelLaunch.h"
+#include "WarpScheduler.h"
+#include "PerfCounters.h"
+#include "SampledSimulation.h"
 #include "../memory/GPUMemory.h" // Corrected path
+#include "../memory/MemoryPort.h"
+#include "../memory/MemoryTimingModel.h"
+#include "../memory/SharedMemory.h"
+#include "../memory/AtomicUnit.h"
+#include "../sim/Log.h"
+#include "../sim/TimelineTrace.h"
+#include "../sim/Checkpoint.h"
 
 #include <vector>
 #include <iostream>
 #include <numeric>
 #include <cmath>
+#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <limits>
+
+// What one kernel did on one SM during the most recent executeWarps() or
+// executeLaunches() call.
+struct SMKernelStats {
+    PerfCounters counters;
+    long long active_lane_slots = 0;
+    long long lane_slots = 0;
+    long long blocks_dispatched = 0;
+    long long first_admit_cycle = -1;
+    long long completion_cycle = 0;     // Cycle by which its last warp here retired.
+    long long functional_instructions = 0;  // Warp instructions of blocks run functionally.
+    SampledCycles sampling;             // Detailed and total blocks of a sampled launch.
+    std::vector<InstructionMemoryStats> memory_stats;  // Per PC.
+    std::vector<InstructionCounters> instruction_counters;  // Per PC.
+    std::vector<WarpCounters> warp_counters;    // In retirement order.
+};
 
 class ShaderCore {
 private:
+    // A kernel launch this SM takes part in: it runs the launch's blocks
+    // next_block, next_block + block_stride, ... below config.total_blocks
+    // and end_block.
+    struct ResidentLaunch {
+        const DecodedKernel* kernel;    // Bound by executeWarps() if null.
+        KernelLaunchConfig config;
+        long long next_block;
+        long long block_stride;
+        int shared_words = 0;           // Shared memory per block, set when execution starts.
+        long long end_block = std::numeric_limits<long long>::max();    // Narrowed to one unit under sampling.
+    };
+
+    // A block whose warps are resident: its shared memory and how many of its
+    // warps have not retired, or are waiting at a BAR.
+    struct ResidentBlock {
+        std::vector<int> shared;
+        int live_warps = 0;
+        int waiting_warps = 0;
+    };
+
+    static constexpr size_t kNoBlock = std::numeric_limits<size_t>::max();
+
+    // slot_ready_cycle of a warp waiting at a BAR.
+    static constexpr long long kWaitingAtBarrier = std::numeric_limits<long long>::max();
+
     int id;
-    std::vector<Warp> warp_queue;
+
+    // Counters of the warp in a slot. Stalls are charged lazily: when the
+    // warp next issues, the cycles since wait_start are split into
+    // wait_reason (until its last memory request was served) and
+    // NotSelected (after that).
+    struct SlotCounters {
+        PerfCounters counters;
+        long long admit_cycle = 0;
+        long long wait_start = 0;       // First cycle the warp could not issue.
+        StallReason wait_reason = StallReason::NotSelected;
+    };
+
+    // Resident warps. A slot whose warp has finished is reused in place for a
+    // warp of the next block, so warp storage is recycled rather than
+    // reallocated; free_slots is the pool of reusable slots.
+    std::vector<Warp> warp_slots;
+    std::vector<char> slot_active;
+    std::vector<size_t> slot_launch;
+    std::vector<SlotCounters> slot_counters;
+    std::vector<size_t> free_slots;
+    int active_warps_count;
+
+    // Blocks of the resident warps; slot_block is kNoBlock for warps added
+    // by hand, which form no block and pass BARs straight through. Block
+    // storage, like warp storage, is reused.
+    std::vector<ResidentBlock> resident_blocks;
+    std::vector<size_t> free_blocks;
+    std::vector<size_t> slot_block;
+    std::vector<char> slot_at_barrier;
+    long long shared_words_in_use;
+
+    // Launches of the next execution. Several launches run concurrently:
+    // blocks are admitted in launch order once max_resident_warps leaves room
+    // for all of a block's warps, so a later kernel fills the slots an earlier
+    // one leaves free after dispatching its last block.
+    std::vector<ResidentLaunch> launches;
+    std::vector<SMKernelStats> kernel_stats;
+    int max_resident_warps;
+    int peak_resident_warps;
+
+    // Issue policy: each cycle the scheduler picks up to issue_width resident
+    // warps, and each issues one instruction.
+    std::unique_ptr<WarpScheduler> scheduler;
+    int issue_width;
+    std::vector<size_t> issuing_slots;
+    std::vector<char> slot_eligible;
+    std::vector<long long> slot_ready_cycle;
+    long long cycles_executed;
+    long long stop_cycle;           // Negative to run executions to completion.
+    bool suspended;                 // An execution stopped at stop_cycle.
+    long long instructions_issued;
+    long long idle_cycles;
+
+    // SIMD utilization: lanes active for issued instructions versus lanes
+    // those warps have. Divergence lowers the ratio.
+    long long active_lane_slots;
+    long long lane_slots;
+    std::vector<int> lane_addresses;
+
+    // Warps added by hand may have a different register count than the
+    // launch's kernel was decoded for; they run a copy decoded for them.
+    std::unique_ptr<DecodedKernel> fallback_kernel;
+
+    // Global memory timing: coalescing into segment transactions, the L1/L2
+    // caches, per-SM bandwidth and latency. Warps stall until their memory
+    // request completes.
+    MemoryTimingModel memory_timing;
+    SharedMemoryTiming shared_timing;
+    AtomicUnit atomic_unit;
+
+    // Sampled simulation. While the detailed units of a launch run, the
+    // launch's block range is moved from one unit to the next as the previous
+    // one is used up, and each unit's first admission cycle is recorded.
+    // Blocks outside the detailed units run on functional_warps and
+    // functional_shared, reused from block to block.
+    struct SampledUnits {
+        long long first_block = 0;
+        long long block_stride = 1;
+        long long blocks = 0;
+        long long unit_blocks = 1;
+        std::vector<long long> units;           // Detailed units, in run order.
+        size_t next_unit = 0;
+        std::vector<long long> start_cycles;    // Per unit started; -1 until its first block is admitted.
+    };
+    SamplingConfig sampling;
+    SampledUnits sampled_units;
+    std::vector<Warp> functional_warps;
+    std::vector<int> functional_shared;
+
+    bool dump_all_warp_states;
+    std::unordered_set<int> dumped_warp_ids;
+
+    // Timeline export: events are batched here and handed to the writer a
+    // buffer at a time, or all at once while held. Flow IDs stay unique
+    // across executions and SMs.
+    static constexpr size_t kTimelineBufferEvents = 1024;
+    TimelineWriter* timeline;
+    std::vector<TimelineEvent> timeline_buffer;
+    bool timeline_held;
+    uint64_t next_flow_id;
+    uint64_t held_flow_id;
+
+    void recordTimeline(const TimelineEvent& event) {
+        timeline_buffer.push_back(event);
+        if (timeline_buffer.size() >= kTimelineBufferEvents) {
+            flushTimeline();
+        }
+    }
+
+    void flushTimeline() {
+        if (timeline_held) {
+            return;
+        }
+        if (timeline && !timeline_buffer.empty()) {
+            timeline->append(timeline_buffer.data(), timeline_buffer.size());
+        }
+        timeline_buffer.clear();
+    }
+
+    bool shouldDumpWarpState(const Warp& warp) const {
+        if (!Log::isEnabled<LogLevel::Trace>()) {
+            return false;
+        }
+        return dump_all_warp_states || dumped_warp_ids.count(warp.getID()) != 0;
+    }
+
+    size_t occupySlot(size_t launch, size_t block, int warp_id, int first_thread_id, int num_threads,
+                      int num_registers) {
+        size_t slot;
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+            warp_slots[slot].reset(warp_id, first_thread_id, num_threads, num_registers);
+            slot_active[slot] = 1;
+            slot_launch[slot] = launch;
+            slot_ready_cycle[slot] = 0;
+            slot_block[slot] = block;
+            slot_at_barrier[slot] = 0;
+        } else {
+            slot = warp_slots.size();
+            warp_slots.emplace_back(warp_id, first_thread_id, num_threads, num_registers);
+            slot_active.push_back(1);
+            slot_launch.push_back(launch);
+            slot_ready_cycle.push_back(0);
+            slot_counters.emplace_back();
+            slot_block.push_back(block);
+            slot_at_barrier.push_back(0);
+        }
+        startSlotCounters(slot);
+        scheduler->onWarpAdmitted(slot);
+        active_warps_count++;
+        peak_resident_warps = std::max(peak_resident_warps, active_warps_count);
+        return slot;
+    }
+
+    size_t occupyBlock(int num_warps, int shared_words) {
+        size_t block;
+        if (!free_blocks.empty()) {
+            block = free_blocks.back();
+            free_blocks.pop_back();
+        } else {
+            block = resident_blocks.size();
+            resident_blocks.emplace_back();
+        }
+        ResidentBlock& resident = resident_blocks[block];
+        resident.shared.assign(static_cast<size_t>(shared_words), 0);
+        resident.live_warps = num_warps;
+        resident.waiting_warps = 0;
+        shared_words_in_use += shared_words;
+        return block;
+    }
+
+    // Lets the warps of block waiting at a BAR issue from the next cycle.
+    void releaseBarrier(size_t block) {
+        for (size_t slot = 0; slot < warp_slots.size(); ++slot) {
+            if (slot_active[slot] && slot_block[slot] == block && slot_at_barrier[slot]) {
+                slot_at_barrier[slot] = 0;
+                slot_ready_cycle[slot] = cycles_executed + 1;
+            }
+        }
+        resident_blocks[block].waiting_warps = 0;
+    }
+
+    // A warp of block stopped taking part in its barriers: it retired, or
+    // arrived at a BAR.
+    void leaveBarrier(size_t block) {
+        ResidentBlock& resident = resident_blocks[block];
+        if (resident.live_warps > 0 && resident.waiting_warps == resident.live_warps) {
+            releaseBarrier(block);
+        }
+    }
+
+    void startSlotCounters(size_t slot) {
+        SlotCounters& counters = slot_counters[slot];
+        counters = SlotCounters();
+        counters.admit_cycle = cycles_executed;
+        counters.wait_start = cycles_executed;
+        if (slot_launch[slot] < kernel_stats.size()) {
+            SMKernelStats& stats = kernel_stats[slot_launch[slot]];
+            if (stats.first_admit_cycle < 0) {
+                stats.first_admit_cycle = cycles_executed;
+            }
+        }
+    }
+
+    // Charges the cycles the warp in slot waited before issuing at
+    // cycles_executed to the warp, its kernel and the instruction at pc.
+    void chargeStalls(size_t slot, SMKernelStats& stats, int pc) {
+        SlotCounters& counters = slot_counters[slot];
+        long long waited = cycles_executed - counters.wait_start;
+        if (waited <= 0) {
+            return;
+        }
+        long long memory_wait = std::min(waited, std::max(0LL, slot_ready_cycle[slot] - counters.wait_start));
+        long long reasons[kNumStallReasons] = {};
+        reasons[static_cast<size_t>(counters.wait_reason)] += memory_wait;
+        reasons[static_cast<size_t>(StallReason::NotSelected)] += waited - memory_wait;
+        InstructionCounters* instruction = pc >= 0 && pc < static_cast<int>(stats.instruction_counters.size())
+            ? &stats.instruction_counters[pc] : nullptr;
+        for (size_t reason = 0; reason < kNumStallReasons; ++reason) {
+            counters.counters.stall_cycles[reason] += reasons[reason];
+            stats.counters.stall_cycles[reason] += reasons[reason];
+            if (instruction) {
+                instruction->stall_cycles[reason] += reasons[reason];
+            }
+        }
+    }
+
+    void retireSlot(size_t slot, long long retire_cycle) {
+        SMKernelStats& stats = kernel_stats[slot_launch[slot]];
+        stats.completion_cycle = std::max(stats.completion_cycle,
+                                          std::max(cycles_executed + 1, slot_ready_cycle[slot]));
+        SlotCounters& counters = slot_counters[slot];
+        counters.counters.active_cycles = retire_cycle - counters.admit_cycle;
+        stats.counters.active_cycles = std::max(stats.counters.active_cycles,
+                                                retire_cycle - std::max(stats.first_admit_cycle, 0LL));
+        stats.warp_counters.push_back(WarpCounters{warp_slots[slot].getID(), id, counters.admit_cycle,
+                                                   retire_cycle, counters.counters});
+        if (timeline) {
+            recordTimeline(TimelineEvent{TimelineEventKind::WarpResident, OpCode::HALT, id, static_cast<int>(slot),
+                                         warp_slots[slot].getID(), -1, 0, counters.admit_cycle, retire_cycle, 0});
+        }
+        slot_active[slot] = 0;
+        free_slots.push_back(slot);
+        active_warps_count--;
+        scheduler->onWarpRetired(slot);
+
+        size_t block = slot_block[slot];
+        slot_block[slot] = kNoBlock;
+        if (block != kNoBlock) {
+            ResidentBlock& resident = resident_blocks[block];
+            if (--resident.live_warps == 0) {
+                shared_words_in_use -= static_cast<long long>(resident.shared.size());
+                free_blocks.push_back(block);
+            } else {
+                leaveBarrier(block);
+            }
+        }
+    }
+
+    // Registers per thread of the warps this SM runs: the first launch's, or
+    // those of the first warp added by hand.
+    int residentRegisterCount() const {
+        if (!launches.empty()) {
+            return launches.front().config.registers_per_thread;
+        }
+        for (size_t slot = 0; slot < warp_slots.size(); ++slot) {
+            if (slot_active[slot]) {
+                return warp_slots[slot].getRegisterFile().getNumRegisters();
+            }
+        }
+        return 0;
+    }
+
+    const DecodedKernel& kernelForWarp(const DecodedKernel& kernel, const Warp& warp) {
+        int warp_registers = warp.getRegisterFile().getNumRegisters();
+        if (warp_registers == kernel.getNumRegisters()) {
+            return kernel;
+        }
+        if (!fallback_kernel || fallback_kernel->getNumRegisters() != warp_registers
+            || fallback_kernel->size() != kernel.size()) {
+            fallback_kernel = std::make_unique<DecodedKernel>(kernel.getSource(), warp_registers);
+        }
+        return *fallback_kernel;
+    }
+
+    // Points launch at the next detailed unit of a sampled run, if any.
+    bool startNextSampledUnit(ResidentLaunch& launch) {
+        SampledUnits& run = sampled_units;
+        if (run.next_unit >= run.units.size() || &launch != &launches.front()) {
+            return false;
+        }
+        long long unit = run.units[run.next_unit++];
+        launch.next_block = run.first_block + unit * run.unit_blocks * run.block_stride;
+        launch.end_block = launch.next_block + unitBlockCount(unit) * run.block_stride;
+        run.start_cycles.push_back(-1);
+        return true;
+    }
+
+    long long unitBlockCount(long long unit) const {
+        return std::min(sampled_units.unit_blocks, sampled_units.blocks - unit * sampled_units.unit_blocks);
+    }
+
+    // Materializes pending blocks, in launch order, while the resident warp
+    // limit and the SM's shared memory allow. A block larger than either
+    // limit is admitted alone on an otherwise idle SM.
+    void admitBlocks() {
+        for (size_t index = 0; index < launches.size(); ++index) {
+            ResidentLaunch& launch = launches[index];
+            const KernelLaunchConfig& config = launch.config;
+            while (launch.next_block < std::min(config.total_blocks, launch.end_block) || startNextSampledUnit(launch)) {
+                int block_warps = config.warps_per_block;
+                int capacity = std::max(max_resident_warps, block_warps);
+                if (active_warps_count + block_warps > capacity) {
+                    return;
+                }
+                if (launch.shared_words > 0 && shared_words_in_use > 0
+                    && shared_words_in_use + launch.shared_words > shared_timing.getConfig().sm_words) {
+                    return;
+                }
+                long long block = launch.next_block;
+                launch.next_block += launch.block_stride;
+                if (!sampled_units.start_cycles.empty() && sampled_units.start_cycles.back() < 0) {
+                    sampled_units.start_cycles.back() = cycles_executed;
+                }
+                size_t resident = occupyBlock(block_warps, launch.shared_words);
+                int* shared = resident_blocks[resident].shared.data();
+                for (int w = 0; w < block_warps; ++w) {
+                    size_t slot = occupySlot(index, resident, config.warpID(block, w), config.firstThreadID(block, w),
+                                             config.lanesInWarp(w), config.registers_per_thread);
+                    warp_slots[slot].bindSharedMemory(shared, launch.shared_words, w * config.threads_per_warp);
+                }
+                kernel_stats[index].blocks_dispatched++;
+                GPU_SIM_LOG(Trace, "Block " << block << " (" << block_warps << " warps) of launch " << index
+                            << " dispatched to ShaderCore " << id << ".");
+            }
+        }
+    }
 
 public:
-    explicit ShaderCore(int sm_id) : id(sm_id) {
-        std::cout << "ShaderCore " << id << " initialized." << std::endl;
+    explicit ShaderCore(int sm_id)
+        : id(sm_id),
+          active_warps_count(0),
+          shared_words_in_use(0),
+          max_resident_warps(0),
+          peak_resident_warps(0),
+          scheduler(makeWarpScheduler(SchedulerPolicy::LooseRoundRobin)),
+          issue_width(1),
+          cycles_executed(0),
+          stop_cycle(-1),
+          suspended(false),
+          instructions_issued(0),
+          idle_cycles(0),
+          active_lane_slots(0),
+          lane_slots(0),
+          dump_all_warp_states(false),
+          timeline(nullptr),
+          timeline_held(false),
+          next_flow_id(static_cast<uint64_t>(sm_id) << 40),
+          held_flow_id(next_flow_id) {
+        GPU_SIM_LOG(Info, "ShaderCore " << id << " initialized.");
     }
 
     int getID() const {
@@ -25,76 +439,1001 @@ public:
     }
 
     void addWarp(Warp warp) {
-        warp_queue.push_back(std::move(warp));
-        std::cout << "Warp " << warp.getID() << " added to ShaderCore " << id << "." << std::endl;
+        int warp_id = warp.getID();
+        size_t slot;
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+            warp_slots[slot] = std::move(warp);
+            slot_active[slot] = 1;
+            slot_launch[slot] = 0;
+            slot_ready_cycle[slot] = 0;
+            slot_counters[slot] = SlotCounters();
+            slot_block[slot] = kNoBlock;
+            slot_at_barrier[slot] = 0;
+        } else {
+            slot = warp_slots.size();
+            warp_slots.push_back(std::move(warp));
+            slot_active.push_back(1);
+            slot_launch.push_back(0);
+            slot_ready_cycle.push_back(0);
+            slot_counters.emplace_back();
+            slot_block.push_back(kNoBlock);
+            slot_at_barrier.push_back(0);
+        }
+        scheduler->onWarpAdmitted(slot);
+        active_warps_count++;
+        peak_resident_warps = std::max(peak_resident_warps, active_warps_count);
+        GPU_SIM_LOG(Trace, "Warp " << warp_id << " added to ShaderCore " << id << ".");
+    }
+
+    // Assigns this SM the blocks first_block, first_block + stride, ... of a
+    // launch whose kernel is passed to executeWarps(). Their warps are created
+    // only when there is room for them under max_resident.
+    void beginKernel(const KernelLaunchConfig& config, long long first_block, long long stride, int max_resident) {
+        launches.push_back(ResidentLaunch{nullptr, config, first_block, stride > 0 ? stride : 1});
+        max_resident_warps = max_resident;
+        peak_resident_warps = active_warps_count;
+    }
+
+    // Like beginKernel(), for one of several kernels that executeLaunches()
+    // runs concurrently. Launches are numbered in the order they are added.
+    void addKernel(const DecodedKernel& kernel, const KernelLaunchConfig& config,
+                   long long first_block, long long stride) {
+        launches.push_back(ResidentLaunch{&kernel, config, first_block, stride > 0 ? stride : 1});
+    }
+
+    void setMaxResidentWarps(int max_resident) {
+        max_resident_warps = max_resident;
+        peak_resident_warps = active_warps_count;
+    }
+
+    // Drops all resident warps and any pending blocks, keeping the SM's
+    // configuration (e.g. state dumps). Warp storage is kept for reuse.
+    void clearWarps() {
+        free_slots.clear();
+        for (size_t slot = 0; slot < warp_slots.size(); ++slot) {
+            slot_active[slot] = 0;
+            slot_block[slot] = kNoBlock;
+            slot_at_barrier[slot] = 0;
+            free_slots.push_back(warp_slots.size() - 1 - slot);
+        }
+        free_blocks.clear();
+        for (size_t block = resident_blocks.size(); block > 0; --block) {
+            free_blocks.push_back(block - 1);
+        }
+        shared_words_in_use = 0;
+        active_warps_count = 0;
+        launches.clear();
+        suspended = false;
+        scheduler->reset();
+    }
+
+    // Replaces the warp scheduler. Warps already resident, such as those of
+    // a stopped execution, join the new one in slot order.
+    void setScheduler(std::unique_ptr<WarpScheduler> new_scheduler) {
+        if (new_scheduler) {
+            scheduler = std::move(new_scheduler);
+            for (size_t slot = 0; slot < slot_active.size(); ++slot) {
+                if (slot_active[slot]) {
+                    scheduler->onWarpAdmitted(slot);
+                }
+            }
+        }
+    }
+
+    const WarpScheduler& getScheduler() const {
+        return *scheduler;
+    }
+
+    void setIssueWidth(int width) {
+        issue_width = std::max(width, 1);
+    }
+
+    int getIssueWidth() const {
+        return issue_width;
+    }
+
+    void setMemoryTiming(const MemoryTimingConfig& config) {
+        memory_timing.setConfig(config);
+    }
+
+    const MemoryTimingConfig& getMemoryTiming() const {
+        return memory_timing.getConfig();
+    }
+
+    void setSharedMemory(const SharedMemoryConfig& config) {
+        shared_timing.setConfig(config);
+    }
+
+    const SharedMemoryConfig& getSharedMemory() const {
+        return shared_timing.getConfig();
+    }
+
+    void setAtomicTiming(const AtomicTimingConfig& config) {
+        atomic_unit.setConfig(config);
+    }
+
+    const AtomicTimingConfig& getAtomicTiming() const {
+        return atomic_unit.getConfig();
+    }
+
+    void setSampling(const SamplingConfig& config) {
+        sampling = config;
+        sampling.sample_period = std::max(sampling.sample_period, 0);
+        sampling.unit_blocks = std::max(sampling.unit_blocks, 0);
+    }
+
+    const SamplingConfig& getSampling() const {
+        return sampling;
+    }
+
+    // Attaches this SM's private L1 and the GPU-wide L2 (may be null).
+    void setCaches(const CacheConfig& l1_config, SharedCache* l2) {
+        memory_timing.setCaches(l1_config, l2);
+    }
+
+    // L1 hit/miss counters of the most recent executeWarps() call.
+    const CacheStats& getL1Stats() const {
+        return memory_timing.getL1Stats();
+    }
+
+    // Per-PC coalescing statistics of the first kernel of the most recent
+    // execution; entries for non-memory instructions have warp_requests == 0.
+    const std::vector<InstructionMemoryStats>& getInstructionMemoryStats() const {
+        static const std::vector<InstructionMemoryStats> kNoStats;
+        return kernel_stats.empty() ? kNoStats : kernel_stats.front().memory_stats;
+    }
+
+    // Per-kernel statistics of the most recent execution, in launch order.
+    const std::vector<SMKernelStats>& getKernelStats() const {
+        return kernel_stats;
+    }
+
+    // Statistics of the most recent execution, over all of its kernels.
+    long long getCyclesExecuted() const {
+        return cycles_executed;
+    }
+
+    long long getInstructionsIssued() const {
+        return instructions_issued;
+    }
+
+    long long getIdleCycles() const {
+        return idle_cycles;
+    }
+
+    long long getActiveLaneSlots() const {
+        return active_lane_slots;
+    }
+
+    long long getLaneSlots() const {
+        return lane_slots;
+    }
+
+    long long getBlocksDispatched() const {
+        long long blocks = 0;
+        for (const SMKernelStats& stats : kernel_stats) {
+            blocks += stats.blocks_dispatched;
+        }
+        return blocks;
+    }
+
+    int getPeakResidentWarps() const {
+        return peak_resident_warps;
+    }
+
+    size_t getNumWarpSlots() const {
+        return warp_slots.size();
+    }
+
+    // Full register dumps after every instruction are opt-in, either for every
+    // warp on this SM or for individual warp IDs. They are only printed while
+    // the Trace log level is enabled.
+    void setWarpStateDumps(bool enabled) {
+        dump_all_warp_states = enabled;
+    }
+
+    void addWarpStateDump(int warp_id) {
+        dumped_warp_ids.insert(warp_id);
+    }
+
+    void clearWarpStateDumps() {
+        dump_all_warp_states = false;
+        dumped_warp_ids.clear();
+    }
+
+    // Records the following executions on writer's timeline; null stops
+    // recording.
+    void setTimelineWriter(TimelineWriter* writer) {
+        timeline = writer;
+    }
+
+    // Keeps the timeline events of the following executions in the SM until
+    // releaseTimeline() writes them or discardTimeline() drops them, so a run
+    // can be undone.
+    void holdTimeline() {
+        timeline_held = true;
+        held_flow_id = next_flow_id;
+    }
+
+    void releaseTimeline() {
+        timeline_held = false;
+        flushTimeline();
+    }
+
+    void discardTimeline() {
+        timeline_held = false;
+        timeline_buffer.clear();
+        next_flow_id = held_flow_id;
+    }
+
+    // Makes the following executeLaunches() and resumeLaunches() stop once
+    // the SM has simulated `cycle` cycles of the execution, with its warps
+    // still resident and pending blocks still pending, for resumeLaunches()
+    // to continue later. Negative runs executions to completion; sampled
+    // launches and executeWarps() always run to completion.
+    void setStopCycle(long long cycle) {
+        stop_cycle = cycle < 0 ? -1 : cycle;
+    }
+
+    // Whether the most recent execution stopped at the stop cycle.
+    bool isSuspended() const {
+        return suspended;
     }
 
     bool executeWarps(const KernelProgram& kernel, GPUMemory& global_memory) {
-        if (warp_queue.empty()) {
-            std::cout << "ShaderCore " << id << ": No warps to execute." << std::endl;
+        MemoryPort port(global_memory);
+        return executeWarps(kernel, port);
+    }
+
+    bool executeWarps(const KernelProgram& kernel, MemoryPort& global_memory) {
+        return executeWarps(DecodedKernel(kernel, residentRegisterCount()), global_memory);
+    }
+
+    bool executeWarps(const DecodedKernel& kernel, GPUMemory& global_memory) {
+        MemoryPort port(global_memory);
+        return executeWarps(kernel, port);
+    }
+
+    // Runs kernel for the launch begun by beginKernel() (if any) and for the
+    // warps added by hand; see executeLaunches().
+    bool executeWarps(const DecodedKernel& kernel, MemoryPort& global_memory) {
+        bool had_launch = !launches.empty();
+        for (ResidentLaunch& launch : launches) {
+            if (launch.kernel == nullptr) {
+                launch.kernel = &kernel;
+            }
+        }
+        if (launches.empty()) {
+            launches.push_back(ResidentLaunch{&kernel, KernelLaunchConfig(0, 0, 1, residentRegisterCount()), 0, 1});
+        }
+        return runLaunches(global_memory, had_launch, -1);
+    }
+
+    // Runs every added launch concurrently, together with any warps added by
+    // hand (which run the first launch's kernel). See runLaunches().
+    bool executeLaunches(MemoryPort& global_memory) {
+        if (suspended) {
+            GPU_SIM_LOG(Error, "Error: ShaderCore " << id << " has a stopped execution; use resumeLaunches().");
+            return false;
+        }
+        for (const ResidentLaunch& launch : launches) {
+            if (launch.kernel == nullptr) {
+                GPU_SIM_LOG(Error, "Error: ShaderCore " << id << " has a launch without a kernel; use executeWarps().");
+                launches.clear();
+                return false;
+            }
+        }
+        if (launches.empty() && active_warps_count > 0) {
+            GPU_SIM_LOG(Error, "Error: ShaderCore " << id << " has resident warps but no kernel to run.");
+            return false;
+        }
+        return runLaunches(global_memory, !launches.empty(), stop_cycle);
+    }
+
+    // Continues an execution that stopped at the stop cycle, up to the
+    // current stop cycle or to completion. The launches' kernels must still
+    // be alive.
+    bool resumeLaunches(MemoryPort& global_memory) {
+        if (!suspended) {
+            GPU_SIM_LOG(Error, "Error: ShaderCore " << id << " has no stopped execution to resume.");
             return false;
         }
+        suspended = !simulateCycles(global_memory, stop_cycle);
+        if (!suspended) {
+            finishLaunches();
+        }
+        return true;
+    }
 
-        std::cout << "\n--- ShaderCore " << id << " Starting Warp Execution ---" << std::endl;
+private:
+    // Runs the SM cycle by cycle until every resident and pending warp has
+    // retired and outstanding memory transactions have drained. Each cycle the
+    // scheduler selects up to issue_width warps that are not stalled on memory
+    // to issue one instruction each; freed slots are refilled from pending
+    // blocks at the end of the cycle. With sampling on, a launch that has the
+    // SM to itself runs through runSampled() instead. A non-negative stop
+    // leaves the execution suspended once the SM reaches that cycle.
+    bool runLaunches(MemoryPort& global_memory, bool had_launch, long long stop) {
+        cycles_executed = 0;
+        instructions_issued = 0;
+        idle_cycles = 0;
+        active_lane_slots = 0;
+        lane_slots = 0;
+        fallback_kernel.reset();
+        memory_timing.reset();
+        shared_timing.reset();
+        atomic_unit.reset();
+        kernel_stats.assign(launches.size(), SMKernelStats());
+        for (size_t index = 0; index < launches.size(); ++index) {
+            const DecodedKernel& kernel = *launches[index].kernel;
+            launches[index].shared_words = kernel.usesSharedMemory() ? shared_timing.getConfig().block_words : 0;
+            std::vector<InstructionMemoryStats>& memory_stats = kernel_stats[index].memory_stats;
+            memory_stats.assign(kernel.size(), InstructionMemoryStats());
+            for (size_t pc = 0; pc < kernel.size(); ++pc) {
+                memory_stats[pc].pc = static_cast<int>(pc);
+            }
+            kernel_stats[index].instruction_counters.assign(kernel.size(), InstructionCounters());
+        }
 
-        std::vector<bool> warp_active_status(warp_queue.size(), true);
-        int active_warps_count = warp_queue.size();
-        int simulated_cycles = 0;
+        if (sampling.sample_period > 1 && launches.size() == 1 && active_warps_count == 0) {
+            return runSampled(global_memory);
+        }
+        admitBlocks();
+        if (active_warps_count == 0) {
+            GPU_SIM_LOG(Trace, "ShaderCore " << id << ": No warps to execute.");
+            launches.clear();
+            return had_launch;
+        }
 
-        while (active_warps_count > 0 && simulated_cycles < kernel.size() * 2) {
-            bool any_warp_executed_this_cycle = false;
+        GPU_SIM_LOG(Trace, "\n--- ShaderCore " << id << " Starting Warp Execution ("
+                    << schedulerPolicyToString(scheduler->getPolicy()) << " scheduler, issue width "
+                    << issue_width << ") ---");
 
-            for (size_t i = 0; i < warp_queue.size(); ++i) {
-                if (warp_active_status[i]) {
-                    Warp& current_warp = warp_queue[i];
+        suspended = !simulateCycles(global_memory, stop);
+        if (!suspended) {
+            finishLaunches();
+        }
+        return true;
+    }
 
-                    if (current_warp.getCurrentInstructionIndex() < kernel.size()) {
-                        const Instruction& current_instr = kernel[current_warp.getCurrentInstructionIndex()];
+    void finishLaunches() {
+        launches.clear();
+        flushTimeline();
 
-                        std::cout << "\n  ShaderCore " << id << " Cycle " << simulated_cycles
-                                  << ": Executing Warp " << current_warp.getID()
-                                  << " instruction: " << current_instr.toString() << std::endl;
+        GPU_SIM_LOG(Trace, "\n--- ShaderCore " << id << " Finished Warp Execution in "
+                    << cycles_executed << " cycles (" << instructions_issued << " instructions issued). Remaining active warps: "
+                    << active_warps_count << " ---");
+    }
 
-                        bool still_active = current_warp.executeInstruction(current_instr, global_memory);
-                        any_warp_executed_this_cycle = true;
+    // Issues resident warps cycle by cycle, admitting pending blocks as
+    // slots free up, until every warp has retired and outstanding memory
+    // transactions have drained. With a non-negative stop it returns false
+    // instead once cycles_executed reaches stop with warps still resident;
+    // calling it again with a later stop continues exactly where it left off.
+    bool simulateCycles(MemoryPort& global_memory, long long stop = -1) {
+        while (active_warps_count > 0) {
+            if (stop >= 0 && cycles_executed >= stop) {
+                GPU_SIM_LOG(Trace, "\n--- ShaderCore " << id << " Stopped at cycle " << cycles_executed << " with "
+                            << active_warps_count << " warps resident ---");
+                return false;
+            }
+            slot_eligible.assign(slot_active.size(), 0);
+            long long next_ready_cycle = -1;
+            for (size_t slot = 0; slot < slot_active.size(); ++slot) {
+                if (!slot_active[slot]) {
+                    continue;
+                }
+                if (slot_ready_cycle[slot] <= cycles_executed) {
+                    slot_eligible[slot] = 1;
+                } else if (!slot_at_barrier[slot] && (next_ready_cycle < 0 || slot_ready_cycle[slot] < next_ready_cycle)) {
+                    next_ready_cycle = slot_ready_cycle[slot];
+                }
+            }
 
-                        if (!still_active) {
-                            warp_active_status[i] = false;
-                            active_warps_count--;
-                            std::cout << "  Warp " << current_warp.getID() << " has completed its execution." << std::endl;
-                        }
-                        current_warp.printWarpState();
+            issuing_slots.clear();
+            scheduler->selectWarps(slot_eligible, issue_width, issuing_slots);
+            if (issuing_slots.empty()) {
+                // Every resident warp is waiting on memory or at a barrier:
+                // skip ahead to the first cycle one of them can issue again.
+                long long resume_cycle = next_ready_cycle > cycles_executed ? next_ready_cycle : cycles_executed + 1;
+                if (stop >= 0) {
+                    resume_cycle = std::min(resume_cycle, stop);
+                }
+                idle_cycles += resume_cycle - cycles_executed;
+                cycles_executed = resume_cycle;
+                continue;
+            }
+
+            for (size_t slot : issuing_slots) {
+                Warp& current_warp = warp_slots[slot];
+                const DecodedKernel& kernel = *launches[slot_launch[slot]].kernel;
+                SMKernelStats& launch_stats = kernel_stats[slot_launch[slot]];
+
+                if (!current_warp.isActive() || current_warp.getCurrentInstructionIndex() >= static_cast<int>(kernel.size())) {
+                    chargeStalls(slot, launch_stats, -1);
+                    retireSlot(slot, cycles_executed);
+                    GPU_SIM_LOG(Trace, "  Warp " << current_warp.getID() << " finished all instructions.");
+                    continue;
+                }
+
+                const int pc = current_warp.getCurrentInstructionIndex();
+                const DecodedKernel& warp_kernel = kernelForWarp(kernel, current_warp);
+                const DecodedInstruction& current_instr = warp_kernel[pc];
+                const LaneMask& active_mask = current_warp.getActiveMask();
+                const int lanes = static_cast<int>(current_warp.getNumThreads());
+                const bool converged = active_mask.all();
+                const int active_lanes = converged ? lanes : active_mask.count();
+                chargeStalls(slot, launch_stats, pc);
+
+                GPU_SIM_LOG(Trace, "\n  ShaderCore " << id << " Cycle " << cycles_executed
+                            << ": Executing Warp " << current_warp.getID()
+                            << " instruction: " << kernel.getSourceInstruction(pc).toString()
+                            << " (" << active_lanes << "/" << lanes << " lanes active)");
+
+                // Coalescing is measured over the lanes active for this
+                // instruction, before the step can change the mask.
+                if (current_instr.isMemoryAccess()) {
+                    long long base_address = static_cast<long long>(current_instr.mem_address) + current_warp.getFirstThreadID();
+                    int transactions;
+                    if (converged) {
+                        transactions = memory_timing.countContiguousTransactions(base_address, lanes);
                     } else {
-                        if (warp_active_status[i]) {
-                             warp_active_status[i] = false;
-                             active_warps_count--;
-                             std::cout << "  Warp " << current_warp.getID() << " finished all instructions." << std::endl;
+                        lane_addresses.clear();
+                        active_mask.forEach([&](int lane) {
+                            lane_addresses.push_back(static_cast<int>(base_address + lane));
+                        });
+                        transactions = memory_timing.countTransactions(lane_addresses.data(),
+                                                                       static_cast<int>(lane_addresses.size()));
+                    }
+                    InstructionMemoryStats& stats = launch_stats.memory_stats[pc];
+                    stats.warp_requests++;
+                    stats.transactions += transactions;
+                    stats.requested_bytes += static_cast<uint64_t>(active_lanes) * sizeof(int);
+                    stats.transferred_bytes += static_cast<uint64_t>(transactions) * memory_timing.getConfig().segment_bytes;
+                    slot_ready_cycle[slot] = converged
+                        ? memory_timing.issue(cycles_executed, base_address, transactions, current_instr.isLoad())
+                        : memory_timing.issueCounted(cycles_executed, current_instr.isLoad());
+                    launch_stats.completion_cycle = std::max(launch_stats.completion_cycle,
+                                                             memory_timing.getLastCompletionCycle());
+                    if (timeline) {
+                        recordTimeline(TimelineEvent{TimelineEventKind::MemoryRequest, kernel.getSourceInstruction(pc).opcode,
+                                                     id, static_cast<int>(slot), current_warp.getID(), pc, transactions,
+                                                     cycles_executed, std::max(slot_ready_cycle[slot], cycles_executed + 1),
+                                                     next_flow_id++});
+                    }
+                } else if (current_instr.isSharedAccess()) {
+                    lane_addresses.clear();
+                    active_mask.forEach([&](int lane) {
+                        lane_addresses.push_back(current_warp.sharedAddress(current_instr, lane));
+                    });
+                    int ways = shared_timing.conflictWays(lane_addresses.data(), static_cast<int>(lane_addresses.size()));
+                    slot_ready_cycle[slot] = shared_timing.issue(cycles_executed, ways);
+                    launch_stats.counters.shared_requests++;
+                    launch_stats.counters.bank_conflict_cycles += ways - 1;
+                    slot_counters[slot].counters.shared_requests++;
+                    slot_counters[slot].counters.bank_conflict_cycles += ways - 1;
+                } else if (current_instr.isAtomic()) {
+                    // A memory request that skips the L1, finishing no
+                    // earlier than its serialized updates.
+                    lane_addresses.clear();
+                    active_mask.forEach([&](int lane) {
+                        lane_addresses.push_back(current_warp.atomicAddress(current_instr, lane));
+                    });
+                    int transactions = memory_timing.countTransactions(lane_addresses.data(),
+                                                                       static_cast<int>(lane_addresses.size()));
+                    InstructionMemoryStats& stats = launch_stats.memory_stats[pc];
+                    stats.warp_requests++;
+                    stats.transactions += transactions;
+                    stats.requested_bytes += static_cast<uint64_t>(active_lanes) * sizeof(int);
+                    stats.transferred_bytes += static_cast<uint64_t>(transactions) * memory_timing.getConfig().segment_bytes;
+                    long long contention_cycles = 0;
+                    long long updated_cycle = atomic_unit.issue(cycles_executed, lane_addresses.data(),
+                                                                static_cast<int>(lane_addresses.size()), contention_cycles);
+                    slot_ready_cycle[slot] = std::max(memory_timing.issueCounted(cycles_executed, true, true), updated_cycle);
+                    launch_stats.completion_cycle = std::max(launch_stats.completion_cycle, slot_ready_cycle[slot]);
+                    launch_stats.counters.atomic_requests++;
+                    launch_stats.counters.atomic_contention_cycles += contention_cycles;
+                    slot_counters[slot].counters.atomic_requests++;
+                    slot_counters[slot].counters.atomic_contention_cycles += contention_cycles;
+                    if (timeline) {
+                        recordTimeline(TimelineEvent{TimelineEventKind::MemoryRequest, kernel.getSourceInstruction(pc).opcode,
+                                                     id, static_cast<int>(slot), current_warp.getID(), pc, transactions,
+                                                     cycles_executed, std::max(slot_ready_cycle[slot], cycles_executed + 1),
+                                                     next_flow_id++});
+                    }
+                } else {
+                    slot_ready_cycle[slot] = cycles_executed + 1;
+                }
+                active_lane_slots += active_lanes;
+                lane_slots += lanes;
+                launch_stats.active_lane_slots += active_lanes;
+                launch_stats.lane_slots += lanes;
+
+                global_memory.setIssueContext(id, current_warp.getID(), static_cast<uint64_t>(cycles_executed));
+                const OpCode opcode = kernel.getSourceInstruction(pc).opcode;
+                if (timeline) {
+                    recordTimeline(TimelineEvent{TimelineEventKind::Issue, opcode, id, static_cast<int>(slot),
+                                                 current_warp.getID(), pc, active_lanes, cycles_executed,
+                                                 cycles_executed + 1, 0});
+                }
+                bool still_active = current_warp.step(warp_kernel, global_memory);
+                instructions_issued++;
+                launch_stats.counters.recordIssue(opcode);
+                InstructionCounters& instruction_counters = launch_stats.instruction_counters[pc];
+                instruction_counters.issued++;
+                instruction_counters.active_lanes += active_lanes;
+                SlotCounters& counters = slot_counters[slot];
+                counters.counters.recordIssue(opcode);
+                counters.wait_start = cycles_executed + 1;
+                counters.wait_reason = current_instr.isLoad() ? StallReason::MemoryLatency
+                    : current_instr.isMemoryAccess() ? StallReason::MemoryThrottle
+                    : current_instr.isSharedAccess() ? StallReason::SharedMemory
+                    : current_instr.isAtomic() ? StallReason::Atomic : StallReason::NotSelected;
+
+                // A warp at a BAR waits until every live warp of its block
+                // has arrived at one.
+                if (current_instr.op == DecodedOp::Barrier && still_active && slot_block[slot] != kNoBlock) {
+                    counters.wait_reason = StallReason::Barrier;
+                    slot_at_barrier[slot] = 1;
+                    slot_ready_cycle[slot] = kWaitingAtBarrier;
+                    resident_blocks[slot_block[slot]].waiting_warps++;
+                    leaveBarrier(slot_block[slot]);
+                }
+
+                if (!still_active) {
+                    retireSlot(slot, cycles_executed + 1);
+                    GPU_SIM_LOG(Trace, "  Warp " << current_warp.getID() << " has completed its execution.");
+                }
+                if (shouldDumpWarpState(current_warp)) {
+                    current_warp.printWarpState();
+                }
+            }
+
+            cycles_executed++;
+            admitBlocks();
+        }
+
+        cycles_executed = std::max(cycles_executed, memory_timing.getLastCompletionCycle());
+        return true;
+    }
+
+    // Runs the SM's blocks of its only launch in units: the units
+    // chooseSampleUnits() picks cycle by cycle in one continuous run, then
+    // the rest functionally, and sets the SM's cycles to the extrapolation
+    // from the detailed ones.
+    bool runSampled(MemoryPort& global_memory) {
+        ResidentLaunch& launch = launches.front();
+        const KernelLaunchConfig& config = launch.config;
+        SMKernelStats& stats = kernel_stats.front();
+        SampledUnits& run = sampled_units;
+        run = SampledUnits();
+        run.first_block = launch.next_block;
+        run.block_stride = launch.block_stride;
+        run.blocks = run.first_block < config.total_blocks
+            ? (config.total_blocks - run.first_block + run.block_stride - 1) / run.block_stride : 0;
+        if (run.blocks == 0) {
+            GPU_SIM_LOG(Trace, "ShaderCore " << id << ": No warps to execute.");
+            launches.clear();
+            return true;
+        }
+
+        long long wave_blocks = std::max(1, max_resident_warps / std::max(config.warps_per_block, 1));
+        if (launch.shared_words > 0) {
+            wave_blocks = std::min(wave_blocks, std::max(1LL, static_cast<long long>(shared_timing.getConfig().sm_words / launch.shared_words)));
+        }
+        run.unit_blocks = sampling.unit_blocks > 0 ? sampling.unit_blocks : 4 * wave_blocks;
+        long long units = (run.blocks + run.unit_blocks - 1) / run.unit_blocks;
+        std::vector<char> detailed = chooseSampleUnits(units, sampling.sample_period, sampling.seed + static_cast<uint32_t>(id));
+        for (long long unit = 0; unit < units; ++unit) {
+            if (detailed[static_cast<size_t>(unit)]) {
+                run.units.push_back(unit);
+            }
+        }
+
+        GPU_SIM_LOG(Trace, "\n--- ShaderCore " << id << " Starting Sampled Execution (" << run.units.size() << " of "
+                    << units << " units of " << run.unit_blocks << " blocks in detail) ---");
+        launch.end_block = launch.next_block;   // The first unit is picked by admitBlocks().
+        admitBlocks();
+        simulateCycles(global_memory);
+
+        SampleEstimator estimator;
+        for (size_t i = 0; i < run.units.size(); ++i) {
+            long long end_cycle = i + 1 < run.start_cycles.size() ? run.start_cycles[i + 1] : cycles_executed;
+            estimator.addUnit(unitBlockCount(run.units[i]), end_cycle - run.start_cycles[i]);
+        }
+        for (long long unit = 0; unit < units; ++unit) {
+            if (!detailed[static_cast<size_t>(unit)]) {
+                runFunctionalBlocks(launch, stats, run.first_block + unit * run.unit_blocks * run.block_stride,
+                                    unitBlockCount(unit), global_memory);
+            }
+        }
+
+        stats.sampling = estimator.estimate(run.blocks, units);
+        stats.completion_cycle = stats.sampling.cycles;
+        cycles_executed = stats.sampling.cycles;
+        run = SampledUnits();
+        launches.clear();
+        flushTimeline();
+
+        GPU_SIM_LOG(Trace, "\n--- ShaderCore " << id << " Finished Sampled Execution: " << stats.sampling.detailed_blocks
+                    << " of " << stats.sampling.total_blocks << " blocks in detail, " << cycles_executed << " +/- "
+                    << stats.sampling.error_cycles << " cycles ---");
+        return true;
+    }
+
+    // Runs count blocks of launch, from first_block on, to completion without
+    // timing. Warps of a kernel with barriers take turns, each running up to
+    // and through its next BAR, so every warp of the block reaches a barrier
+    // before any goes past it.
+    void runFunctionalBlocks(const ResidentLaunch& launch, SMKernelStats& stats, long long first_block,
+                             long long count, MemoryPort& global_memory) {
+        const DecodedKernel& kernel = *launch.kernel;
+        const KernelLaunchConfig& config = launch.config;
+        const bool barriers = kernel.usesBarriers();
+        const int block_warps = config.warps_per_block;
+        while (static_cast<int>(functional_warps.size()) < block_warps) {
+            functional_warps.emplace_back(0, 0, 1, 1);  // Reset for each block.
+        }
+        long long executed = 0;
+        for (long long i = 0; i < count; ++i) {
+            long long block = first_block + i * launch.block_stride;
+            functional_shared.assign(static_cast<size_t>(launch.shared_words), 0);
+            for (int w = 0; w < block_warps; ++w) {
+                Warp& warp = functional_warps[w];
+                warp.reset(config.warpID(block, w), config.firstThreadID(block, w), config.lanesInWarp(w),
+                           config.registers_per_thread);
+                warp.bindSharedMemory(functional_shared.data(), launch.shared_words, w * config.threads_per_warp);
+            }
+            bool running = true;
+            while (running) {
+                running = false;
+                for (int w = 0; w < block_warps; ++w) {
+                    Warp& warp = functional_warps[w];
+                    global_memory.setIssueContext(id, warp.getID(), static_cast<uint64_t>(cycles_executed));
+                    if (!barriers) {
+                        executed += static_cast<long long>(warp.run(kernel, global_memory));
+                        continue;
+                    }
+                    while (warp.isActive()) {
+                        int pc = warp.getCurrentInstructionIndex();
+                        if (pc >= static_cast<int>(kernel.size())) {
+                            warp.step(kernel, global_memory);   // Exits lanes that ran off the end.
+                            continue;
+                        }
+                        bool at_barrier = kernel[pc].op == DecodedOp::Barrier;
+                        warp.step(kernel, global_memory);
+                        executed++;
+                        if (at_barrier) {
+                            break;
                         }
                     }
+                    running = running || warp.isActive();
                 }
             }
+            stats.blocks_dispatched++;
+        }
+        stats.functional_instructions += executed;
+    }
+
+    static void saveKernelStats(CheckpointWriter& writer, const SMKernelStats& stats) {
+        writer.write(stats.counters);
+        writer.write<int64_t>(stats.active_lane_slots);
+        writer.write<int64_t>(stats.lane_slots);
+        writer.write<int64_t>(stats.blocks_dispatched);
+        writer.write<int64_t>(stats.first_admit_cycle);
+        writer.write<int64_t>(stats.completion_cycle);
+        writer.write<int64_t>(stats.functional_instructions);
+        writer.write(stats.sampling);
+        writer.write<uint64_t>(stats.memory_stats.size());
+        for (const InstructionMemoryStats& memory : stats.memory_stats) {
+            writer.write<int32_t>(memory.pc);
+            writer.write(memory.warp_requests);
+            writer.write(memory.transactions);
+            writer.write(memory.requested_bytes);
+            writer.write(memory.transferred_bytes);
+        }
+        writer.writeVector(stats.instruction_counters);
+        writer.writeVector(stats.warp_counters);
+    }
+
+    static bool restoreKernelStats(CheckpointReader& reader, SMKernelStats& stats) {
+        int64_t values[6] = {};
+        uint64_t num_memory_stats = 0;
+        reader.read(stats.counters);
+        for (int64_t& value : values) {
+            reader.read(value);
+        }
+        reader.read(stats.sampling);
+        reader.read(num_memory_stats);
+        stats.active_lane_slots = values[0];
+        stats.lane_slots = values[1];
+        stats.blocks_dispatched = values[2];
+        stats.first_admit_cycle = values[3];
+        stats.completion_cycle = values[4];
+        stats.functional_instructions = values[5];
+        stats.memory_stats.clear();
+        for (uint64_t i = 0; i < num_memory_stats && reader.ok(); ++i) {
+            InstructionMemoryStats memory;
+            int32_t pc = 0;
+            reader.read(pc);
+            reader.read(memory.warp_requests);
+            reader.read(memory.transactions);
+            reader.read(memory.requested_bytes);
+            reader.read(memory.transferred_bytes);
+            memory.pc = pc;
+            stats.memory_stats.push_back(memory);
+        }
+        reader.readVector(stats.instruction_counters);
+        reader.readVector(stats.warp_counters);
+        return reader.ok();
+    }
+
+    // Reads back the stopped execution saveState() wrote after the
+    // statistics, into an SM cleared by restoreState().
+    bool restoreExecution(CheckpointReader& reader, const std::vector<const DecodedKernel*>& kernels) {
+        uint64_t num_launches = 0;
+        scheduler->restoreState(reader);
+        reader.read(num_launches);
+        if (!reader.ok() || num_launches != kernel_stats.size() || num_launches > kernels.size()) {
+            return false;
+        }
+        for (uint64_t i = 0; i < num_launches; ++i) {
+            KernelLaunchConfig config(0, 0, 1, 0);
+            int64_t next_block = 0, block_stride = 0, end_block = 0;
+            int32_t shared_words = 0;
+            reader.read(config);
+            reader.read(next_block);
+            reader.read(block_stride);
+            reader.read(shared_words);
+            reader.read(end_block);
+            if (!reader.ok() || kernels[i] == nullptr || block_stride <= 0 || shared_words < 0) {
+                return false;
+            }
+            launches.push_back(ResidentLaunch{kernels[i], config, next_block, block_stride, shared_words, end_block});
+        }
 
-            if (!any_warp_executed_this_cycle && active_warps_count > 0) {
-                std::cout << "  ShaderCore " << id << ": All active warps have finished their instructions. Forcing end." << std::endl;
-                break;
+        uint64_t num_slots = 0;
+        reader.read(num_slots);
+        warp_slots.clear();
+        slot_active.clear();
+        slot_launch.clear();
+        slot_ready_cycle.clear();
+        slot_counters.clear();
+        slot_block.clear();
+        slot_at_barrier.clear();
+        for (uint64_t slot = 0; slot < num_slots && reader.ok(); ++slot) {
+            warp_slots.emplace_back(0, 0, 1, 1);
+            uint8_t active = 0, at_barrier = 0;
+            uint64_t launch = 0, block = 0;
+            int64_t ready_cycle = 0;
+            SlotCounters counters;
+            warp_slots.back().restoreState(reader);
+            reader.read(active);
+            reader.read(launch);
+            reader.read(ready_cycle);
+            reader.read(counters);
+            reader.read(block);
+            reader.read(at_barrier);
+            if (active && launch >= launches.size()) {
+                return false;
             }
-            if (active_warps_count > 0) {
-                simulated_cycles++;
-            } else {
-                break;
+            slot_active.push_back(active ? 1 : 0);
+            slot_launch.push_back(static_cast<size_t>(launch));
+            slot_ready_cycle.push_back(ready_cycle);
+            slot_counters.push_back(counters);
+            slot_block.push_back(static_cast<size_t>(block));
+            slot_at_barrier.push_back(at_barrier ? 1 : 0);
+        }
+        std::vector<uint64_t> indices;
+        int32_t active_warps = 0;
+        uint64_t num_blocks = 0;
+        reader.readVector(indices);
+        free_slots.assign(indices.begin(), indices.end());
+        reader.read(active_warps);
+        reader.read(num_blocks);
+        resident_blocks.clear();
+        for (uint64_t i = 0; i < num_blocks && reader.ok(); ++i) {
+            resident_blocks.emplace_back();
+            int32_t live_warps = 0, waiting_warps = 0;
+            reader.readVector(resident_blocks.back().shared);
+            reader.read(live_warps);
+            reader.read(waiting_warps);
+            resident_blocks.back().live_warps = live_warps;
+            resident_blocks.back().waiting_warps = waiting_warps;
+        }
+        reader.readVector(indices);
+        free_blocks.assign(indices.begin(), indices.end());
+        int64_t shared_in_use = 0;
+        uint8_t held = 0;
+        uint64_t held_id = 0;
+        reader.read(shared_in_use);
+        reader.readVector(timeline_buffer);
+        reader.read(held);
+        reader.read(held_id);
+        if (!reader.ok()) {
+            return false;
+        }
+        for (size_t slot : free_slots) {
+            if (slot >= warp_slots.size()) {
+                return false;
+            }
+        }
+        for (size_t block : free_blocks) {
+            if (block >= resident_blocks.size()) {
+                return false;
             }
         }
 
-        std::cout << "\n--- ShaderCore " << id << " Finished Warp Execution in "
-                  << simulated_cycles << " cycles. Remaining active warps: "
-                  << active_warps_count << " ---" << std::endl;
+        // Warps point into their block's shared memory, which now lives in
+        // the restored blocks.
+        for (size_t slot = 0; slot < warp_slots.size(); ++slot) {
+            size_t block = slot_block[slot];
+            if (!slot_active[slot] || block == kNoBlock) {
+                continue;
+            }
+            if (block >= resident_blocks.size()) {
+                return false;
+            }
+            std::vector<int>& shared = resident_blocks[block].shared;
+            warp_slots[slot].bindSharedMemory(shared.data(), static_cast<int>(shared.size()),
+                                              warp_slots[slot].getBlockThread());
+        }
+        active_warps_count = active_warps;
+        shared_words_in_use = shared_in_use;
+        timeline_held = held != 0;
+        held_flow_id = held_id;
+        suspended = true;
+        return true;
+    }
+
+public:
+    // Saves the SM: the issue policy, the memory timing model and L1, the
+    // shared memory and atomic timing, the sampling settings and the
+    // statistics of the most recent execution. An execution stopped at the
+    // stop cycle is saved whole, for resumeLaunches() to continue after
+    // restoreState(): its launches and their pending blocks, every warp slot
+    // (registers, pc, SIMT stack, predicates, readiness and counters), the
+    // resident blocks' shared memory and barrier counts, the scheduler's
+    // queues and the held timeline events. The launches' kernels are not
+    // saved. Fails while launches are pending outside a stopped execution.
+    bool saveState(CheckpointWriter& writer) const {
+        if (!suspended && (!launches.empty() || active_warps_count > 0)) {
+            GPU_SIM_LOG(Error, "Error: ShaderCore " << id << " cannot be checkpointed with launches or warps pending.");
+            return false;
+        }
+        writer.write<int32_t>(issue_width);
+        writer.write<int32_t>(max_resident_warps);
+        writer.write<int32_t>(static_cast<int32_t>(scheduler->getPolicy()));
+        const TwoLevelScheduler* two_level = dynamic_cast<const TwoLevelScheduler*>(scheduler.get());
+        writer.write<uint64_t>(two_level ? two_level->getActiveSetSize() : 0);
+        memory_timing.saveState(writer);
+        shared_timing.saveState(writer);
+        atomic_unit.saveState(writer);
+        writer.write(sampling);
+        writer.write<int64_t>(cycles_executed);
+        writer.write<int64_t>(instructions_issued);
+        writer.write<int64_t>(idle_cycles);
+        writer.write<int64_t>(active_lane_slots);
+        writer.write<int64_t>(lane_slots);
+        writer.write<int32_t>(peak_resident_warps);
+        writer.write<uint64_t>(next_flow_id);
+        writer.write<uint64_t>(kernel_stats.size());
+        for (const SMKernelStats& stats : kernel_stats) {
+            saveKernelStats(writer, stats);
+        }
+        writer.write<uint8_t>(suspended ? 1 : 0);
+        if (!suspended) {
+            return true;
+        }
+
+        scheduler->saveState(writer);
+        writer.write<uint64_t>(launches.size());
+        for (const ResidentLaunch& launch : launches) {
+            writer.write(launch.config);
+            writer.write<int64_t>(launch.next_block);
+            writer.write<int64_t>(launch.block_stride);
+            writer.write<int32_t>(launch.shared_words);
+            writer.write<int64_t>(launch.end_block);
+        }
+        writer.write<uint64_t>(warp_slots.size());
+        for (size_t slot = 0; slot < warp_slots.size(); ++slot) {
+            warp_slots[slot].saveState(writer);
+            writer.write<uint8_t>(slot_active[slot]);
+            writer.write<uint64_t>(slot_launch[slot]);
+            writer.write<int64_t>(slot_ready_cycle[slot]);
+            writer.write(slot_counters[slot]);
+            writer.write<uint64_t>(slot_block[slot]);
+            writer.write<uint8_t>(slot_at_barrier[slot]);
+        }
+        writer.writeVector(std::vector<uint64_t>(free_slots.begin(), free_slots.end()));
+        writer.write<int32_t>(active_warps_count);
+        writer.write<uint64_t>(resident_blocks.size());
+        for (const ResidentBlock& block : resident_blocks) {
+            writer.writeVector(block.shared);
+            writer.write<int32_t>(block.live_warps);
+            writer.write<int32_t>(block.waiting_warps);
+        }
+        writer.writeVector(std::vector<uint64_t>(free_blocks.begin(), free_blocks.end()));
+        writer.write<int64_t>(shared_words_in_use);
+        writer.writeVector(timeline_buffer);
+        writer.write<uint8_t>(timeline_held ? 1 : 0);
+        writer.write<uint64_t>(held_flow_id);
+        return true;
+    }
+
+    // Restores a state saved by saveState(). A stopped execution is bound to
+    // kernels, the kernels of its launches in launch order, which must
+    // outlive it; otherwise the SM is left without warps. The L2 is not part
+    // of the state; call setCaches() beforehand to reattach one.
+    bool restoreState(CheckpointReader& reader, const std::vector<const DecodedKernel*>& kernels = {}) {
+        int32_t width = 0, max_resident = 0, policy = 0;
+        uint64_t active_set_size = 0;
+        reader.read(width);
+        reader.read(max_resident);
+        reader.read(policy);
+        reader.read(active_set_size);
+        if (!reader.ok() || policy < 0 || policy > static_cast<int32_t>(SchedulerPolicy::TwoLevel)) {
+            return reader.fail();
+        }
+        memory_timing.restoreState(reader);
+        shared_timing.restoreState(reader);
+        atomic_unit.restoreState(reader);
+        SamplingConfig restored_sampling;
+        reader.read(restored_sampling);
+        int64_t cycles = 0, issued = 0, idle = 0, active_lanes = 0, lanes = 0;
+        int32_t peak_resident = 0;
+        uint64_t flow_id = 0, num_stats = 0;
+        reader.read(cycles);
+        reader.read(issued);
+        reader.read(idle);
+        reader.read(active_lanes);
+        reader.read(lanes);
+        reader.read(peak_resident);
+        reader.read(flow_id);
+        reader.read(num_stats);
+        std::vector<SMKernelStats> restored_stats;
+        for (uint64_t i = 0; i < num_stats && reader.ok(); ++i) {
+            restored_stats.emplace_back();
+            restoreKernelStats(reader, restored_stats.back());
+        }
+        uint8_t stopped = 0;
+        reader.read(stopped);
+        if (!reader.ok()) {
+            GPU_SIM_LOG(Error, "Error: Checkpoint state for ShaderCore " << id << " is malformed.");
+            return false;
+        }
+
+        issue_width = width;
+        max_resident_warps = max_resident;
+        scheduler = makeWarpScheduler(static_cast<SchedulerPolicy>(policy), static_cast<size_t>(active_set_size));
+        setSampling(restored_sampling);
+        clearWarps();
+        fallback_kernel.reset();
+        cycles_executed = cycles;
+        instructions_issued = issued;
+        idle_cycles = idle;
+        active_lane_slots = active_lanes;
+        lane_slots = lanes;
+        peak_resident_warps = peak_resident;
+        kernel_stats = std::move(restored_stats);
+        timeline_buffer.clear();
+        timeline_held = false;
+        next_flow_id = flow_id;
+        held_flow_id = flow_id;
+        if (stopped && !restoreExecution(reader, kernels)) {
+            clearWarps();
+            GPU_SIM_LOG(Error, "Error: Checkpoint state for ShaderCore " << id << "'s stopped execution is malformed.");
+            return reader.fail();
+        }
         return true;
     }
 
     const Warp& getWarp(size_t index) const {
-        if (index >= warp_queue.size()) {
+        if (index >= warp_slots.size()) {
             throw std::out_of_range("Warp index out of bounds in ShaderCore::getWarp");
         }
-        return warp_queue[index];
+        return warp_slots[index];
     }
 };
@@ -4,18 +4,26 @@
 #include <vector>
 #include <iostream>
 #include <string>
+#include <cstddef>
+#include "../sim/Log.h"
 
+// A single lane of a Warp. Register storage lives in the warp's
+// WarpRegisterFile ([reg][lane]); a Thread is a lightweight read-only view of
+// one column of it, used by the inspection APIs (Warp::getThread, printRegisters).
 class Thread {
 private:
     int id;
-    std::vector<int> registers;
+    const int* lane_registers;
+    int num_registers;
+    size_t register_stride;
     int program_counter;
 
 public:
-    Thread(int thread_id, int num_registers)
-        : id(thread_id), registers(num_registers, 0), program_counter(0) {
+    Thread(int thread_id, const int* lane_regs, int num_regs, size_t reg_stride, int pc)
+        : id(thread_id), lane_registers(lane_regs), num_registers(num_regs),
+          register_stride(reg_stride), program_counter(pc) {
         if (num_registers <= 0) {
-            std::cerr << "Warning (Thread " << id << "): Initializing with non-positive number of registers." << std::endl;
+            GPU_SIM_LOG(Warning, "Warning (Thread " << id << "): Initializing with non-positive number of registers.");
         }
     }
 
@@ -23,43 +31,27 @@ public:
         return id;
     }
 
-    int getRegister(int index) const {
-        if (index < 0 || index >= registers.size()) {
-            std::cerr << "Error (Thread " << id << "): Register index " << index
-                      << " out of bounds. Max index: " << registers.size() - 1 << std::endl;
-            return 0;
-        }
-        return registers[index];
+    int getNumRegisters() const {
+        return num_registers;
     }
 
-    void setRegister(int index, int value) {
-        if (index < 0 || index >= registers.size()) {
-            std::cerr << "Error (Thread " << id << "): Register index " << index
-                      << " out of bounds. Max index: " << registers.size() - 1 << std::endl;
-            return;
+    int getRegister(int index) const {
+        if (index < 0 || index >= num_registers) {
+            GPU_SIM_LOG(Error, "Error (Thread " << id << "): Register index " << index
+                        << " out of bounds. Max index: " << num_registers - 1);
+            return 0;
         }
-        registers[index] = value;
+        return lane_registers[static_cast<size_t>(index) * register_stride];
     }
 
     int getPC() const {
         return program_counter;
     }
 
-    void incrementPC() {
-        program_counter++;
-    }
-
-    void setPC(int pc) {
-        if (pc < 0) {
-            std::cerr << "Warning (Thread " << id << "): Setting PC to a negative value " << pc << std::endl;
-        }
-        program_counter = pc;
-    }
-
     void printRegisters() const {
         std::cout << "Thread " << id << " (PC=" << program_counter << ") Registers: ";
-        for (size_t i = 0; i < registers.size(); ++i) {
-            std::cout << "R" << i << "=" << registers[i] << " ";
+        for (int i = 0; i < num_registers; ++i) {
+            std::cout << "R" << i << "=" << lane_registers[static_cast<size_t>(i) * register_stride] << " ";
         }
         std::cout << std::endl;
     }
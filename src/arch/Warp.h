@@ -2,30 +2,560 @@
 #pragma once
 
 #include "Thread.h"
+#include "RegisterFile.h"
+#include "LaneKernels.h"
 #include "Instruction.h"
+#include "DecodedKernel.h"
+#include "LaneMask.h"
 #include "../memory/GPUMemory.h" // Corrected path
+#include "../memory/MemoryPort.h"
+#include "../sim/Log.h"
+#include "../sim/Checkpoint.h"
 
 #include <vector>
 #include <iostream>
 #include <string>
 #include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+
+#if !defined(GPU_SIM_THREADED_DISPATCH)
+#if defined(__GNUC__) || defined(__clang__)
+#define GPU_SIM_THREADED_DISPATCH 1
+#else
+#define GPU_SIM_THREADED_DISPATCH 0
+#endif
+#endif
 
 class Warp {
 private:
+    // One entry of the SIMT reconvergence stack: the lanes in mask run from
+    // pc until they reach reconvergence_pc, where the entry is popped and the
+    // entry below resumes. The top entry's pc is current_instruction_index.
+    struct SimtEntry {
+        int pc;
+        int reconvergence_pc;   // -1 for the bottom entry, which never reconverges.
+        LaneMask mask;
+    };
+
     int id;
-    std::vector<Thread> threads;
+    int first_thread_id;
+    WarpRegisterFile registers;
+    int lane_width_class;   // LaneKernels::widthClass() of the warp's width.
     int current_instruction_index;
 
-public:
-    Warp(int warp_id, int num_threads_per_warp, int num_registers_per_thread)
-        : id(warp_id), current_instruction_index(0) {
-        if (num_threads_per_warp <= 0) {
-            std::cerr << "Warning (Warp " << id << "): Initializing with non-positive number of threads." << std::endl;
+    // The shared memory of the warp's block, and the index within the block
+    // of its first thread. Unbound (null) outside a block.
+    int* shared_memory;
+    int shared_words;
+    int block_thread;
+
+    // Entries [0, simt_depth) are live; storage above is kept for reuse so
+    // diverging does not allocate once the stack has grown.
+    std::vector<SimtEntry> simt_stack;
+    size_t simt_depth;
+    std::vector<LaneMask> predicates;
+    LaneMask taken_mask;
+    LaneMask scratch_mask;
+
+    int* destRow(int reg) {
+        if (!registers.isValidRegister(reg)) {
+            GPU_SIM_LOG(Error, "Error (Warp " << id << "): Destination register index " << reg
+                        << " out of bounds. Max index: " << registers.getNumRegisters() - 1);
+            return nullptr;
+        }
+        return registers.row(reg);
+    }
+
+    void resetControlState() {
+        const int lanes = registers.getNumLanes();
+        if (simt_stack.empty()) {
+            simt_stack.push_back(SimtEntry{0, -1, LaneMask()});
+        }
+        simt_stack[0].pc = 0;
+        simt_stack[0].reconvergence_pc = -1;
+        simt_stack[0].mask.reset(lanes, true);
+        simt_depth = lanes > 0 ? 1 : 0;
+        predicates.resize(kNumPredicateRegisters);
+        for (LaneMask& predicate : predicates) {
+            predicate.reset(lanes, false);
+        }
+    }
+
+    SimtEntry& top() {
+        return simt_stack[simt_depth - 1];
+    }
+
+    void pushEntry(int pc, int reconvergence_pc, const LaneMask& mask) {
+        if (simt_depth == simt_stack.size()) {
+            simt_stack.push_back(SimtEntry{0, 0, LaneMask()});
+        }
+        SimtEntry& entry = simt_stack[simt_depth++];
+        entry.pc = pc;
+        entry.reconvergence_pc = reconvergence_pc;
+        entry.mask.assign(mask);
+    }
+
+    // The top entry's lanes leave the kernel (HALT or falling off the end):
+    // they are removed from every entry, and entries left empty are popped.
+    void exitActiveLanes() {
+        scratch_mask.assign(top().mask);
+        for (size_t i = 0; i < simt_depth; ++i) {
+            simt_stack[i].mask.andWith(scratch_mask, true);
+        }
+        while (simt_depth > 0 && top().mask.none()) {
+            simt_depth--;
+        }
+    }
+
+    // Brings the stack to a state where the top entry can issue at pc:
+    // entries that reached their reconvergence point are popped, and lanes
+    // that ran past the end of the kernel exit. Returns false once no lanes
+    // are left.
+    bool settle(size_t& pc, size_t size) {
+        while (simt_depth > 0) {
+            if (pc >= size) {
+                exitActiveLanes();
+            } else if (static_cast<int>(pc) == top().reconvergence_pc) {
+                simt_depth--;
+            } else {
+                break;
+            }
+            if (simt_depth > 0) {
+                pc = static_cast<size_t>(top().pc);
+            }
+        }
+        current_instruction_index = static_cast<int>(pc);
+        return simt_depth > 0;
+    }
+
+    // Splits the top entry at a divergent branch: taken lanes run from target
+    // first, then the others from fallthrough, and both reconverge at
+    // reconvergence_pc. A path that starts at the reconvergence point just
+    // waits there. If the top entry already reconverges at the same point it
+    // is replaced rather than kept, so divergent loops do not grow the stack.
+    void diverge(int fallthrough, int target, int reconvergence_pc, const LaneMask& taken) {
+        scratch_mask.assignAnd(top().mask, taken, true);
+        if (top().reconvergence_pc == reconvergence_pc) {
+            simt_depth--;
+        } else {
+            top().pc = reconvergence_pc;
+        }
+        if (fallthrough != reconvergence_pc) {
+            pushEntry(fallthrough, reconvergence_pc, scratch_mask);
+        }
+        if (target != reconvergence_pc) {
+            pushEntry(target, reconvergence_pc, taken);
+        }
+    }
+
+    int readShared(int address) const {
+        if (address < 0 || address >= shared_words) {
+            GPU_SIM_LOG(Error, "Error (Warp " << id << "): Shared memory read out of bounds at address " << address
+                        << ". Shared memory size: " << shared_words);
+            return 0;
+        }
+        return shared_memory[address];
+    }
+
+    void writeShared(int address, int value) {
+        if (address < 0 || address >= shared_words) {
+            GPU_SIM_LOG(Error, "Error (Warp " << id << "): Shared memory write out of bounds at address " << address
+                        << ". Shared memory size: " << shared_words);
+            return;
+        }
+        shared_memory[address] = value;
+    }
+
+    static int wrappingAdd(int a, int b) {
+        return static_cast<int>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+    }
+
+    static int wrappingMul(int a, int b) {
+        return static_cast<int>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+    }
+
+    static bool compare(uint8_t compare_op, int a, int b) {
+        switch (static_cast<CompareOp>(compare_op)) {
+            case CompareOp::EQ: return a == b;
+            case CompareOp::NE: return a != b;
+            case CompareOp::LT: return a < b;
+            case CompareOp::LE: return a <= b;
+            case CompareOp::GT: return a > b;
+            case CompareOp::GE: return a >= b;
+            default:            return false;
+        }
+    }
+
+    // The interpreter core. Executes up to max_instructions of code for the
+    // top SIMT entry's lanes, following branches, divergence and
+    // reconvergence, and returns the number executed. Operands are trusted
+    // (see DecodedKernel). With every lane active each ALU handler is one
+    // LaneKernels call over register rows and unit-stride LOAD/STORE addresses
+    // (mem_address + thread ID) are copied as one span when the memory port
+    // allows it; inactive lanes are skipped lane by lane. The LaneKernels
+    // table is the one specialized for the warp's width, if there is one.
+    // LDS/STS without an offset register copy a span of shared memory the
+    // same way. ATOM updates memory lane by lane. BAR only advances the pc:
+    // making the block's warps wait is up to the ShaderCore, and a warp on
+    // its own has no one to wait for.
+    //
+    // Superinstructions (see DecodedKernel) run when every lane is active, the
+    // sequence fits in max_instructions without crossing the reconvergence
+    // point and the memory port hands out its spans; otherwise, and whenever a
+    // span is refused, the remaining instructions run unfused. A
+    // LOAD/LOAD/ADD|MUL/STORE also needs its store span to either coincide
+    // with or not overlap each load span, so reading and writing in one pass
+    // sees the same values as the separate instructions would.
+    //
+    // kIsolated executes code[0] on its own (no kernel, no control flow) and
+    // just advances the pc.
+    //
+    // With GCC/Clang the handlers are direct-threaded: each one ends with an
+    // indirect jump through a label table to the next instruction's handler
+    // (computed goto), giving every handler its own branch-predictor entry.
+    // Other compilers fall back to a switch in a loop.
+    template <bool kIsolated>
+    size_t dispatch(const DecodedInstruction* code, size_t size, const DecodedKernel* kernel,
+                    size_t max_instructions, MemoryPort& global_memory) {
+        size_t pc = kIsolated ? 0 : static_cast<size_t>(std::max(current_instruction_index, 0));
+        if (simt_depth == 0 || max_instructions == 0 || (!kIsolated && !settle(pc, size))) {
+            return 0;
+        }
+        const int lanes = registers.getNumLanes();
+        const LaneKernels::Table& kernels = LaneKernels::active(lane_width_class);
+        const LaneMask* active = &top().mask;
+        bool full = active->all();
+        int reconvergence_pc = top().reconvergence_pc;
+        const DecodedInstruction* in = &code[pc];
+        size_t executed = 0;
+
+#if GPU_SIM_THREADED_DISPATCH
+        static void* const kHandlers[kNumDecodedOps] = {
+            &&op_Add, &&op_Mul, &&op_Load, &&op_LoadDiscard, &&op_Store, &&op_Halt, &&op_Nop,
+            &&op_Movi, &&op_SetP, &&op_Bra, &&op_BraPred, &&op_LoadShared, &&op_StoreShared, &&op_Barrier,
+            &&op_Atomic, &&op_LoadLoadAddStore, &&op_LoadLoadMulStore, &&op_AddStore, &&op_MulStore
+        };
+#define GPU_SIM_OP(name) op_##name
+#define GPU_SIM_DISPATCH() goto *kHandlers[static_cast<size_t>(in->op)]
+#else
+#define GPU_SIM_OP(name) case DecodedOp::name
+#define GPU_SIM_DISPATCH() goto dispatch_next
+#endif
+// Continues at pc, which a handler has already set. resettle forces the SIMT
+// stack to be re-examined after a handler changed it.
+#define GPU_SIM_CONTINUE(resettle)                                                   \
+        do {                                                                         \
+            ++executed;                                                              \
+            if (kIsolated) {                                                         \
+                current_instruction_index++;                                         \
+                goto done;                                                           \
+            }                                                                        \
+            if ((resettle) || static_cast<int>(pc) == reconvergence_pc || pc >= size) { \
+                if (!settle(pc, size)) goto done;                                    \
+                active = &top().mask;                                                \
+                full = active->all();                                                \
+                reconvergence_pc = top().reconvergence_pc;                           \
+            }                                                                        \
+            if (executed >= max_instructions) goto done;                             \
+            in = &code[pc];                                                          \
+            GPU_SIM_DISPATCH();                                                      \
+        } while (0)
+#define GPU_SIM_NEXT() do { ++pc; GPU_SIM_CONTINUE(false); } while (0)
+// Skips past count instructions a superinstruction executed.
+#define GPU_SIM_ADVANCE(count) do { executed += (count) - 1; pc += (count); GPU_SIM_CONTINUE(false); } while (0)
+// Runs the instruction at pc from the original code instead.
+#define GPU_SIM_UNFUSED() do { in = &kernel->data()[pc]; GPU_SIM_DISPATCH(); } while (0)
+// Whether a superinstruction of length instructions may run at pc.
+#define GPU_SIM_CAN_FUSE(length)                                                     \
+        (full && executed + (length) <= max_instructions                             \
+         && (reconvergence_pc <= static_cast<int>(pc) || reconvergence_pc >= static_cast<int>(pc) + (length)))
+
+#if GPU_SIM_THREADED_DISPATCH
+        GPU_SIM_DISPATCH();
+#else
+    dispatch_next:
+        switch (in->op) {
+#endif
+        GPU_SIM_OP(Add): {
+            int* dest = registers.row(in->dest);
+            const int* src1 = registers.row(in->src1);
+            const int* src2 = registers.row(in->src2);
+            if (full) {
+                kernels.add(dest, src1, src2, lanes);
+            } else {
+                active->forEach([&](int lane) { dest[lane] = wrappingAdd(src1[lane], src2[lane]); });
+            }
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(Mul): {
+            int* dest = registers.row(in->dest);
+            const int* src1 = registers.row(in->src1);
+            const int* src2 = registers.row(in->src2);
+            if (full) {
+                kernels.mul(dest, src1, src2, lanes);
+            } else {
+                active->forEach([&](int lane) { dest[lane] = wrappingMul(src1[lane], src2[lane]); });
+            }
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(Load):
+        GPU_SIM_OP(LoadDiscard): {
+            int* dest = in->op == DecodedOp::Load ? registers.row(in->dest) : nullptr;
+            int base_address = in->mem_address + first_thread_id;
+            const int* span = full ? global_memory.acquireReadSpan(base_address, lanes) : nullptr;
+            if (span) {
+                if (dest) {
+                    kernels.copy(dest, span, lanes);
+                }
+            } else {
+                active->forEach([&](int lane) {
+                    int value = global_memory.read(base_address + lane);
+                    if (dest) {
+                        dest[lane] = value;
+                    }
+                });
+            }
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(Store): {
+            const int* src = registers.row(in->src1);
+            int base_address = in->mem_address + first_thread_id;
+            int* span = full ? global_memory.acquireWriteSpan(base_address, lanes) : nullptr;
+            if (span) {
+                kernels.copy(span, src, lanes);
+            } else {
+                active->forEach([&](int lane) { global_memory.write(base_address + lane, src[lane]); });
+            }
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(Nop):
+        GPU_SIM_OP(Barrier):
+            GPU_SIM_NEXT();
+        GPU_SIM_OP(LoadShared): {
+            int* dest = registers.row(in->dest);
+            const int base_address = in->mem_address + block_thread;
+            if (full && in->src1 == registers.getNumRegisters() && base_address >= 0
+                && base_address <= shared_words - lanes) {
+                kernels.copy(dest, shared_memory + base_address, lanes);
+            } else {
+                const int* offset = registers.row(in->src1);
+                active->forEach([&](int lane) {
+                    dest[lane] = readShared(static_cast<int>(static_cast<uint32_t>(base_address + lane)
+                                                             + static_cast<uint32_t>(offset[lane])));
+                });
+            }
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(StoreShared): {
+            const int* src = registers.row(in->src1);
+            const int base_address = in->mem_address + block_thread;
+            if (full && in->src2 == registers.getNumRegisters() && base_address >= 0
+                && base_address <= shared_words - lanes) {
+                kernels.copy(shared_memory + base_address, src, lanes);
+            } else {
+                const int* offset = registers.row(in->src2);
+                active->forEach([&](int lane) {
+                    writeShared(static_cast<int>(static_cast<uint32_t>(base_address + lane)
+                                                 + static_cast<uint32_t>(offset[lane])), src[lane]);
+                });
+            }
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(Atomic): {
+            // Lane by lane, so lanes hitting the same word see each other's
+            // updates in lane order.
+            int* dest = registers.row(in->dest);
+            const bool keep_old = !(in->modifier & kAtomicDiscard);
+            const AtomicOp atomic_op = static_cast<AtomicOp>(in->modifier & kAtomicOpMask);
+            const int* value = registers.row(in->src1);
+            const int* offset = registers.row(in->src2);
+            const uint32_t base_address = static_cast<uint32_t>(in->mem_address);
+            active->forEach([&](int lane) {
+                int old_value = global_memory.atomic(static_cast<int>(base_address + static_cast<uint32_t>(offset[lane])),
+                                                     atomic_op, value[lane], dest[lane], keep_old);
+                if (keep_old) {
+                    dest[lane] = old_value;
+                }
+            });
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(Movi): {
+            int* dest = registers.row(in->dest);
+            const int value = in->mem_address;
+            if (full) {
+                std::fill(dest, dest + lanes, value);
+            } else {
+                active->forEach([&](int lane) { dest[lane] = value; });
+            }
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(SetP): {
+            LaneMask& predicate = predicates[in->dest];
+            const int* src1 = registers.row(in->src1);
+            const int* src2 = registers.row(in->src2);
+            const uint8_t compare_op = in->modifier;
+            active->forEach([&](int lane) { predicate.set(lane, compare(compare_op, src1[lane], src2[lane])); });
+            GPU_SIM_NEXT();
+        }
+        GPU_SIM_OP(Bra):
+            pc = static_cast<size_t>(in->mem_address);
+            GPU_SIM_CONTINUE(false);
+        GPU_SIM_OP(BraPred): {
+            taken_mask.assignAnd(*active, predicates[in->src1], (in->modifier & kBranchNegate) != 0);
+            if (taken_mask.none()) {
+                GPU_SIM_NEXT();
+            }
+            const int target = in->mem_address;
+            if (taken_mask == *active) {
+                pc = static_cast<size_t>(target);
+                GPU_SIM_CONTINUE(false);
+            }
+            diverge(static_cast<int>(pc) + 1, target, kernel->getReconvergencePC(pc), taken_mask);
+            pc = static_cast<size_t>(top().pc);
+            GPU_SIM_CONTINUE(true);
+        }
+        GPU_SIM_OP(Halt):
+            exitActiveLanes();
+            if (kIsolated) {
+                ++executed;
+                current_instruction_index++;
+                goto done;
+            }
+            if (simt_depth == 0) {
+                ++executed;
+                current_instruction_index = static_cast<int>(pc) + 1;
+                goto done;
+            }
+            pc = static_cast<size_t>(top().pc);
+            GPU_SIM_CONTINUE(true);
+        GPU_SIM_OP(LoadLoadAddStore):
+        GPU_SIM_OP(LoadLoadMulStore): {
+            const DecodedInstruction* seq = in;
+            const int first_address = seq[0].mem_address + first_thread_id;
+            const int second_address = seq[1].mem_address + first_thread_id;
+            const int store_address = seq[3].mem_address + first_thread_id;
+            auto separate = [&](int load_address) {
+                const long long distance = static_cast<long long>(store_address) - load_address;
+                return distance == 0 || distance >= lanes || distance <= -lanes;
+            };
+            if (!GPU_SIM_CAN_FUSE(4) || !separate(first_address) || !separate(second_address)) {
+                GPU_SIM_UNFUSED();
+            }
+            const int* first = global_memory.acquireReadSpan(first_address, lanes);
+            if (!first) {
+                GPU_SIM_UNFUSED();
+            }
+            // Once a span is taken its accesses are accounted for, so a later
+            // refusal finishes the instructions done so far.
+            const int* second = global_memory.acquireReadSpan(second_address, lanes);
+            int* result = second ? global_memory.acquireWriteSpan(store_address, lanes) : nullptr;
+            const uint8_t writes = result ? seq->modifier : kFusedWriteFirst | kFusedWriteSecond;
+            if (writes & kFusedWriteFirst) {
+                kernels.copy(registers.row(seq[0].dest), first, lanes);
+            }
+            if (!second) {
+                GPU_SIM_ADVANCE(1);
+            }
+            if (writes & kFusedWriteSecond) {
+                kernels.copy(registers.row(seq[1].dest), second, lanes);
+            }
+            if (!result) {
+                GPU_SIM_ADVANCE(2);
+            }
+            (seq->op == DecodedOp::LoadLoadAddStore ? kernels.add : kernels.mul)(result, first, second, lanes);
+            if (writes & kFusedWriteResult) {
+                kernels.copy(registers.row(seq[2].dest), result, lanes);
+            }
+            GPU_SIM_ADVANCE(4);
+        }
+        GPU_SIM_OP(AddStore):
+        GPU_SIM_OP(MulStore): {
+            int* result = GPU_SIM_CAN_FUSE(2)
+                ? global_memory.acquireWriteSpan(in[1].mem_address + first_thread_id, lanes) : nullptr;
+            if (!result) {
+                GPU_SIM_UNFUSED();
+            }
+            const LaneKernels::BinaryFn op = in->op == DecodedOp::AddStore ? kernels.add : kernels.mul;
+            const int* src1 = registers.row(in->src1);
+            const int* src2 = registers.row(in->src2);
+            if (in->modifier & kFusedWriteResult) {
+                int* dest = registers.row(in->dest);
+                op(dest, src1, src2, lanes);
+                kernels.copy(result, dest, lanes);
+            } else {
+                op(result, src1, src2, lanes);
+            }
+            GPU_SIM_ADVANCE(2);
         }
-        for (int i = 0; i < num_threads_per_warp; ++i) {
-            threads.emplace_back(warp_id * num_threads_per_warp + i, num_registers_per_thread);
+#if !GPU_SIM_THREADED_DISPATCH
+        }
+#endif
+
+#undef GPU_SIM_CAN_FUSE
+#undef GPU_SIM_UNFUSED
+#undef GPU_SIM_ADVANCE
+#undef GPU_SIM_NEXT
+#undef GPU_SIM_CONTINUE
+#undef GPU_SIM_DISPATCH
+#undef GPU_SIM_OP
+    done:
+        if (!kIsolated && simt_depth > 0) {
+            current_instruction_index = static_cast<int>(pc);
+        }
+        return executed;
+    }
+
+    void checkConfiguration(int num_threads, int num_registers_per_thread) const {
+        if (num_threads <= 0) {
+            GPU_SIM_LOG(Warning, "Warning (Warp " << id << "): Initializing with non-positive number of threads.");
         }
-        std::cout << "Warp " << id << " initialized with " << num_threads_per_warp << " threads." << std::endl;
+        if (num_registers_per_thread <= 0) {
+            GPU_SIM_LOG(Warning, "Warning (Warp " << id << "): Initializing with non-positive number of registers.");
+        }
+    }
+
+    bool matchesKernel(const DecodedKernel& kernel) const {
+        if (kernel.getNumRegisters() != registers.getNumRegisters()) {
+            GPU_SIM_LOG(Error, "Error (Warp " << id << "): Kernel decoded for " << kernel.getNumRegisters()
+                        << " registers, warp has " << registers.getNumRegisters() << ".");
+            return false;
+        }
+        return true;
+    }
+
+public:
+    Warp(int warp_id, int num_threads_per_warp, int num_registers_per_thread)
+        : Warp(warp_id, warp_id * num_threads_per_warp, num_threads_per_warp, num_registers_per_thread) {}
+
+    // A warp whose lanes are threads first_thread_id .. first_thread_id + num_threads - 1.
+    Warp(int warp_id, int first_thread, int num_threads, int num_registers_per_thread)
+        : id(warp_id),
+          first_thread_id(first_thread),
+          registers(num_registers_per_thread, num_threads),
+          lane_width_class(LaneKernels::widthClass(num_threads)),
+          current_instruction_index(0),
+          shared_memory(nullptr),
+          shared_words(0),
+          block_thread(0),
+          simt_depth(0) {
+        checkConfiguration(num_threads, num_registers_per_thread);
+        resetControlState();
+        GPU_SIM_LOG(Trace, "Warp " << id << " initialized with " << num_threads << " threads.");
+    }
+
+    // Reinitializes a finished warp in place for a new set of threads, reusing
+    // its register file and SIMT stack storage.
+    void reset(int warp_id, int first_thread, int num_threads, int num_registers_per_thread) {
+        id = warp_id;
+        first_thread_id = first_thread;
+        registers.reset(num_registers_per_thread, num_threads);
+        lane_width_class = LaneKernels::widthClass(num_threads);
+        current_instruction_index = 0;
+        bindSharedMemory(nullptr, 0, 0);
+        checkConfiguration(num_threads, num_registers_per_thread);
+        resetControlState();
+        GPU_SIM_LOG(Trace, "Warp " << id << " initialized with " << num_threads << " threads.");
     }
 
     int getID() const {
@@ -33,83 +563,240 @@ public:
     }
 
     size_t getNumThreads() const {
-        return threads.size();
+        return static_cast<size_t>(registers.getNumLanes());
+    }
+
+    int getFirstThreadID() const {
+        return first_thread_id;
+    }
+
+    // Gives LDS/STS the words of the block's shared memory; first_thread_in_block
+    // is the index within the block of lane 0. The memory must outlive the
+    // warp's execution. reset() unbinds it.
+    void bindSharedMemory(int* memory, int words, int first_thread_in_block) {
+        shared_memory = memory;
+        shared_words = memory ? std::max(words, 0) : 0;
+        block_thread = first_thread_in_block;
+    }
+
+    int getBlockThread() const {
+        return block_thread;
+    }
+
+    // The shared memory word lane accesses when it executes instr, an LDS or
+    // STS of the kernel the warp runs.
+    int sharedAddress(const DecodedInstruction& instr, int lane) const {
+        const int* offset = registers.row(instr.op == DecodedOp::LoadShared ? instr.src1 : instr.src2);
+        return static_cast<int>(static_cast<uint32_t>(instr.mem_address + block_thread + lane)
+                                + static_cast<uint32_t>(offset[lane]));
     }
 
+    // The global memory word lane updates when it executes instr, an ATOM.
+    int atomicAddress(const DecodedInstruction& instr, int lane) const {
+        return static_cast<int>(static_cast<uint32_t>(instr.mem_address)
+                                + static_cast<uint32_t>(registers.row(instr.src2)[lane]));
+    }
+
+    // The pc of the lanes that issue next.
     int getCurrentInstructionIndex() const {
         return current_instruction_index;
     }
 
+    const WarpRegisterFile& getRegisterFile() const {
+        return registers;
+    }
+
+    // False once every lane has executed HALT or run past the kernel's end.
+    bool isActive() const {
+        return simt_depth > 0;
+    }
+
+    // Lanes that execute the next instruction.
+    const LaneMask& getActiveMask() const {
+        return simt_stack[simt_depth > 0 ? simt_depth - 1 : 0].mask;
+    }
+
+    int getActiveLaneCount() const {
+        return simt_depth > 0 ? getActiveMask().count() : 0;
+    }
+
+    size_t getSimtStackDepth() const {
+        return simt_depth;
+    }
+
+    const LaneMask& getPredicate(int index) const {
+        return predicates.at(static_cast<size_t>(index));
+    }
+
     bool executeInstruction(const Instruction& instr, GPUMemory& global_memory) {
-        bool any_thread_active = false;
-
-        for (Thread& thread : threads) {
-            switch (instr.opcode) {
-                case OpCode::ADD: {
-                    int val1 = thread.getRegister(instr.src1_reg);
-                    int val2 = thread.getRegister(instr.src2_reg);
-                    thread.setRegister(instr.dest_reg, val1 + val2);
-                    break;
-                }
-                case OpCode::MUL: {
-                    int val1 = thread.getRegister(instr.src1_reg);
-                    int val2 = thread.getRegister(instr.src2_reg);
-                    thread.setRegister(instr.dest_reg, val1 * val2);
-                    break;
-                }
-                case OpCode::LOAD: {
-                    int effective_address = instr.mem_address + thread.getID();
-                    int value = global_memory.read(effective_address);
-                    thread.setRegister(instr.dest_reg, value);
-                    break;
-                }
-                case OpCode::STORE: {
-                    int effective_address = instr.mem_address + thread.getID();
-                    int value_to_store = thread.getRegister(instr.src1_reg);
-                    global_memory.write(effective_address, value_to_store);
-                    break;
-                }
-                case OpCode::HALT:
-                    break;
-                default:
-                    std::cerr << "Error (Warp " << id << "): Unknown opcode encountered: "
-                              << instr.opcodeToString() << std::endl;
-                    break;
-            }
-            thread.incrementPC();
-            any_thread_active = true;
+        MemoryPort port(global_memory);
+        return executeInstruction(instr, port);
+    }
+
+    // Executes instr on its own for the active lanes and advances the pc. The
+    // instruction is decoded (and its operands validated) on every call;
+    // branches need their kernel and are rejected here, use step() or run().
+    bool executeInstruction(const Instruction& instr, MemoryPort& global_memory) {
+        if (instr.isControlFlow()) {
+            GPU_SIM_LOG(Error, "Error (Warp " << id << "): " << instr.toString()
+                        << " can only execute as part of a kernel.");
+            current_instruction_index++;
+            return isActive();
+        }
+        bool valid = true;
+        DecodedInstruction decoded = DecodedKernel::decode(instr, registers.getNumRegisters(), valid, SIZE_MAX);
+        if (!valid) {
+            GPU_SIM_LOG(Error, "Error (Warp " << id << "): Invalid operands in " << instr.toString()
+                        << ". Max register index: " << registers.getNumRegisters() - 1);
         }
+        dispatch<true>(&decoded, 1, nullptr, 1, global_memory);
+        return isActive();
+    }
 
-        current_instruction_index++;
+    // Executes the instruction at the warp's pc for its active lanes. Returns
+    // false once every lane has exited.
+    bool step(const DecodedKernel& kernel, MemoryPort& global_memory) {
+        if (!matchesKernel(kernel)) {
+            return false;
+        }
+        dispatch<false>(kernel.data(), kernel.size(), &kernel, 1, global_memory);
+        return isActive();
+    }
 
-        return instr.opcode != OpCode::HALT;
+    // Runs the warp until every lane has exited or max_instructions have
+    // executed, without returning to a scheduler in between, using the
+    // kernel's superinstructions. Returns the number of original
+    // instructions executed. When it stops before the warp exits, a register
+    // a superinstruction did not write can still hold its older value; the
+    // kernel overwrites it before reading it.
+    size_t run(const DecodedKernel& kernel, MemoryPort& global_memory, size_t max_instructions = SIZE_MAX) {
+        if (!matchesKernel(kernel)) {
+            return 0;
+        }
+        return dispatch<false>(kernel.fusedData(), kernel.size(), &kernel, max_instructions, global_memory);
     }
 
     void initializeThreadRegisters(int reg_idx, int initial_value_base) {
-        for (int i = 0; i < threads.size(); ++i) {
-            threads[i].setRegister(reg_idx, initial_value_base + threads[i].getID());
+        int* row = destRow(reg_idx);
+        if (!row) {
+            return;
+        }
+        for (int lane = 0; lane < registers.getNumLanes(); ++lane) {
+            row[lane] = initial_value_base + first_thread_id + lane;
         }
     }
 
     void setThreadsRegister(int reg_idx, int value) {
-        for (Thread& thread : threads) {
-            thread.setRegister(reg_idx, value);
+        int* row = destRow(reg_idx);
+        if (!row) {
+            return;
         }
+        std::fill(row, row + registers.getNumLanes(), value);
     }
 
     void printWarpState() const {
         std::cout << "\n--- Warp " << id << " State (Current Instruction Index: "
                   << current_instruction_index << ") ---" << std::endl;
-        for (const Thread& thread : threads) {
-            thread.printRegisters();
+        for (size_t lane = 0; lane < getNumThreads(); ++lane) {
+            getThread(lane).printRegisters();
         }
         std::cout << "--------------------------------------------------------" << std::endl;
     }
 
-    const Thread& getThread(size_t index) const {
-        if (index >= threads.size()) {
+    // The pc a lane resumes at: that of the topmost SIMT entry holding it, or
+    // the warp's pc once it has exited.
+    int lanePC(int lane) const {
+        for (size_t i = simt_depth; i > 0; --i) {
+            if (simt_stack[i - 1].mask.test(lane)) {
+                return i == simt_depth ? current_instruction_index : simt_stack[i - 1].pc;
+            }
+        }
+        return current_instruction_index;
+    }
+
+    // Writes the warp's identity, registers, pc, SIMT stack and predicates,
+    // and its place in its block. The shared memory itself belongs to the
+    // block and is saved by the SM.
+    void saveState(CheckpointWriter& writer) const {
+        const int lanes = registers.getNumLanes();
+        writer.write<int32_t>(id);
+        writer.write<int32_t>(first_thread_id);
+        writer.write<int32_t>(registers.getNumRegisters());
+        writer.write<int32_t>(lanes);
+        writer.write<int32_t>(current_instruction_index);
+        writer.write<int32_t>(block_thread);
+        for (int reg = 0; reg < registers.getNumRegisters(); ++reg) {
+            const int* row = registers.row(reg);
+            for (int lane = 0; lane < lanes; ++lane) {
+                writer.write<int32_t>(row[lane]);
+            }
+        }
+        writer.write<uint64_t>(simt_depth);
+        for (size_t i = 0; i < simt_depth; ++i) {
+            writer.write<int32_t>(simt_stack[i].pc);
+            writer.write<int32_t>(simt_stack[i].reconvergence_pc);
+            writer.writeVector(simt_stack[i].mask.getWords());
+        }
+        for (const LaneMask& predicate : predicates) {
+            writer.writeVector(predicate.getWords());
+        }
+    }
+
+    // Replaces this warp with one saved by saveState(). Its shared memory is
+    // left unbound; rebind it with bindSharedMemory(..., getBlockThread()).
+    bool restoreState(CheckpointReader& reader) {
+        int32_t warp_id = 0, first_thread = 0, num_registers = 0, lanes = 0, pc = 0, thread_in_block = 0;
+        reader.read(warp_id);
+        reader.read(first_thread);
+        reader.read(num_registers);
+        reader.read(lanes);
+        reader.read(pc);
+        reader.read(thread_in_block);
+        if (!reader.ok() || num_registers < 0 || lanes < 0) {
+            return reader.fail();
+        }
+        reset(warp_id, first_thread, lanes, num_registers);
+        current_instruction_index = pc;
+        block_thread = thread_in_block;
+        for (int reg = 0; reg < num_registers; ++reg) {
+            int* row = registers.row(reg);
+            for (int lane = 0; lane < lanes; ++lane) {
+                int32_t value = 0;
+                reader.read(value);
+                row[lane] = value;
+            }
+        }
+        uint64_t depth = 0;
+        reader.read(depth);
+        std::vector<uint64_t> words;
+        simt_depth = 0;
+        for (uint64_t i = 0; i < depth; ++i) {
+            int32_t entry_pc = 0, reconvergence_pc = 0;
+            reader.read(entry_pc);
+            reader.read(reconvergence_pc);
+            reader.readVector(words);
+            LaneMask mask;
+            if (!reader.ok() || !mask.assignWords(lanes, words)) {
+                return reader.fail();
+            }
+            pushEntry(entry_pc, reconvergence_pc, mask);
+        }
+        for (LaneMask& predicate : predicates) {
+            if (!reader.readVector(words) || !predicate.assignWords(lanes, words)) {
+                return reader.fail();
+            }
+        }
+        return true;
+    }
+
+    // Returns a view of one lane that reads the warp's register file directly.
+    Thread getThread(size_t index) const {
+        if (index >= getNumThreads()) {
             throw std::out_of_range("Thread index out of bounds in Warp::getThread");
         }
-        return threads[index];
+        const int* lane_registers = registers.row(0) + index;
+        return Thread(first_thread_id + static_cast<int>(index), lane_registers,
+                      registers.getNumRegisters(), registers.getLaneStride(),
+                      lanePC(static_cast<int>(index)));
     }
 };
@@ -0,0 +1,289 @@
+// src/arch/WarpScheduler.h
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include "../sim/Checkpoint.h"
+
+enum class SchedulerPolicy {
+    LooseRoundRobin,
+    GreedyThenOldest,
+    TwoLevel
+};
+
+inline const char* schedulerPolicyToString(SchedulerPolicy policy) {
+    switch (policy) {
+        case SchedulerPolicy::LooseRoundRobin:  return "LRR";
+        case SchedulerPolicy::GreedyThenOldest: return "GTO";
+        case SchedulerPolicy::TwoLevel:         return "TwoLevel";
+        default:                                return "UNKNOWN_POLICY";
+    }
+}
+
+// Per-SM warp issue policy. The ShaderCore reports warps entering and leaving
+// its resident slots and, every cycle, asks the scheduler which eligible slots
+// issue an instruction. Slots are indices into the SM's resident warp array.
+class WarpScheduler {
+protected:
+    // Admission order of the warp currently in each slot; smaller is older.
+    std::vector<uint64_t> slot_age;
+    uint64_t next_age = 0;
+
+public:
+    virtual ~WarpScheduler() = default;
+
+    virtual SchedulerPolicy getPolicy() const = 0;
+
+    virtual void reset() {
+        slot_age.clear();
+        next_age = 0;
+    }
+
+    virtual void onWarpAdmitted(size_t slot) {
+        if (slot >= slot_age.size()) {
+            slot_age.resize(slot + 1, 0);
+        }
+        slot_age[slot] = next_age++;
+    }
+
+    virtual void onWarpRetired(size_t /*slot*/) {}
+
+    // Policy state for checkpoints; restoring needs a scheduler of the same
+    // policy (and, for two-level, active set size).
+    virtual void saveState(CheckpointWriter& writer) const {
+        writer.writeVector(slot_age);
+        writer.write(next_age);
+    }
+
+    virtual bool restoreState(CheckpointReader& reader) {
+        reader.readVector(slot_age);
+        reader.read(next_age);
+        return reader.ok();
+    }
+
+    // Appends up to issue_width slots to `selected`, each with eligible[slot]
+    // set, in the order they issue this cycle.
+    virtual void selectWarps(const std::vector<char>& eligible, int issue_width,
+                             std::vector<size_t>& selected) = 0;
+};
+
+// Loose round-robin: rotate through the slots, starting after the last warp
+// that issued, skipping warps that cannot issue.
+class LooseRoundRobinScheduler : public WarpScheduler {
+private:
+    size_t next_slot = 0;
+
+public:
+    SchedulerPolicy getPolicy() const override {
+        return SchedulerPolicy::LooseRoundRobin;
+    }
+
+    void reset() override {
+        WarpScheduler::reset();
+        next_slot = 0;
+    }
+
+    void saveState(CheckpointWriter& writer) const override {
+        WarpScheduler::saveState(writer);
+        writer.write<uint64_t>(next_slot);
+    }
+
+    bool restoreState(CheckpointReader& reader) override {
+        uint64_t slot = 0;
+        WarpScheduler::restoreState(reader);
+        reader.read(slot);
+        next_slot = static_cast<size_t>(slot);
+        return reader.ok();
+    }
+
+    void selectWarps(const std::vector<char>& eligible, int issue_width,
+                     std::vector<size_t>& selected) override {
+        size_t num_slots = eligible.size();
+        for (size_t k = 0; k < num_slots && static_cast<int>(selected.size()) < issue_width; ++k) {
+            size_t slot = (next_slot + k) % num_slots;
+            if (eligible[slot]) {
+                selected.push_back(slot);
+            }
+        }
+        if (!selected.empty()) {
+            next_slot = (selected.back() + 1) % num_slots;
+        }
+    }
+};
+
+// Greedy-then-oldest: keep issuing from the same warp while it can issue,
+// otherwise fall back to the oldest eligible warp.
+class GreedyThenOldestScheduler : public WarpScheduler {
+private:
+    static constexpr size_t kNoWarp = static_cast<size_t>(-1);
+    size_t greedy_slot = kNoWarp;
+    std::vector<size_t> by_age;
+
+public:
+    SchedulerPolicy getPolicy() const override {
+        return SchedulerPolicy::GreedyThenOldest;
+    }
+
+    void reset() override {
+        WarpScheduler::reset();
+        greedy_slot = kNoWarp;
+    }
+
+    void saveState(CheckpointWriter& writer) const override {
+        WarpScheduler::saveState(writer);
+        writer.write<uint64_t>(greedy_slot);
+    }
+
+    bool restoreState(CheckpointReader& reader) override {
+        uint64_t slot = 0;
+        WarpScheduler::restoreState(reader);
+        reader.read(slot);
+        greedy_slot = static_cast<size_t>(slot);
+        return reader.ok();
+    }
+
+    void onWarpRetired(size_t slot) override {
+        if (slot == greedy_slot) {
+            greedy_slot = kNoWarp;
+        }
+    }
+
+    void selectWarps(const std::vector<char>& eligible, int issue_width,
+                     std::vector<size_t>& selected) override {
+        if (greedy_slot < eligible.size() && eligible[greedy_slot] && issue_width > 0) {
+            selected.push_back(greedy_slot);
+        }
+        if (static_cast<int>(selected.size()) < issue_width) {
+            by_age.clear();
+            for (size_t slot = 0; slot < eligible.size(); ++slot) {
+                if (eligible[slot] && slot != greedy_slot) {
+                    by_age.push_back(slot);
+                }
+            }
+            std::sort(by_age.begin(), by_age.end(),
+                      [this](size_t a, size_t b) { return slot_age[a] < slot_age[b]; });
+            for (size_t k = 0; k < by_age.size() && static_cast<int>(selected.size()) < issue_width; ++k) {
+                selected.push_back(by_age[k]);
+            }
+        }
+        if (!selected.empty()) {
+            greedy_slot = selected.front();
+        }
+    }
+};
+
+// Two-level: only a small active set of warps competes for issue (round-robin
+// within the set). Warps that cannot issue are demoted to the pending queue
+// and replaced by the oldest pending warp that can.
+class TwoLevelScheduler : public WarpScheduler {
+private:
+    size_t active_set_size;
+    std::vector<size_t> active_set;
+    std::deque<size_t> pending;
+    size_t next_index = 0;
+
+    static void removeSlot(std::vector<size_t>& slots, size_t slot) {
+        slots.erase(std::remove(slots.begin(), slots.end(), slot), slots.end());
+    }
+
+public:
+    explicit TwoLevelScheduler(size_t active_warps)
+        : active_set_size(active_warps == 0 ? 1 : active_warps) {}
+
+    SchedulerPolicy getPolicy() const override {
+        return SchedulerPolicy::TwoLevel;
+    }
+
+    size_t getActiveSetSize() const {
+        return active_set_size;
+    }
+
+    void reset() override {
+        WarpScheduler::reset();
+        active_set.clear();
+        pending.clear();
+        next_index = 0;
+    }
+
+    void saveState(CheckpointWriter& writer) const override {
+        WarpScheduler::saveState(writer);
+        std::vector<uint64_t> slots(active_set.begin(), active_set.end());
+        writer.writeVector(slots);
+        slots.assign(pending.begin(), pending.end());
+        writer.writeVector(slots);
+        writer.write<uint64_t>(next_index);
+    }
+
+    bool restoreState(CheckpointReader& reader) override {
+        std::vector<uint64_t> slots;
+        uint64_t index = 0;
+        WarpScheduler::restoreState(reader);
+        reader.readVector(slots);
+        active_set.assign(slots.begin(), slots.end());
+        reader.readVector(slots);
+        pending.assign(slots.begin(), slots.end());
+        reader.read(index);
+        next_index = static_cast<size_t>(index);
+        return reader.ok();
+    }
+
+    void onWarpAdmitted(size_t slot) override {
+        WarpScheduler::onWarpAdmitted(slot);
+        pending.push_back(slot);
+    }
+
+    void onWarpRetired(size_t slot) override {
+        removeSlot(active_set, slot);
+        pending.erase(std::remove(pending.begin(), pending.end(), slot), pending.end());
+    }
+
+    void selectWarps(const std::vector<char>& eligible, int issue_width,
+                     std::vector<size_t>& selected) override {
+        // Demote active warps that cannot issue, if an eligible pending warp
+        // can take their place.
+        for (size_t i = 0; i < active_set.size(); ++i) {
+            if (eligible[active_set[i]]) {
+                continue;
+            }
+            auto replacement = std::find_if(pending.begin(), pending.end(),
+                                            [&](size_t slot) { return eligible[slot] != 0; });
+            if (replacement == pending.end()) {
+                break;
+            }
+            size_t promoted = *replacement;
+            pending.erase(replacement);
+            pending.push_back(active_set[i]);
+            active_set[i] = promoted;
+        }
+        while (active_set.size() < active_set_size && !pending.empty()) {
+            active_set.push_back(pending.front());
+            pending.pop_front();
+        }
+
+        size_t num_active = active_set.size();
+        size_t start = num_active > 0 ? next_index % num_active : 0;
+        for (size_t k = 0; k < num_active && static_cast<int>(selected.size()) < issue_width; ++k) {
+            size_t index = (start + k) % num_active;
+            if (eligible[active_set[index]]) {
+                selected.push_back(active_set[index]);
+                next_index = index + 1;
+            }
+        }
+    }
+};
+
+inline std::unique_ptr<WarpScheduler> makeWarpScheduler(SchedulerPolicy policy, size_t two_level_active_warps = 4) {
+    switch (policy) {
+        case SchedulerPolicy::GreedyThenOldest:
+            return std::make_unique<GreedyThenOldestScheduler>();
+        case SchedulerPolicy::TwoLevel:
+            return std::make_unique<TwoLevelScheduler>(two_level_active_warps);
+        case SchedulerPolicy::LooseRoundRobin:
+        default:
+            return std::make_unique<LooseRoundRobinScheduler>();
+    }
+}
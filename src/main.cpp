@@ -2,6 +2,8 @@
 // Removed #pragma once here as it's typically not used in .cpp files, only headers.
 
 #include <iostream>
+#include <string>
+#include <vector>
 #include "arch/Instruction.h"
 #include "memory/GPUMemory.h"
 #include "arch/Thread.h"
@@ -9,6 +11,8 @@
 #include "arch/ShaderCore.h"
 #include "sim/GPUSimulator.h"
 #include "sim/Profiler.h"
+#include "sim/Log.h"
+#include "sim/KernelCache.h"
 
 // Helper function to create a simple kernel for testing
 KernelProgram create_simple_add_kernel() {
@@ -21,7 +25,41 @@ KernelProgram create_simple_add_kernel() {
     return kernel;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // --quiet suppresses the simulator's execution trace; only warnings,
+    // errors and the explicitly requested dumps below are printed.
+    // --trace-file <path> streams every memory access to a binary trace that
+    // gpu_sim_trace can analyze.
+    // --kernel <file> runs an assembly kernel instead of the built-in one, and
+    // --kernel-cache <dir> keeps its decoded form in <dir> for later runs.
+    // --hotspots prints the per-instruction hotspot report after the summary.
+    // --timeline <path> writes SM and warp activity as a Chrome trace.
+    bool quiet = false;
+    bool hotspots = false;
+    std::string trace_file;
+    std::string timeline_file;
+    std::string kernel_file;
+    std::string kernel_cache_dir;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--trace-file" && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (arg == "--kernel" && i + 1 < argc) {
+            kernel_file = argv[++i];
+        } else if (arg == "--kernel-cache" && i + 1 < argc) {
+            kernel_cache_dir = argv[++i];
+        } else if (arg == "--timeline" && i + 1 < argc) {
+            timeline_file = argv[++i];
+        } else if (arg == "--hotspots") {
+            hotspots = true;
+        }
+    }
+    if (quiet) {
+        Log::setLevel(LogLevel::Warning);
+    }
+
     std::cout << "Starting CppGPUSimulator full system test with Profiler..." << std::endl;
 
     // --- GPU Configuration ---
@@ -32,37 +70,78 @@ int main() {
 
     // --- Instantiate the GPUSimulator ---
     GPUSimulator gpu_simulator(GLOBAL_MEMORY_SIZE, NUM_SMS, THREADS_PER_WARP, WARPS_PER_SM);
+    for (int sm_id = 0; sm_id < NUM_SMS; ++sm_id) {
+        gpu_simulator.enableWarpStateDumpsForSM(sm_id);
+    }
+    // Keep a small sampled trace so the summary can show recent operations.
+    gpu_simulator.getProfiler().setMemoryTracing(64);
+    if (!trace_file.empty()) {
+        gpu_simulator.getProfiler().openTraceFile(trace_file);
+    }
+    if (!timeline_file.empty()) {
+        gpu_simulator.getProfiler().openTimelineFile(timeline_file);
+    }
 
     // --- Prepare Input Data in Global Memory ---
     const int TEST_TOTAL_THREADS = 8; // 2 warps * 4 threads/warp
     std::cout << "\n--- Preparing Global Memory with Input Data ---" << std::endl;
     GPUMemory& global_mem = gpu_simulator.getGlobalMemory();
 
+    // One buffer holds the kernel's input A at 0, input B at 100 and output
+    // at 200, the fixed addresses its LOAD/STORE instructions use.
+    DeviceBuffer<int> kernel_data = gpu_simulator.deviceMalloc<int>(300);
+    std::vector<int> input_a(TEST_TOTAL_THREADS);
+    std::vector<int> input_b(TEST_TOTAL_THREADS);
     for (int i = 0; i < TEST_TOTAL_THREADS; ++i) {
-        global_mem.write(0 + i, (i + 1) * 10);
-        global_mem.write(100 + i, (i + 1) * 2);
+        input_a[i] = (i + 1) * 10;
+        input_b[i] = (i + 1) * 2;
     }
+    gpu_simulator.memset(kernel_data, 0);
+    gpu_simulator.memcpyHostToDevice(kernel_data, input_a.data(), input_a.size(), 0);
+    gpu_simulator.memcpyHostToDevice(kernel_data, input_b.data(), input_b.size(), 100);
 
     global_mem.printMemory(0, TEST_TOTAL_THREADS);
     global_mem.printMemory(100, 100 + TEST_TOTAL_THREADS);
     global_mem.printMemory(200, 200 + TEST_TOTAL_THREADS);
 
     // --- Define the Kernel Program ---
-    KernelProgram add_kernel = create_simple_add_kernel();
+    KernelCache kernel_cache(kernel_cache_dir);
+    std::shared_ptr<const DecodedKernel> add_kernel;
+    std::string kernel_name = "SimpleAddKernel";
+    if (kernel_file.empty()) {
+        add_kernel = kernel_cache.get(create_simple_add_kernel(), GPUSimulator::getRegistersPerThread());
+    } else {
+        std::string source;
+        if (KernelAssembler::readSource(kernel_file, source)) {
+            add_kernel = kernel_cache.getFromText(source, GPUSimulator::getRegistersPerThread());
+        }
+        // Name assembly kernels after their file, without directory or extension.
+        kernel_name = kernel_file.substr(kernel_file.find_last_of('/') + 1);
+        kernel_name = kernel_name.substr(0, kernel_name.find('.'));
+    }
+    if (!add_kernel) {
+        std::cerr << "Could not load kernel " << kernel_file << "." << std::endl;
+        return 1;
+    }
     std::cout << "\n--- Kernel Program to be Launched ---" << std::endl;
-    for (const auto& instr : add_kernel) {
+    for (const auto& instr : add_kernel->getSource()) {
         std::cout << "  - " << instr.toString() << std::endl;
     }
 
     // --- Launch the Kernel ---
-    gpu_simulator.launchKernel(add_kernel, 1, 1, 1, TEST_TOTAL_THREADS, 1, 1);
+    gpu_simulator.launchKernel(*add_kernel, 2, 1, 1, TEST_TOTAL_THREADS / 2, 1, 1, kernel_name);
 
     // --- Verify Final Output in Global Memory ---
     std::cout << "\n--- Final Global Memory State (Output Region) ---" << std::endl;
     global_mem.printMemory(200, 200 + TEST_TOTAL_THREADS);
 
+    gpu_simulator.deviceFree(kernel_data);
+
     // --- Print Profiling Summary ---
     gpu_simulator.getProfiler().printSummary();
+    if (hotspots) {
+        gpu_simulator.getProfiler().printHotspotReport();
+    }
 
     std::cout << "\nCppGPUSimulator full system test finished." << std::endl;
 
@@ -0,0 +1,102 @@
+// src/memory/AtomicUnit.h
+#pragma once
+
+#include "../sim/Checkpoint.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+// Timing of ATOM instructions seen by one SM. Updates of one word are
+// serialized and take cycles_per_update cycles each; updates of different
+// words proceed in parallel. 0 turns off contention modeling, so an atomic
+// then costs only its memory request.
+struct AtomicTimingConfig {
+    int cycles_per_update = 1;
+};
+
+// Contention model of one SM's atomics. The lanes of a warp that hit the
+// same word queue behind each other, and behind the earlier warps' updates
+// of that word still in flight. SMs are modeled independently, since they
+// advance through their own cycles; contention between SMs is not charged.
+class AtomicUnit {
+private:
+    // Entries whose updates have finished are dropped once this many words
+    // are tracked.
+    static constexpr size_t kMaxTrackedWords = 1 << 16;
+
+    AtomicTimingConfig config;
+    std::unordered_map<int, long long> word_free_cycle;    // Cycle a word's queued updates finish.
+    std::vector<int> sorted_addresses;                      // Reused across accesses.
+
+public:
+    void setConfig(const AtomicTimingConfig& new_config) {
+        config = new_config;
+        config.cycles_per_update = std::max(config.cycles_per_update, 0);
+    }
+
+    const AtomicTimingConfig& getConfig() const {
+        return config;
+    }
+
+    void reset() {
+        word_free_cycle.clear();
+    }
+
+    // Queues the updates of one warp access at cycle and returns the cycle
+    // its last update finishes. contention_cycles receives how much later
+    // that is than a single uncontended update would finish.
+    long long issue(long long cycle, const int* addresses, int count, long long& contention_cycles) {
+        contention_cycles = 0;
+        if (count <= 0 || config.cycles_per_update == 0) {
+            return cycle + 1;
+        }
+        if (word_free_cycle.size() > kMaxTrackedWords) {
+            for (auto it = word_free_cycle.begin(); it != word_free_cycle.end();) {
+                it = it->second <= cycle ? word_free_cycle.erase(it) : std::next(it);
+            }
+        }
+        sorted_addresses.assign(addresses, addresses + count);
+        std::sort(sorted_addresses.begin(), sorted_addresses.end());
+        long long done = cycle;
+        for (size_t i = 0; i < sorted_addresses.size();) {
+            size_t end = i + 1;
+            while (end < sorted_addresses.size() && sorted_addresses[end] == sorted_addresses[i]) {
+                ++end;
+            }
+            long long& free_cycle = word_free_cycle[sorted_addresses[i]];
+            free_cycle = std::max(free_cycle, cycle) + static_cast<long long>(end - i) * config.cycles_per_update;
+            done = std::max(done, free_cycle);
+            i = end;
+        }
+        contention_cycles = done - (cycle + config.cycles_per_update);
+        return done;
+    }
+
+    // Configuration and the queued updates, which a launch stopped for a
+    // checkpoint still has in flight.
+    void saveState(CheckpointWriter& writer) const {
+        writer.write(config);
+        std::vector<int64_t> entries;
+        for (const auto& word : word_free_cycle) {
+            entries.push_back(word.first);
+            entries.push_back(word.second);
+        }
+        writer.writeVector(entries);
+    }
+
+    bool restoreState(CheckpointReader& reader) {
+        AtomicTimingConfig saved_config;
+        std::vector<int64_t> entries;
+        if (!reader.read(saved_config) || !reader.readVector(entries) || entries.size() % 2 != 0) {
+            return reader.fail();
+        }
+        setConfig(saved_config);
+        word_free_cycle.clear();
+        for (size_t i = 0; i < entries.size(); i += 2) {
+            word_free_cycle[static_cast<int>(entries[i])] = entries[i + 1];
+        }
+        return true;
+    }
+};
@@ -0,0 +1,378 @@
+// src/memory/Cache.h
+#pragma once
+
+#include "../sim/Log.h"
+#include "../sim/Checkpoint.h"
+
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+enum class ReplacementPolicy {
+    LRU,
+    PLRU,
+    Random
+};
+
+enum class WritePolicy {
+    WriteBack,     // Write-allocate; dirty lines are written back on eviction.
+    WriteThrough   // No-write-allocate; every write is forwarded to the next level.
+};
+
+enum class CacheLevel : uint8_t {
+    L1,
+    L2
+};
+
+constexpr size_t kNumCacheLevels = 2;
+
+inline const char* cacheLevelToString(CacheLevel level) {
+    switch (level) {
+        case CacheLevel::L1: return "L1";
+        case CacheLevel::L2: return "L2";
+        default:             return "UNKNOWN_LEVEL";
+    }
+}
+
+inline const char* replacementPolicyToString(ReplacementPolicy policy) {
+    switch (policy) {
+        case ReplacementPolicy::LRU:    return "LRU";
+        case ReplacementPolicy::PLRU:   return "PLRU";
+        case ReplacementPolicy::Random: return "Random";
+        default:                        return "UNKNOWN_POLICY";
+    }
+}
+
+// A size_bytes of 0 disables the cache.
+struct CacheConfig {
+    size_t size_bytes = 0;
+    int line_bytes = 128;
+    int associativity = 4;
+    ReplacementPolicy replacement = ReplacementPolicy::LRU;
+    WritePolicy write_policy = WritePolicy::WriteBack;
+    int hit_latency = 0;
+
+    bool isEnabled() const {
+        return size_bytes > 0;
+    }
+};
+
+struct CacheStats {
+    uint64_t accesses = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+
+    void merge(const CacheStats& other) {
+        accesses += other.accesses;
+        hits += other.hits;
+        misses += other.misses;
+        evictions += other.evictions;
+        writebacks += other.writebacks;
+    }
+};
+
+struct CacheAccessResult {
+    bool hit = false;
+    bool writeback = false;            // A dirty line was evicted.
+    uint64_t writeback_address = 0;    // Byte address of the evicted line.
+};
+
+// Tag-only set-associative cache model (data stays in GPUMemory).
+//
+// State is kept structure-of-arrays so a probe touches as little memory as
+// possible: one contiguous run of 32-bit tags per set, one valid and one dirty
+// bitmask per set, and either one byte of LRU rank per line or one 64-bit
+// tree-PLRU word per set. Associativity is limited to 64 ways.
+class Cache {
+private:
+    static constexpr int kMaxWays = 64;
+
+    CacheConfig config;
+    size_t num_sets;
+    int ways;
+    std::vector<uint32_t> tags;        // [set][way]
+    std::vector<uint64_t> valid_mask;  // [set]
+    std::vector<uint64_t> dirty_mask;  // [set]
+    std::vector<uint8_t> lru_rank;     // [set][way], 0 = most recently used
+    std::vector<uint64_t> plru_bits;   // [set], tree nodes 1 .. ways - 1
+    uint64_t rng_state;
+    CacheStats stats;
+
+    static bool isPowerOfTwo(long long value) {
+        return value > 0 && (value & (value - 1)) == 0;
+    }
+
+    void touch(size_t set, int way) {
+        if (config.replacement == ReplacementPolicy::LRU) {
+            uint8_t* ranks = &lru_rank[set * ways];
+            uint8_t old_rank = ranks[way];
+            for (int w = 0; w < ways; ++w) {
+                if (ranks[w] < old_rank) {
+                    ranks[w]++;
+                }
+            }
+            ranks[way] = 0;
+        } else if (config.replacement == ReplacementPolicy::PLRU) {
+            // Point every node on the path away from the accessed way.
+            uint64_t bits = plru_bits[set];
+            size_t node = 1;
+            for (int span = ways / 2; span >= 1; span /= 2) {
+                bool right = (way & span) != 0;
+                if (right) {
+                    bits &= ~(uint64_t{1} << node);
+                } else {
+                    bits |= uint64_t{1} << node;
+                }
+                node = node * 2 + (right ? 1 : 0);
+            }
+            plru_bits[set] = bits;
+        }
+    }
+
+    int chooseVictim(size_t set) {
+        uint64_t valid = valid_mask[set];
+        for (int w = 0; w < ways; ++w) {
+            if (!(valid & (uint64_t{1} << w))) {
+                return w;
+            }
+        }
+        switch (config.replacement) {
+            case ReplacementPolicy::LRU: {
+                const uint8_t* ranks = &lru_rank[set * ways];
+                int victim = 0;
+                for (int w = 1; w < ways; ++w) {
+                    if (ranks[w] > ranks[victim]) {
+                        victim = w;
+                    }
+                }
+                return victim;
+            }
+            case ReplacementPolicy::PLRU: {
+                uint64_t bits = plru_bits[set];
+                size_t node = 1;
+                int way = 0;
+                for (int span = ways / 2; span >= 1; span /= 2) {
+                    bool right = (bits >> node) & 1;
+                    if (right) {
+                        way |= span;
+                    }
+                    node = node * 2 + (right ? 1 : 0);
+                }
+                return way;
+            }
+            case ReplacementPolicy::Random:
+            default: {
+                rng_state ^= rng_state << 13;
+                rng_state ^= rng_state >> 7;
+                rng_state ^= rng_state << 17;
+                return static_cast<int>(rng_state % static_cast<uint64_t>(ways));
+            }
+        }
+    }
+
+public:
+    explicit Cache(const CacheConfig& cache_config = CacheConfig()) {
+        configure(cache_config);
+    }
+
+    void configure(const CacheConfig& cache_config) {
+        config = cache_config;
+        if (config.isEnabled()) {
+            if (!isPowerOfTwo(config.line_bytes) || config.line_bytes < static_cast<int>(sizeof(int))) {
+                GPU_SIM_LOG(Warning, "Warning: Cache line size " << config.line_bytes << " is not a power of two; using 128.");
+                config.line_bytes = 128;
+            }
+            if (config.associativity < 1 || config.associativity > kMaxWays) {
+                GPU_SIM_LOG(Warning, "Warning: Cache associativity " << config.associativity << " unsupported; using 4.");
+                config.associativity = 4;
+            }
+            if (config.replacement == ReplacementPolicy::PLRU && !isPowerOfTwo(config.associativity)) {
+                GPU_SIM_LOG(Warning, "Warning: PLRU needs a power-of-two associativity; using LRU.");
+                config.replacement = ReplacementPolicy::LRU;
+            }
+        }
+        ways = config.associativity;
+        size_t set_bytes = static_cast<size_t>(config.line_bytes) * ways;
+        num_sets = config.isEnabled() ? std::max<size_t>(config.size_bytes / set_bytes, 1) : 0;
+        invalidateAll();
+        stats = CacheStats();
+    }
+
+    const CacheConfig& getConfig() const {
+        return config;
+    }
+
+    bool isEnabled() const {
+        return config.isEnabled();
+    }
+
+    size_t getNumSets() const {
+        return num_sets;
+    }
+
+    void invalidateAll() {
+        tags.assign(num_sets * ways, 0);
+        valid_mask.assign(num_sets, 0);
+        dirty_mask.assign(num_sets, 0);
+        lru_rank.clear();
+        if (config.replacement == ReplacementPolicy::LRU) {
+            lru_rank.resize(num_sets * ways);
+            for (size_t set = 0; set < num_sets; ++set) {
+                for (int w = 0; w < ways; ++w) {
+                    lru_rank[set * ways + w] = static_cast<uint8_t>(w);
+                }
+            }
+        }
+        plru_bits.assign(config.replacement == ReplacementPolicy::PLRU ? num_sets : 0, 0);
+        rng_state = 0x9E3779B97F4A7C15ull;
+    }
+
+    CacheAccessResult access(uint64_t byte_address, bool is_write) {
+        CacheAccessResult result;
+        if (!isEnabled()) {
+            return result;
+        }
+        stats.accesses++;
+
+        uint64_t line = byte_address / static_cast<uint64_t>(config.line_bytes);
+        size_t set = static_cast<size_t>(line % num_sets);
+        uint32_t tag = static_cast<uint32_t>(line / num_sets);
+        const uint32_t* set_tags = &tags[set * ways];
+        uint64_t valid = valid_mask[set];
+
+        for (int w = 0; w < ways; ++w) {
+            if ((valid & (uint64_t{1} << w)) && set_tags[w] == tag) {
+                stats.hits++;
+                result.hit = true;
+                if (is_write && config.write_policy == WritePolicy::WriteBack) {
+                    dirty_mask[set] |= uint64_t{1} << w;
+                }
+                touch(set, w);
+                return result;
+            }
+        }
+
+        stats.misses++;
+        if (is_write && config.write_policy == WritePolicy::WriteThrough) {
+            return result;
+        }
+
+        int victim = chooseVictim(set);
+        uint64_t victim_bit = uint64_t{1} << victim;
+        if (valid & victim_bit) {
+            stats.evictions++;
+            if (dirty_mask[set] & victim_bit) {
+                stats.writebacks++;
+                result.writeback = true;
+                uint64_t victim_line = static_cast<uint64_t>(tags[set * ways + victim]) * num_sets + set;
+                result.writeback_address = victim_line * static_cast<uint64_t>(config.line_bytes);
+            }
+        }
+        tags[set * ways + victim] = tag;
+        valid_mask[set] |= victim_bit;
+        if (is_write && config.write_policy == WritePolicy::WriteBack) {
+            dirty_mask[set] |= victim_bit;
+        } else {
+            dirty_mask[set] &= ~victim_bit;
+        }
+        touch(set, victim);
+        return result;
+    }
+
+    const CacheStats& getStats() const {
+        return stats;
+    }
+
+    // Returns the counters accumulated since the last call and resets them.
+    CacheStats takeStats() {
+        CacheStats taken = stats;
+        stats = CacheStats();
+        return taken;
+    }
+
+    // Configuration, contents and replacement state, for checkpoints.
+    void saveState(CheckpointWriter& writer) const {
+        writer.write(config);
+        writer.writeVector(tags);
+        writer.writeVector(valid_mask);
+        writer.writeVector(dirty_mask);
+        writer.writeVector(lru_rank);
+        writer.writeVector(plru_bits);
+        writer.write(rng_state);
+        writer.write(stats);
+    }
+
+    bool restoreState(CheckpointReader& reader) {
+        CacheConfig saved_config;
+        if (!reader.read(saved_config)) {
+            return false;
+        }
+        configure(saved_config);
+        size_t num_tags = tags.size(), num_ranks = lru_rank.size(), num_plru = plru_bits.size();
+        reader.readVector(tags);
+        reader.readVector(valid_mask);
+        reader.readVector(dirty_mask);
+        reader.readVector(lru_rank);
+        reader.readVector(plru_bits);
+        reader.read(rng_state);
+        reader.read(stats);
+        if (!reader.ok() || tags.size() != num_tags || valid_mask.size() != num_sets
+            || dirty_mask.size() != num_sets || lru_rank.size() != num_ranks || plru_bits.size() != num_plru) {
+            invalidateAll();
+            return reader.fail();
+        }
+        return true;
+    }
+};
+
+// A Cache shared by every SM (the L2). Accesses are serialized with a mutex so
+// SMs running on different host threads can probe it concurrently; the
+// interleaving, and therefore hit/miss counts, then depends on host timing.
+class SharedCache {
+private:
+    Cache cache;
+    std::mutex mutex;
+
+public:
+    explicit SharedCache(const CacheConfig& config) : cache(config) {}
+
+    const CacheConfig& getConfig() const {
+        return cache.getConfig();
+    }
+
+    CacheAccessResult access(uint64_t byte_address, bool is_write) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache.access(byte_address, is_write);
+    }
+
+    CacheStats takeStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache.takeStats();
+    }
+
+    // A copy of the contents, replacement state and counters, which
+    // restore() puts back, e.g. to undo a launch that is run again.
+    Cache snapshot() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache;
+    }
+
+    void restore(const Cache& saved) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cache = saved;
+    }
+
+    void saveState(CheckpointWriter& writer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cache.saveState(writer);
+    }
+
+    bool restoreState(CheckpointReader& reader) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache.restoreState(reader);
+    }
+};
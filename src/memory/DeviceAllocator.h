@@ -0,0 +1,332 @@
+// src/memory/DeviceAllocator.h
+#pragma once
+
+#include "GPUMemory.h"
+#include "../sim/Profiler.h"
+#include "../sim/Log.h"
+#include "../sim/Checkpoint.h"
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
+#include <iterator>
+#include <climits>
+#include <type_traits>
+
+// Typed handle to a block of global memory handed out by DeviceAllocator.
+// Like a device pointer it does not own the block: copies refer to the same
+// memory, and the block lives until it is freed. Elements are 32-bit words,
+// the unit global memory is addressed in.
+template <typename T>
+class DeviceBuffer {
+    static_assert(sizeof(T) == sizeof(int) && std::is_trivially_copyable<T>::value,
+                  "DeviceBuffer elements must be trivially copyable 32-bit words.");
+
+private:
+    int address;
+    size_t count;
+
+public:
+    DeviceBuffer() : address(-1), count(0) {}
+    DeviceBuffer(int address, size_t count) : address(address), count(count) {}
+
+    bool isNull() const {
+        return address < 0;
+    }
+
+    explicit operator bool() const {
+        return !isNull();
+    }
+
+    // Word address of the first element, e.g. for LOAD/STORE immediates.
+    int getAddress() const {
+        return address;
+    }
+
+    // Word address of element index.
+    int addressOf(size_t index) const {
+        return address + static_cast<int>(index);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    size_t sizeBytes() const {
+        return count * sizeof(T);
+    }
+};
+
+// Hands out blocks of a GPUMemory's address space. Requests up to
+// kMaxClassWords are rounded up to a power-of-two size class and recycled
+// through a free list per class; larger ones come from a first-fit list of
+// free ranges that are merged with their neighbours on release. Fresh space
+// is carved from the bottom of the address space upwards, and every block
+// starts on a kAlignmentWords (256-byte) boundary. Freeing a block also
+// returns the memory pages it covers entirely to the zero page.
+//
+// Allocation and release are logged to the memory's profiler as Allocate and
+// Release operations of the block's size.
+class DeviceAllocator {
+public:
+    static constexpr size_t kAlignmentWords = 64;
+    static constexpr int kNumSizeClasses = 15;
+    static constexpr size_t kMaxClassWords = kAlignmentWords << (kNumSizeClasses - 1);
+
+private:
+    static constexpr int kLargeClass = -1;
+
+    struct Allocation {
+        size_t words;       // Reserved words (the class size for small blocks).
+        size_t requested;   // Words asked for.
+        int size_class;
+    };
+
+    GPUMemory& memory;
+    mutable std::mutex mutex;
+    std::vector<std::vector<int>> free_lists;
+    std::map<size_t, size_t> large_free;        // Address -> words, no two adjacent.
+    std::unordered_map<int, Allocation> allocations;
+    size_t next_free;
+    size_t live_bytes;
+    size_t peak_bytes;
+
+    static int sizeClassFor(size_t words) {
+        int size_class = 0;
+        while (size_class < kNumSizeClasses && (kAlignmentWords << size_class) < words) {
+            ++size_class;
+        }
+        return size_class < kNumSizeClasses ? size_class : kLargeClass;
+    }
+
+    // Limit of the space fresh blocks can come from: what fits in memory and
+    // in the 32-bit word addresses kernels use.
+    size_t addressLimit() const {
+        return std::min(memory.getSize(), static_cast<size_t>(INT_MAX) + 1);
+    }
+
+    // Carves words off the top of the used space; -1 if memory is exhausted.
+    long long takeFresh(size_t words) {
+        if (words > addressLimit() - std::min(next_free, addressLimit())) {
+            return -1;
+        }
+        size_t address = next_free;
+        next_free += words;
+        return static_cast<long long>(address);
+    }
+
+    long long takeLarge(size_t words) {
+        for (auto it = large_free.begin(); it != large_free.end(); ++it) {
+            if (it->second < words) {
+                continue;
+            }
+            size_t address = it->first;
+            size_t remaining = it->second - words;
+            large_free.erase(it);
+            if (remaining > 0) {
+                large_free[address + words] = remaining;
+            }
+            return static_cast<long long>(address);
+        }
+        return takeFresh(words);
+    }
+
+    void releaseLarge(size_t address, size_t words) {
+        auto next = large_free.lower_bound(address);
+        if (next != large_free.end() && address + words == next->first) {
+            words += next->second;
+            next = large_free.erase(next);
+        }
+        if (next != large_free.begin()) {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == address) {
+                address = previous->first;
+                words += previous->second;
+                large_free.erase(previous);
+            }
+        }
+        if (address + words == next_free) {
+            next_free = address;
+        } else {
+            large_free[address] = words;
+        }
+    }
+
+public:
+    explicit DeviceAllocator(GPUMemory& memory)
+        : memory(memory),
+          free_lists(kNumSizeClasses),
+          next_free(0),
+          live_bytes(0),
+          peak_bytes(0) {}
+
+    DeviceAllocator(const DeviceAllocator&) = delete;
+    DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+    // Reserves count words and returns the address of the first one, or -1
+    // (with an error logged) if there is not enough free memory. A count of
+    // 0 returns -1 without an error.
+    int allocate(size_t count) {
+        if (count == 0) {
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        int size_class = sizeClassFor(count);
+        size_t words;
+        long long address;
+        if (size_class == kLargeClass) {
+            words = (count + kAlignmentWords - 1) / kAlignmentWords * kAlignmentWords;
+            address = takeLarge(words);
+        } else {
+            words = kAlignmentWords << size_class;
+            std::vector<int>& free_list = free_lists[size_class];
+            if (!free_list.empty()) {
+                address = free_list.back();
+                free_list.pop_back();
+            } else {
+                address = takeFresh(words);
+            }
+        }
+        if (address < 0) {
+            GPU_SIM_LOG(Error, "Error: Out of device memory allocating " << count << " words ("
+                        << live_bytes << " of " << memory.getSize() * sizeof(int) << " bytes in use).");
+            return -1;
+        }
+
+        allocations[static_cast<int>(address)] = Allocation{words, count, size_class};
+        live_bytes += count * sizeof(int);
+        peak_bytes = std::max(peak_bytes, live_bytes);
+        if (Profiler* profiler = memory.getProfiler()) {
+            profiler->logAllocation(MemoryOpType::Allocate, address, count * sizeof(int));
+        }
+        return static_cast<int>(address);
+    }
+
+    // Releases the block at address. Returns false (with an error logged) if
+    // address is not the start of a live block.
+    bool release(int address) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = allocations.find(address);
+        if (it == allocations.end()) {
+            GPU_SIM_LOG(Error, "Error: Free of address " << address << ", which is not an allocated block.");
+            return false;
+        }
+        Allocation allocation = it->second;
+        allocations.erase(it);
+        memory.discard(address, allocation.words);
+        if (allocation.size_class == kLargeClass) {
+            releaseLarge(static_cast<size_t>(address), allocation.words);
+        } else {
+            free_lists[allocation.size_class].push_back(address);
+        }
+        live_bytes -= allocation.requested * sizeof(int);
+        if (Profiler* profiler = memory.getProfiler()) {
+            profiler->logAllocation(MemoryOpType::Release, address, allocation.requested * sizeof(int));
+        }
+        return true;
+    }
+
+    template <typename T>
+    DeviceBuffer<T> allocateBuffer(size_t count) {
+        int address = allocate(count);
+        return address < 0 ? DeviceBuffer<T>() : DeviceBuffer<T>(address, count);
+    }
+
+    template <typename T>
+    bool releaseBuffer(DeviceBuffer<T>& buffer) {
+        bool released = release(buffer.getAddress());
+        buffer = DeviceBuffer<T>();
+        return released;
+    }
+
+    // Bytes requested by the blocks currently allocated, and the most there
+    // have been at once.
+    size_t getLiveBytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return live_bytes;
+    }
+
+    size_t getPeakBytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return peak_bytes;
+    }
+
+    size_t getLiveAllocations() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return allocations.size();
+    }
+
+    // Live blocks and free space, for checkpoints. Buffers handed out before a
+    // checkpoint stay valid after it is restored.
+    void saveState(CheckpointWriter& writer) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::vector<int>& free_list : free_lists) {
+            writer.writeVector(free_list);
+        }
+        writer.write<uint64_t>(large_free.size());
+        for (const auto& range : large_free) {
+            writer.write<uint64_t>(range.first);
+            writer.write<uint64_t>(range.second);
+        }
+        std::map<int, Allocation> ordered(allocations.begin(), allocations.end());
+        writer.write<uint64_t>(ordered.size());
+        for (const auto& entry : ordered) {
+            writer.write<int32_t>(entry.first);
+            writer.write<uint64_t>(entry.second.words);
+            writer.write<uint64_t>(entry.second.requested);
+            writer.write<int32_t>(entry.second.size_class);
+        }
+        writer.write<uint64_t>(next_free);
+        writer.write<uint64_t>(live_bytes);
+        writer.write<uint64_t>(peak_bytes);
+    }
+
+    bool restoreState(CheckpointReader& reader) {
+        std::vector<std::vector<int>> restored_free_lists(kNumSizeClasses);
+        for (std::vector<int>& free_list : restored_free_lists) {
+            reader.readVector(free_list);
+        }
+        std::map<size_t, size_t> restored_large_free;
+        uint64_t count = 0;
+        reader.read(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            uint64_t address = 0, words = 0;
+            reader.read(address);
+            reader.read(words);
+            restored_large_free[static_cast<size_t>(address)] = static_cast<size_t>(words);
+        }
+        std::unordered_map<int, Allocation> restored_allocations;
+        reader.read(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            int32_t address = 0, size_class = 0;
+            uint64_t words = 0, requested = 0;
+            reader.read(address);
+            reader.read(words);
+            reader.read(requested);
+            reader.read(size_class);
+            if (size_class < kLargeClass || size_class >= kNumSizeClasses) {
+                reader.fail();
+            }
+            restored_allocations[address] = Allocation{static_cast<size_t>(words), static_cast<size_t>(requested), size_class};
+        }
+        uint64_t restored_next_free = 0, restored_live = 0, restored_peak = 0;
+        reader.read(restored_next_free);
+        reader.read(restored_live);
+        reader.read(restored_peak);
+        if (!reader.ok() || restored_next_free > memory.getSize()) {
+            GPU_SIM_LOG(Error, "Error: Checkpoint state for the device allocator is malformed.");
+            return reader.fail();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        free_lists = std::move(restored_free_lists);
+        large_free = std::move(restored_large_free);
+        allocations = std::move(restored_allocations);
+        next_free = static_cast<size_t>(restored_next_free);
+        live_bytes = static_cast<size_t>(restored_live);
+        peak_bytes = static_cast<size_t>(restored_peak);
+        return true;
+    }
+};
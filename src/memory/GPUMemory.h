@@ -4,64 +4,498 @@
 #include <vector>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <mutex>
+#include "../arch/Instruction.h"
 #include "../sim/Profiler.h" // Corrected path
+#include "../sim/Log.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Word-addressed global memory backed by a page table. Pages (4 KiB by
+// default, or 2 MiB) are allocated on first write; until then they read as
+// zeros from one shared zero page, so host memory grows with the data kernels
+// actually write rather than with the simulated size. Reads never allocate,
+// which keeps concurrent readers (deferred MemoryPorts) safe; atomic updates
+// may allocate pages while other host threads read or update, so they
+// install pages under a lock and publish them atomically.
+//
+// mapFile() backs a page-aligned range with a file of raw 32-bit words,
+// mapped copy-on-write: large inputs load without copying, and kernel writes
+// stay private to the simulation.
 class GPUMemory {
+public:
+    static constexpr size_t kSmallPageBytes = 4096;
+    static constexpr size_t kLargePageBytes = 2 * 1024 * 1024;
+
 private:
-    std::vector<int> data;
+    struct FileMapping {
+        void* address;
+        size_t length;
+    };
+
+    size_t size;
+    size_t page_words;
+    int page_shift;
+    size_t page_mask;
+    std::vector<int*> page_table;       // nullptr: not yet written.
+    std::vector<char> page_owned;       // Allocated here (not file-mapped).
+    std::vector<int> zero_page;
+    std::vector<FileMapping> file_mappings;
+    size_t resident_pages;
+    size_t mapped_pages;
     Profiler* profiler;
+    std::mutex page_mutex;              // Serializes pages allocated by atomic updates.
+
+    size_t pageIndex(int address) const {
+        return static_cast<size_t>(address) >> page_shift;
+    }
+
+    size_t pageOffset(int address) const {
+        return static_cast<size_t>(address) & page_mask;
+    }
+
+    const int* pageForRead(size_t page) const {
+        const int* data = __atomic_load_n(&page_table[page], __ATOMIC_ACQUIRE);
+        return data ? data : zero_page.data();
+    }
+
+    int* pageForWrite(size_t page) {
+        int* data = page_table[page];
+        if (!data) {
+            data = new int[page_words]();
+            page_table[page] = data;
+            page_owned[page] = 1;
+            resident_pages++;
+            reportFootprint();
+        }
+        return data;
+    }
+
+    // pageForWrite() for atomic updates, which several host threads may make
+    // at once. Only the first touch of a page takes the lock.
+    int* pageForAtomic(size_t page) {
+        int* data = __atomic_load_n(&page_table[page], __ATOMIC_ACQUIRE);
+        if (data) {
+            return data;
+        }
+        std::lock_guard<std::mutex> lock(page_mutex);
+        data = page_table[page];
+        if (!data) {
+            data = new int[page_words]();
+            page_owned[page] = 1;
+            resident_pages++;
+            __atomic_store_n(&page_table[page], data, __ATOMIC_RELEASE);
+            reportFootprint();
+        }
+        return data;
+    }
+
+    void releasePage(size_t page) {
+        if (page_owned[page]) {
+            delete[] page_table[page];
+            resident_pages--;
+        } else if (page_table[page]) {
+            mapped_pages--;
+        }
+        page_table[page] = nullptr;
+        page_owned[page] = 0;
+    }
+
+    // Maps length bytes of fd from offset copy-on-write and keeps the mapping
+    // until destruction or releaseAll(); nullptr on failure.
+    int* mapRegion(int fd, uint64_t offset, size_t length) {
+        void* mapping = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+        if (mapping == MAP_FAILED) {
+            return nullptr;
+        }
+        file_mappings.push_back(FileMapping{mapping, length});
+        return static_cast<int*>(mapping);
+    }
+
+    // Drops every page and file mapping; all of memory reads as zeros.
+    void releaseAll() {
+        for (size_t page = 0; page < page_table.size(); ++page) {
+            releasePage(page);
+        }
+        for (const FileMapping& mapping : file_mappings) {
+            ::munmap(mapping.address, mapping.length);
+        }
+        file_mappings.clear();
+    }
+
+    void reportFootprint() const {
+        if (profiler) {
+            MemoryFootprint footprint;
+            footprint.virtual_bytes = size * sizeof(int);
+            footprint.resident_bytes = resident_pages * page_words * sizeof(int);
+            footprint.mapped_bytes = mapped_pages * page_words * sizeof(int);
+            footprint.page_bytes = page_words * sizeof(int);
+            profiler->logMemoryFootprint(footprint);
+        }
+    }
 
 public:
-    explicit GPUMemory(size_t size, Profiler* p = nullptr) : data(size, 0), profiler(p) {
+    explicit GPUMemory(size_t size, Profiler* p = nullptr, size_t page_bytes = kSmallPageBytes)
+        : size(size), page_words(0), page_shift(0), page_mask(0),
+          resident_pages(0), mapped_pages(0), profiler(p) {
+        if (page_bytes != kSmallPageBytes && page_bytes != kLargePageBytes) {
+            GPU_SIM_LOG(Warning, "Warning: Unsupported GPUMemory page size " << page_bytes << " bytes; using "
+                        << kSmallPageBytes << ".");
+            page_bytes = kSmallPageBytes;
+        }
+        page_words = page_bytes / sizeof(int);
+        while ((size_t(1) << page_shift) < page_words) {
+            ++page_shift;
+        }
+        page_mask = page_words - 1;
+        size_t num_pages = (size + page_words - 1) / page_words;
+        page_table.assign(num_pages, nullptr);
+        page_owned.assign(num_pages, 0);
+        zero_page.assign(page_words, 0);
+
         if (size == 0) {
-            std::cerr << "Warning: Initializing GPUMemory with size 0. No memory will be available." << std::endl;
+            GPU_SIM_LOG(Warning, "Warning: Initializing GPUMemory with size 0. No memory will be available.");
         }
-        std::cout << "GPUMemory initialized with " << size << " units." << std::endl;
-        if (profiler) {
-            profiler->logMemoryOperation("allocate", 0, size * sizeof(int));
+        if (size > static_cast<size_t>(INT_MAX) + 1) {
+            GPU_SIM_LOG(Warning, "Warning: GPUMemory of " << size << " units exceeds the 32-bit address range; "
+                        << "only the first " << static_cast<size_t>(INT_MAX) + 1 << " are addressable.");
         }
+        GPU_SIM_LOG(Info, "GPUMemory initialized with " << size << " units.");
+        reportFootprint();
     }
 
     ~GPUMemory() {
-        if (profiler) {
-            profiler->logMemoryOperation("release", 0, data.size() * sizeof(int));
+        for (size_t page = 0; page < page_table.size(); ++page) {
+            if (page_owned[page]) {
+                delete[] page_table[page];
+            }
+        }
+        for (const FileMapping& mapping : file_mappings) {
+            ::munmap(mapping.address, mapping.length);
         }
     }
 
+    GPUMemory(const GPUMemory&) = delete;
+    GPUMemory& operator=(const GPUMemory&) = delete;
+
     size_t getSize() const {
-        return data.size();
+        return size;
+    }
+
+    size_t getPageBytes() const {
+        return page_words * sizeof(int);
+    }
+
+    // Host bytes held by written pages; file-mapped pages are not included.
+    size_t getResidentBytes() const {
+        return resident_pages * page_words * sizeof(int);
+    }
+
+    size_t getMappedBytes() const {
+        return mapped_pages * page_words * sizeof(int);
+    }
+
+    bool isValidAddress(int address) const {
+        return address >= 0 && static_cast<size_t>(address) < size;
+    }
+
+    // Unchecked, unprofiled access for callers that already validated the address.
+    int peek(int address) const {
+        return pageForRead(pageIndex(address))[pageOffset(address)];
+    }
+
+    bool isValidRange(int base_address, int count) const {
+        return count >= 0 && base_address >= 0
+            && static_cast<size_t>(base_address) + static_cast<size_t>(count) <= size;
+    }
+
+    // Raw pointers to count words at base_address for callers that validated
+    // the range with isValidRange() and report the accesses with
+    // logRangeAccess(). Pages are not contiguous, so these return nullptr
+    // when the range crosses a page boundary; callers then go word by word.
+    // writeRange() allocates the page if needed, readRange() never does.
+    const int* readRange(int base_address, int count) const {
+        if (count > 0 && pageIndex(base_address) != pageIndex(base_address + count - 1)) {
+            return nullptr;
+        }
+        return pageForRead(pageIndex(base_address)) + pageOffset(base_address);
+    }
+
+    int* writeRange(int base_address, int count) {
+        if (count > 0 && pageIndex(base_address) != pageIndex(base_address + count - 1)) {
+            return nullptr;
+        }
+        return pageForWrite(pageIndex(base_address)) + pageOffset(base_address);
+    }
+
+    // Unchecked, unprofiled bulk copies across pages, for callers that
+    // validated the range and account for the accesses themselves.
+    void copyIn(int base_address, const int* source, size_t count) {
+        size_t address = static_cast<size_t>(base_address);
+        while (count > 0) {
+            size_t offset = address & page_mask;
+            size_t chunk = std::min(count, page_words - offset);
+            std::memcpy(pageForWrite(address >> page_shift) + offset, source, chunk * sizeof(int));
+            address += chunk;
+            source += chunk;
+            count -= chunk;
+        }
+    }
+
+    void copyOut(int base_address, int* destination, size_t count) const {
+        size_t address = static_cast<size_t>(base_address);
+        while (count > 0) {
+            size_t offset = address & page_mask;
+            size_t chunk = std::min(count, page_words - offset);
+            std::memcpy(destination, pageForRead(address >> page_shift) + offset, chunk * sizeof(int));
+            address += chunk;
+            destination += chunk;
+            count -= chunk;
+        }
+    }
+
+    // Unchecked, unprofiled fill of count words with value. Whole pages
+    // filled with zeros go back to the zero page instead of being written.
+    void fill(int base_address, int value, size_t count) {
+        size_t address = static_cast<size_t>(base_address);
+        while (count > 0) {
+            size_t offset = address & page_mask;
+            size_t chunk = std::min(count, page_words - offset);
+            if (value == 0 && chunk == page_words) {
+                releasePage(address >> page_shift);
+            } else {
+                std::fill_n(pageForWrite(address >> page_shift) + offset, chunk, value);
+            }
+            address += chunk;
+            count -= chunk;
+        }
+        reportFootprint();
+    }
+
+    // Drops the pages lying entirely within count words at base_address, so
+    // they hold no host memory and read as zeros again. Partly covered pages
+    // keep their contents.
+    void discard(int base_address, size_t count) {
+        size_t first = (static_cast<size_t>(base_address) + page_words - 1) >> page_shift;
+        size_t end = (static_cast<size_t>(base_address) + count) >> page_shift;
+        for (size_t page = first; page < end && page < page_table.size(); ++page) {
+            releasePage(page);
+        }
+        reportFootprint();
+    }
+
+    // Accounts for count element accesses, exactly as the equivalent sequence
+    // of read()/write() calls would, in a single profiler update.
+    void logRangeAccess(MemoryOpType op_type, int base_address, int count) const {
+        if (profiler) {
+            profiler->logMemoryRange(op_type, base_address, static_cast<size_t>(count), sizeof(int));
+        }
+    }
+
+    Profiler* getProfiler() const {
+        return profiler;
+    }
+
+    // Unchecked, unprofiled store for callers that already validated and
+    // accounted for the access (e.g. MemoryPort::commit).
+    void poke(int address, int value) {
+        pageForWrite(pageIndex(address))[pageOffset(address)] = value;
+    }
+
+    // Unchecked, unprofiled atomic read-modify-write of one word (see
+    // AtomicOp); returns the word's previous value. It is carried out with
+    // the host's atomic instructions on the word itself, so SMs running on
+    // several host threads can update the same words without a lock.
+    int applyAtomic(int address, AtomicOp atomic_op, int value, int compare = 0) {
+        int* word = pageForAtomic(pageIndex(address)) + pageOffset(address);
+        switch (atomic_op) {
+            case AtomicOp::ADD:
+                // Unsigned, so overflow wraps like ADD.
+                return static_cast<int>(__atomic_fetch_add(reinterpret_cast<uint32_t*>(word),
+                                                           static_cast<uint32_t>(value), __ATOMIC_RELAXED));
+            case AtomicOp::MAX: {
+                int current = __atomic_load_n(word, __ATOMIC_RELAXED);
+                while (current < value
+                       && !__atomic_compare_exchange_n(word, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                }
+                return current;
+            }
+            case AtomicOp::CAS: {
+                int expected = compare;
+                __atomic_compare_exchange_n(word, &expected, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+                return expected;
+            }
+            default:
+                return __atomic_load_n(word, __ATOMIC_RELAXED);
+        }
+    }
+
+    // applyAtomic() with bounds checking; profiled as a read and a write.
+    int atomicUpdate(int address, AtomicOp atomic_op, int value, int compare = 0) {
+        if (!isValidAddress(address)) {
+            GPU_SIM_LOG(Error, "Error: Atomic memory update out of bounds at address " << address
+                        << ". Memory size: " << size);
+            return 0;
+        }
+        if (profiler) {
+            profiler->logMemoryOperation(MemoryOpType::Read, address, sizeof(int));
+            profiler->logMemoryOperation(MemoryOpType::Write, address, sizeof(int));
+        }
+        return applyAtomic(address, atomic_op, value, compare);
     }
 
     int read(int address) const {
-        if (address < 0 || address >= data.size()) {
-            std::cerr << "Error: Memory read out of bounds at address " << address
-                      << ". Memory size: " << data.size() << std::endl;
+        if (!isValidAddress(address)) {
+            GPU_SIM_LOG(Error, "Error: Memory read out of bounds at address " << address
+                        << ". Memory size: " << size);
             return 0;
         }
         if (profiler) {
-            profiler->logMemoryOperation("read", address, sizeof(int));
+            profiler->logMemoryOperation(MemoryOpType::Read, address, sizeof(int));
         }
-        return data[address];
+        return peek(address);
     }
 
     void write(int address, int value) {
-        if (address < 0 || address >= data.size()) {
-            std::cerr << "Error: Memory write out of bounds at address " << address
-                      << ". Memory size: " << data.size() << std::endl;
+        if (!isValidAddress(address)) {
+            GPU_SIM_LOG(Error, "Error: Memory write out of bounds at address " << address
+                        << ". Memory size: " << size);
             return;
         }
         if (profiler) {
-            profiler->logMemoryOperation("write", address, sizeof(int));
+            profiler->logMemoryOperation(MemoryOpType::Write, address, sizeof(int));
+        }
+        poke(address, value);
+    }
+
+    // Backs the words from base_address onwards with the contents of path (raw
+    // 32-bit words in host byte order), replacing whatever those pages held.
+    // base_address must be page aligned and the file must fit. Full pages are
+    // mapped copy-on-write, so nothing is read until a kernel touches it; a
+    // final partial page is copied. Returns the number of words loaded, or -1.
+    long long mapFile(const std::string& path, int base_address) {
+        if (!isValidAddress(base_address) || pageOffset(base_address) != 0) {
+            GPU_SIM_LOG(Error, "Error: Cannot map " << path << " at address " << base_address
+                        << "; it must be a page-aligned (" << page_words << "-word) address in memory.");
+            return -1;
+        }
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            GPU_SIM_LOG(Error, "Error: Could not open " << path << " for mapping.");
+            return -1;
+        }
+        struct stat file_stat;
+        if (::fstat(fd, &file_stat) != 0) {
+            ::close(fd);
+            GPU_SIM_LOG(Error, "Error: Could not stat " << path << ".");
+            return -1;
+        }
+        size_t words = static_cast<size_t>(file_stat.st_size) / sizeof(int);
+        if (!isValidRange(base_address, static_cast<int>(std::min(words, static_cast<size_t>(INT_MAX))))
+            || words > static_cast<size_t>(INT_MAX)) {
+            ::close(fd);
+            GPU_SIM_LOG(Error, "Error: " << path << " (" << words << " words) does not fit in memory at address "
+                        << base_address << ".");
+            return -1;
+        }
+        if (words == 0) {
+            ::close(fd);
+            return 0;
+        }
+
+        size_t length = words * sizeof(int);
+        int* words_base = mapRegion(fd, 0, length);
+        ::close(fd);
+        if (!words_base) {
+            GPU_SIM_LOG(Error, "Error: Could not map " << path << ".");
+            return -1;
+        }
+
+        // Only whole OS pages of the mapping are safe to touch, so a partial
+        // last page that extends past them is copied instead.
+        size_t os_page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t mapped_end = (length + os_page - 1) / os_page * os_page;
+        size_t first_page = pageIndex(base_address);
+        for (size_t offset = 0; offset < words; offset += page_words) {
+            size_t page = first_page + offset / page_words;
+            releasePage(page);
+            size_t chunk = std::min(page_words, words - offset);
+            if ((offset + page_words) * sizeof(int) <= mapped_end) {
+                page_table[page] = words_base + offset;
+                mapped_pages++;
+            } else {
+                std::memcpy(pageForWrite(page), words_base + offset, chunk * sizeof(int));
+            }
+        }
+        reportFootprint();
+        GPU_SIM_LOG(Info, "Mapped " << words << " words of " << path << " at address " << base_address << ".");
+        return static_cast<long long>(words);
+    }
+
+    // Pages that hold data (written or file-mapped), in address order; the
+    // rest of memory reads as zeros. Used to checkpoint memory.
+    std::vector<uint64_t> getPopulatedPages() const {
+        std::vector<uint64_t> pages;
+        for (size_t page = 0; page < page_table.size(); ++page) {
+            if (page_table[page]) {
+                pages.push_back(page);
+            }
+        }
+        return pages;
+    }
+
+    // The page_words words of a page (the zero page if it holds no data).
+    const int* getPageData(uint64_t page) const {
+        return pageForRead(static_cast<size_t>(page));
+    }
+
+    // Replaces all of memory with pages stored back to back in path from
+    // offset (a multiple of the OS page size): the i-th stored page becomes
+    // page pages[i], and every other page reads as zeros. The pages are
+    // mapped copy-on-write, so they are only read when touched.
+    bool restorePages(const std::string& path, uint64_t offset, const std::vector<uint64_t>& pages) {
+        for (uint64_t page : pages) {
+            if (page >= page_table.size()) {
+                GPU_SIM_LOG(Error, "Error: Page " << page << " in " << path << " is outside memory.");
+                return false;
+            }
+        }
+        releaseAll();
+        if (!pages.empty()) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            int* base = fd >= 0 ? mapRegion(fd, offset, pages.size() * page_words * sizeof(int)) : nullptr;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            if (!base) {
+                GPU_SIM_LOG(Error, "Error: Could not map the memory pages of " << path << ".");
+                reportFootprint();
+                return false;
+            }
+            for (size_t i = 0; i < pages.size(); ++i) {
+                releasePage(static_cast<size_t>(pages[i]));
+                page_table[static_cast<size_t>(pages[i])] = base + i * page_words;
+                mapped_pages++;
+            }
         }
-        data[address] = value;
+        reportFootprint();
+        return true;
     }
 
     void printMemory(int start_addr = 0, int end_addr = 10) const {
         std::cout << "\n--- Global Memory Contents (" << start_addr << " to " << end_addr << ") ---" << std::endl;
-        for (int i = start_addr; i < end_addr && i < data.size(); ++i) {
-            std::cout << "Mem[" << i << "]: " << data[i] << std::endl;
+        for (int i = start_addr; i < end_addr && static_cast<size_t>(i) < size; ++i) {
+            std::cout << "Mem[" << i << "]: " << peek(i) << std::endl;
         }
-        if (end_addr > data.size()) {
+        if (static_cast<size_t>(end_addr) > size) {
             std::cout << "(Display truncated as end_addr exceeds memory size)" << std::endl;
         }
         std::cout << "----------------------------------------------------" << std::endl;
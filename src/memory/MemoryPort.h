@@ -0,0 +1,497 @@
+// src/memory/MemoryPort.h
+#pragma once
+
+#include "GPUMemory.h"
+#include "../sim/Checkpoint.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+// The word addresses first .. end - 1.
+struct AddressRange {
+    int first;
+    int end;
+};
+
+// Sorts ranges and merges those that overlap or touch.
+inline std::vector<AddressRange> coalesceRanges(std::vector<AddressRange> ranges) {
+    std::sort(ranges.begin(), ranges.end(),
+              [](const AddressRange& a, const AddressRange& b) { return a.first < b.first; });
+    std::vector<AddressRange> merged;
+    for (const AddressRange& range : ranges) {
+        if (!merged.empty() && range.first <= merged.back().end) {
+            merged.back().end = std::max(merged.back().end, range.end);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
+// Whether two coalesced range lists share an address.
+inline bool rangesOverlap(const std::vector<AddressRange>& a, const std::vector<AddressRange>& b) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].end <= b[j].first) {
+            i++;
+        } else if (b[j].end <= a[i].first) {
+            j++;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The path a ShaderCore takes to global memory during a kernel launch.
+//
+// In direct mode every access goes straight to GPUMemory, which is what the
+// serial launch path uses. In deferred mode (one port per SM when SMs run on
+// host worker threads) global memory is not touched until commit(): writes
+// are staged in a private overlay, and reads see the SM's own staged writes
+// first and global memory as it was before the launch otherwise. A write
+// span handed out in deferred mode is a buffer the port stages on its next
+// access.
+//
+// Atomic ATOM.ADD and ATOM.MAX updates whose old value the kernel discards
+// commute, so a deferred port stages them per word and commit() applies them
+// to whatever the word holds by then. Other atomics (CAS, those whose old
+// value is kept, and a mix of operations on one word) read the word and
+// stage the result like a store.
+//
+// Accesses are counted in a private MemoryCounters, and only recorded
+// individually when the profiler keeps a memory trace; a deferred port also
+// holds its streamed trace records. commit() applies the staged writes and
+// updates and hands the counts (or the recorded accesses, in order) and the
+// trace records on. Committing the ports in SM order reproduces exactly the
+// memory image and profiler state of running the SMs one after another,
+// unless an SM read a word that a lower-numbered SM modified: the port
+// records the ranges it read from global memory for callers to check that,
+// and discard() drops everything it staged.
+class MemoryPort {
+private:
+    struct Access {
+        MemoryOpType op_type;
+        int address;
+    };
+
+    struct StagedAtomic {
+        AtomicOp op;
+        int value;
+    };
+
+    GPUMemory& memory;
+    bool deferred;
+    bool record_accesses;
+    std::unordered_map<int, int> staged_writes;
+    std::unordered_map<int, StagedAtomic> staged_atomics;
+    std::vector<AddressRange> read_ranges;
+    std::vector<Access> access_log;
+    MemoryCounters counters;
+    // Bounds of the staged writes and atomic updates.
+    int staged_min_address;
+    int staged_max_address;
+    std::vector<int> span_buffer;
+    int span_base;
+    int span_count;
+
+    // Streaming trace export: records are batched here and handed to the
+    // writer a buffer at a time, tagged with the current issue context.
+    static constexpr size_t kTraceBufferRecords = 1024;
+    TraceWriter* trace_writer;
+    std::vector<TraceRecord> trace_buffer;
+    uint16_t context_sm_id;
+    uint32_t context_warp_id;
+    uint64_t context_cycle;
+    uint64_t cycle_offset;
+
+    static int combineAtomic(AtomicOp atomic_op, int old_value, int value, int compare) {
+        switch (atomic_op) {
+            case AtomicOp::ADD:
+                return static_cast<int>(static_cast<uint32_t>(old_value) + static_cast<uint32_t>(value));
+            case AtomicOp::MAX:
+                return std::max(old_value, value);
+            case AtomicOp::CAS:
+                return old_value == compare ? value : old_value;
+        }
+        return old_value;
+    }
+
+    void extendStagedBounds(int address) {
+        if (staged_max_address < staged_min_address) {
+            staged_min_address = staged_max_address = address;
+        } else {
+            staged_min_address = std::min(staged_min_address, address);
+            staged_max_address = std::max(staged_max_address, address);
+        }
+    }
+
+    void stageWord(int address, int value) {
+        staged_writes[address] = value;
+        if (!staged_atomics.empty()) {
+            staged_atomics.erase(address);
+        }
+        extendStagedBounds(address);
+    }
+
+    // Stages the write span acquireWriteSpan() last handed out, which the
+    // caller has filled by now.
+    void stageWriteSpan() {
+        if (span_count == 0) {
+            return;
+        }
+        for (int i = 0; i < span_count; ++i) {
+            stageWord(span_base + i, span_buffer[static_cast<size_t>(i)]);
+        }
+        span_count = 0;
+    }
+
+    void recordRead(int address, int count) {
+        if (!read_ranges.empty()) {
+            AddressRange& last = read_ranges.back();
+            if (address >= last.first && address <= last.end) {
+                last.end = std::max(last.end, address + count);
+                return;
+            }
+        }
+        read_ranges.push_back({address, address + count});
+    }
+
+    // The word as this SM sees it in deferred mode: its staged write, or
+    // global memory with its staged atomic updates applied.
+    int stagedValue(int address) {
+        auto staged = staged_writes.find(address);
+        if (staged != staged_writes.end()) {
+            return staged->second;
+        }
+        recordRead(address, 1);
+        int value = memory.peek(address);
+        auto atomic_update = staged_atomics.find(address);
+        if (atomic_update != staged_atomics.end()) {
+            value = combineAtomic(atomic_update->second.op, value, atomic_update->second.value, 0);
+        }
+        return value;
+    }
+
+    void recordAccess(MemoryOpType op_type, int address) {
+        counters.record(op_type, sizeof(int));
+        if (record_accesses) {
+            access_log.push_back({op_type, address});
+        }
+    }
+
+    void streamAccess(MemoryOpType op_type, int address, int count) {
+        if (!trace_writer) {
+            return;
+        }
+        TraceRecord record{};
+        record.op_type = static_cast<uint8_t>(op_type);
+        record.sm_id = context_sm_id;
+        record.warp_id = context_warp_id;
+        record.cycle = cycle_offset + context_cycle;
+        record.address = static_cast<uint64_t>(address);
+        record.size_bytes = static_cast<uint32_t>(count) * sizeof(int);
+        trace_buffer.push_back(record);
+        if (!deferred && trace_buffer.size() >= kTraceBufferRecords) {
+            flushTrace();
+        }
+    }
+
+public:
+    explicit MemoryPort(GPUMemory& mem, bool defer_writes = false)
+        : memory(mem),
+          deferred(defer_writes),
+          record_accesses(defer_writes && mem.getProfiler() && mem.getProfiler()->isMemoryTracingEnabled()),
+          staged_min_address(0),
+          staged_max_address(-1),
+          span_base(0),
+          span_count(0),
+          trace_writer(mem.getProfiler() ? mem.getProfiler()->getActiveTraceWriter() : nullptr),
+          context_sm_id(0),
+          context_warp_id(0),
+          context_cycle(0),
+          cycle_offset(0) {}
+
+    MemoryPort(MemoryPort&&) = default;
+
+    ~MemoryPort() {
+        flushTrace();
+    }
+
+    // Identifies the SM, warp and cycle the following accesses belong to in
+    // the streamed trace.
+    void setIssueContext(int sm_id, int warp_id, uint64_t cycle) {
+        context_sm_id = static_cast<uint16_t>(sm_id);
+        context_warp_id = static_cast<uint32_t>(warp_id);
+        context_cycle = cycle;
+    }
+
+    // Device cycle the SM's cycle 0 corresponds to, so traced cycles keep
+    // increasing across launches.
+    void setCycleOffset(uint64_t offset) {
+        cycle_offset = offset;
+    }
+
+    void flushTrace() {
+        if (trace_writer && !trace_buffer.empty()) {
+            trace_writer->append(trace_buffer.data(), trace_buffer.size());
+            trace_buffer.clear();
+        }
+    }
+
+    bool isDeferred() const {
+        return deferred;
+    }
+
+    int read(int address) {
+        stageWriteSpan();
+        if (!memory.isValidAddress(address)) {
+            return memory.read(address); // Reports the out-of-bounds access.
+        }
+        streamAccess(MemoryOpType::Read, address, 1);
+        if (!deferred) {
+            return memory.read(address);
+        }
+        recordAccess(MemoryOpType::Read, address);
+        return stagedValue(address);
+    }
+
+    void write(int address, int value) {
+        stageWriteSpan();
+        if (!memory.isValidAddress(address)) {
+            memory.write(address, value); // Reports the out-of-bounds access.
+            return;
+        }
+        streamAccess(MemoryOpType::Write, address, 1);
+        if (!deferred) {
+            memory.write(address, value);
+            return;
+        }
+        recordAccess(MemoryOpType::Write, address);
+        stageWord(address, value);
+    }
+
+    // An indivisible read-modify-write of the word at address (see AtomicOp),
+    // counted as a read and a write; returns the word's previous value, or 0
+    // from a deferred port when keep_old is false and the update is staged.
+    int atomic(int address, AtomicOp atomic_op, int value, int compare = 0, bool keep_old = true) {
+        stageWriteSpan();
+        if (!memory.isValidAddress(address)) {
+            return memory.atomicUpdate(address, atomic_op, value, compare); // Reports the out-of-bounds access.
+        }
+        streamAccess(MemoryOpType::Read, address, 1);
+        streamAccess(MemoryOpType::Write, address, 1);
+        if (!deferred) {
+            return memory.atomicUpdate(address, atomic_op, value, compare);
+        }
+        recordAccess(MemoryOpType::Read, address);
+        recordAccess(MemoryOpType::Write, address);
+        auto staged = staged_writes.find(address);
+        if (staged != staged_writes.end()) {
+            int old_value = staged->second;
+            staged->second = combineAtomic(atomic_op, old_value, value, compare);
+            return old_value;
+        }
+        if (!keep_old && atomic_op != AtomicOp::CAS) {
+            auto atomic_update = staged_atomics.find(address);
+            if (atomic_update == staged_atomics.end()) {
+                staged_atomics.emplace(address, StagedAtomic{atomic_op, value});
+                extendStagedBounds(address);
+                return 0;
+            }
+            if (atomic_update->second.op == atomic_op) {
+                atomic_update->second.value = combineAtomic(atomic_op, atomic_update->second.value, value, 0);
+                return 0;
+            }
+        }
+        int old_value = stagedValue(address);
+        stageWord(address, combineAtomic(atomic_op, old_value, value, compare));
+        return old_value;
+    }
+
+    // Returns a pointer to count contiguous words starting at base_address that
+    // can be read in one go, accounting for the reads as if read() had been
+    // called for each word in order. Returns nullptr when the span is out of
+    // bounds, crosses a memory page or overlaps this port's staged writes or
+    // updates; callers then fall back to read().
+    const int* acquireReadSpan(int base_address, int count) {
+        stageWriteSpan();
+        if (!memory.isValidRange(base_address, count)) {
+            return nullptr;
+        }
+        const int* span = static_cast<const GPUMemory&>(memory).readRange(base_address, count);
+        if (!span) {
+            return nullptr;
+        }
+        if (!deferred) {
+            memory.logRangeAccess(MemoryOpType::Read, base_address, count);
+            streamAccess(MemoryOpType::Read, base_address, count);
+            return span;
+        }
+        bool overlaps_staged = staged_max_address >= staged_min_address
+            && base_address <= staged_max_address && base_address + count - 1 >= staged_min_address;
+        if (overlaps_staged) {
+            return nullptr;
+        }
+        streamAccess(MemoryOpType::Read, base_address, count);
+        if (record_accesses) {
+            for (int i = 0; i < count; ++i) {
+                access_log.push_back({MemoryOpType::Read, base_address + i});
+            }
+        }
+        counters.record(MemoryOpType::Read, sizeof(int), static_cast<uint64_t>(count));
+        recordRead(base_address, count);
+        return span;
+    }
+
+    // Returns a pointer to count contiguous words starting at base_address that
+    // the caller must fill completely before its next call on the port,
+    // accounting for the writes as if write() had been called for each word
+    // in order. A direct port hands out global memory within one memory page,
+    // a deferred one a buffer it stages later; nullptr means the caller falls
+    // back to write().
+    int* acquireWriteSpan(int base_address, int count) {
+        stageWriteSpan();
+        if (!memory.isValidRange(base_address, count)) {
+            return nullptr;
+        }
+        if (deferred) {
+            if (count <= 0) {
+                return nullptr;
+            }
+            streamAccess(MemoryOpType::Write, base_address, count);
+            if (record_accesses) {
+                for (int i = 0; i < count; ++i) {
+                    access_log.push_back({MemoryOpType::Write, base_address + i});
+                }
+            }
+            counters.record(MemoryOpType::Write, sizeof(int), static_cast<uint64_t>(count));
+            span_buffer.resize(std::max(span_buffer.size(), static_cast<size_t>(count)));
+            span_base = base_address;
+            span_count = count;
+            return span_buffer.data();
+        }
+        int* span = memory.writeRange(base_address, count);
+        if (!span) {
+            return nullptr;
+        }
+        memory.logRangeAccess(MemoryOpType::Write, base_address, count);
+        streamAccess(MemoryOpType::Write, base_address, count);
+        return span;
+    }
+
+    // Coalesced ranges of the words a deferred port read from global memory
+    // rather than from its own staged writes.
+    std::vector<AddressRange> getReadRanges() const {
+        return coalesceRanges(read_ranges);
+    }
+
+    // Coalesced ranges of the words a deferred port will write or update.
+    std::vector<AddressRange> getModifiedRanges() {
+        stageWriteSpan();
+        std::vector<AddressRange> ranges;
+        ranges.reserve(staged_writes.size() + staged_atomics.size());
+        for (const auto& staged : staged_writes) {
+            ranges.push_back({staged.first, staged.first + 1});
+        }
+        for (const auto& staged : staged_atomics) {
+            ranges.push_back({staged.first, staged.first + 1});
+        }
+        return coalesceRanges(std::move(ranges));
+    }
+
+    // Applies the staged writes and atomic updates to global memory and
+    // reports this port's accesses to the profiler. Must be called from one
+    // thread at a time.
+    void commit() {
+        stageWriteSpan();
+        for (const auto& staged : staged_writes) {
+            memory.poke(staged.first, staged.second);
+        }
+        for (const auto& staged : staged_atomics) {
+            memory.applyAtomic(staged.first, staged.second.op, staged.second.value);
+        }
+        Profiler* profiler = memory.getProfiler();
+        if (profiler) {
+            if (record_accesses) {
+                for (const Access& access : access_log) {
+                    profiler->logMemoryOperation(access.op_type, access.address, sizeof(int));
+                }
+            } else {
+                profiler->mergeMemoryCounters(counters);
+            }
+        }
+        flushTrace();
+        discard();
+    }
+
+    // Drops everything staged, counted and traced since the last commit().
+    void discard() {
+        span_count = 0;
+        access_log.clear();
+        staged_writes.clear();
+        staged_atomics.clear();
+        read_ranges.clear();
+        trace_buffer.clear();
+        counters = MemoryCounters();
+        staged_min_address = 0;
+        staged_max_address = -1;
+    }
+
+    // What a deferred port has staged, counted, read and traced since the
+    // last commit(), for checkpoints of a launch stopped part way.
+    void saveState(CheckpointWriter& writer) {
+        stageWriteSpan();
+        writer.write<uint64_t>(staged_writes.size());
+        for (const auto& staged : staged_writes) {
+            writer.write<int32_t>(staged.first);
+            writer.write<int32_t>(staged.second);
+        }
+        writer.write<uint64_t>(staged_atomics.size());
+        for (const auto& staged : staged_atomics) {
+            writer.write<int32_t>(staged.first);
+            writer.write(staged.second);
+        }
+        writer.write<int32_t>(staged_min_address);
+        writer.write<int32_t>(staged_max_address);
+        writer.writeVector(read_ranges);
+        writer.writeVector(access_log);
+        writer.write(counters);
+        writer.writeVector(trace_buffer);
+    }
+
+    // Replaces everything staged with a state saved by saveState().
+    bool restoreState(CheckpointReader& reader) {
+        discard();
+        uint64_t count = 0;
+        reader.read(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            int32_t address = 0, value = 0;
+            reader.read(address);
+            reader.read(value);
+            staged_writes[address] = value;
+        }
+        reader.read(count);
+        for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+            int32_t address = 0;
+            StagedAtomic update{AtomicOp::ADD, 0};
+            reader.read(address);
+            reader.read(update);
+            staged_atomics[address] = update;
+        }
+        reader.read(staged_min_address);
+        reader.read(staged_max_address);
+        reader.readVector(read_ranges);
+        reader.readVector(access_log);
+        reader.read(counters);
+        reader.readVector(trace_buffer);
+        if (!reader.ok()) {
+            discard();
+            return false;
+        }
+        return true;
+    }
+};
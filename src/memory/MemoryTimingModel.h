@@ -0,0 +1,239 @@
+// src/memory/MemoryTimingModel.h
+#pragma once
+
+#include "Cache.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+
+// Timing parameters of the global memory path seen by one SM.
+//
+// A warp's LOAD/STORE is split into aligned segments of segment_bytes (32, 64
+// or 128); each segment is one transaction. Transactions go through a single
+// channel per SM that accepts one every cycles_per_transaction cycles (the
+// bandwidth), and a LOAD's data returns latency_cycles after its last
+// transaction was accepted. With both values 0 (the default) memory is
+// instantaneous and only coalescing is measured.
+//
+// When caches are attached (a per-SM L1 and/or the shared L2), each segment
+// probes them in turn: an L1 hit completes after the L1 hit latency without
+// using the channel, anything else occupies the channel and completes after
+// the L2 hit latency or, on an L2 miss, after latency_cycles (DRAM). Caches
+// are probed once per segment, so their line size should be at least
+// segment_bytes.
+struct MemoryTimingConfig {
+    int segment_bytes = 128;
+    int latency_cycles = 0;
+    int cycles_per_transaction = 0;
+
+    bool isTimed() const {
+        return latency_cycles > 0 || cycles_per_transaction > 0;
+    }
+
+    static bool isValidSegmentSize(int bytes) {
+        return bytes == 32 || bytes == 64 || bytes == 128;
+    }
+};
+
+// Coalescing statistics for one memory instruction (one PC) of a kernel.
+struct InstructionMemoryStats {
+    int pc = 0;
+    std::string instruction;
+    uint64_t warp_requests = 0;      // Warp-level executions of the instruction.
+    uint64_t transactions = 0;       // Segments transferred.
+    uint64_t requested_bytes = 0;    // Bytes the active lanes asked for.
+    uint64_t transferred_bytes = 0;  // transactions * segment size.
+
+    double efficiency() const {
+        return transferred_bytes == 0 ? 0.0 : static_cast<double>(requested_bytes) / transferred_bytes;
+    }
+
+    void merge(const InstructionMemoryStats& other) {
+        warp_requests += other.warp_requests;
+        transactions += other.transactions;
+        requested_bytes += other.requested_bytes;
+        transferred_bytes += other.transferred_bytes;
+    }
+};
+
+class MemoryTimingModel {
+private:
+    MemoryTimingConfig config;
+    Cache l1;
+    SharedCache* l2;
+    long long channel_free_cycle;
+    long long last_completion_cycle;
+    std::vector<long long> scratch_segments;
+
+    // Latency of a request that left the L1: an L2 hit, or DRAM.
+    int accessLowerLevel(uint64_t byte_address, bool is_write) {
+        if (l2 == nullptr) {
+            return config.latency_cycles;
+        }
+        CacheAccessResult result = l2->access(byte_address, is_write);
+        return result.hit ? l2->getConfig().hit_latency : config.latency_cycles;
+    }
+
+public:
+    explicit MemoryTimingModel(const MemoryTimingConfig& timing_config = MemoryTimingConfig())
+        : config(timing_config), l2(nullptr), channel_free_cycle(0), last_completion_cycle(0) {}
+
+    const MemoryTimingConfig& getConfig() const {
+        return config;
+    }
+
+    void setConfig(const MemoryTimingConfig& timing_config) {
+        config = timing_config;
+        if (!MemoryTimingConfig::isValidSegmentSize(config.segment_bytes)) {
+            config.segment_bytes = 128;
+        }
+        config.latency_cycles = std::max(config.latency_cycles, 0);
+        config.cycles_per_transaction = std::max(config.cycles_per_transaction, 0);
+    }
+
+    // l1_config with size_bytes 0 disables the L1; a null l2 disables the L2.
+    void setCaches(const CacheConfig& l1_config, SharedCache* shared_l2) {
+        l1.configure(l1_config);
+        l2 = shared_l2;
+    }
+
+    bool isTimed() const {
+        return config.isTimed() || l1.isEnabled() || l2 != nullptr;
+    }
+
+    // Starts a new launch: the channel is idle and the L1 is invalidated, as
+    // GPUs do at kernel boundaries. The shared L2 keeps its contents.
+    void reset() {
+        channel_free_cycle = 0;
+        last_completion_cycle = 0;
+        l1.invalidateAll();
+        l1.takeStats();
+    }
+
+    // Configuration, L1 and channel state for checkpoints. The shared L2 is
+    // saved by its owner and reattached with setCaches().
+    void saveState(CheckpointWriter& writer) const {
+        writer.write(config);
+        l1.saveState(writer);
+        writer.write(channel_free_cycle);
+        writer.write(last_completion_cycle);
+    }
+
+    bool restoreState(CheckpointReader& reader) {
+        MemoryTimingConfig saved_config;
+        if (!reader.read(saved_config)) {
+            return false;
+        }
+        setConfig(saved_config);
+        l1.restoreState(reader);
+        reader.read(channel_free_cycle);
+        reader.read(last_completion_cycle);
+        return reader.ok();
+    }
+
+    // L1 counters since the last reset().
+    const CacheStats& getL1Stats() const {
+        return l1.getStats();
+    }
+
+    long long getLastCompletionCycle() const {
+        return last_completion_cycle;
+    }
+
+    // Number of segments touched by `count` consecutive words starting at word
+    // address base_address.
+    int countContiguousTransactions(long long base_address, int count) const {
+        if (count <= 0 || base_address < 0) {
+            return 0;
+        }
+        long long first_byte = base_address * static_cast<long long>(sizeof(int));
+        long long last_byte = (base_address + count) * static_cast<long long>(sizeof(int)) - 1;
+        return static_cast<int>(last_byte / config.segment_bytes - first_byte / config.segment_bytes + 1);
+    }
+
+    // Number of distinct segments touched by an arbitrary set of lane word
+    // addresses (negative addresses are ignored).
+    int countTransactions(const int* lane_addresses, int count) {
+        scratch_segments.clear();
+        for (int i = 0; i < count; ++i) {
+            if (lane_addresses[i] >= 0) {
+                scratch_segments.push_back(static_cast<long long>(lane_addresses[i]) * sizeof(int) / config.segment_bytes);
+            }
+        }
+        std::sort(scratch_segments.begin(), scratch_segments.end());
+        scratch_segments.erase(std::unique(scratch_segments.begin(), scratch_segments.end()), scratch_segments.end());
+        return static_cast<int>(scratch_segments.size());
+    }
+
+    // Issues the `transactions` consecutive segments of a request starting at
+    // word address base_address at issue_cycle, and returns the cycle
+    // from which the issuing warp may issue again: after the data returns for
+    // a load, or once the channel has accepted every transaction for a store.
+    long long issue(long long issue_cycle, long long base_address, int transactions, bool is_load) {
+        long long first_segment = base_address * static_cast<long long>(sizeof(int)) / config.segment_bytes;
+        return issueSegments(issue_cycle, transactions, is_load,
+                             [first_segment](int i) { return first_segment + i; });
+    }
+
+    // Like issue(), for the segments found by the preceding countTransactions().
+    // bypass_l1 sends them past the L1 to the L2 or DRAM, where GPUs carry
+    // out atomics.
+    long long issueCounted(long long issue_cycle, bool is_load, bool bypass_l1 = false) {
+        return issueSegments(issue_cycle, static_cast<int>(scratch_segments.size()), is_load,
+                             [this](int i) { return scratch_segments[i]; }, bypass_l1);
+    }
+
+private:
+    template <typename SegmentAt>
+    long long issueSegments(long long issue_cycle, int transactions, bool is_load, SegmentAt segment_at,
+                            bool bypass_l1 = false) {
+        if (!isTimed() || transactions <= 0) {
+            return issue_cycle + 1;
+        }
+
+        const bool use_l1 = l1.isEnabled() && !bypass_l1;
+        int forwarded = 0;
+        int l1_latency = -1;
+        int lower_latency = 0;
+        if (!use_l1 && l2 == nullptr) {
+            forwarded = transactions;
+            lower_latency = config.latency_cycles;
+        } else {
+            const bool is_write = !is_load;
+            const bool l1_write_through = l1.getConfig().write_policy == WritePolicy::WriteThrough;
+            for (int i = 0; i < transactions; ++i) {
+                uint64_t byte_address = static_cast<uint64_t>(segment_at(i)) * config.segment_bytes;
+                bool forward_as_write = is_write;
+                if (use_l1) {
+                    CacheAccessResult l1_result = l1.access(byte_address, is_write);
+                    if (l1_result.writeback) {
+                        forwarded++;
+                        accessLowerLevel(l1_result.writeback_address, true);
+                    }
+                    if (l1_result.hit && !(is_write && l1_write_through)) {
+                        l1_latency = std::max(l1_latency, l1.getConfig().hit_latency);
+                        continue;
+                    }
+                    // A write-back L1 allocates on a write miss by fetching the line.
+                    forward_as_write = is_write && l1_write_through;
+                }
+                forwarded++;
+                lower_latency = std::max(lower_latency, accessLowerLevel(byte_address, forward_as_write));
+            }
+        }
+
+        long long completion = l1_latency >= 0 ? issue_cycle + l1_latency : issue_cycle;
+        long long accepted = issue_cycle;
+        if (forwarded > 0) {
+            long long start = std::max(issue_cycle, channel_free_cycle);
+            channel_free_cycle = start + static_cast<long long>(forwarded) * config.cycles_per_transaction;
+            accepted = channel_free_cycle;
+            completion = std::max(completion, channel_free_cycle + lower_latency);
+        }
+        last_completion_cycle = std::max(last_completion_cycle, completion);
+        long long ready = is_load ? completion : accepted;
+        return std::max(ready, issue_cycle + 1);
+    }
+};
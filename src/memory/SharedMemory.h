@@ -0,0 +1,104 @@
+// src/memory/SharedMemory.h
+#pragma once
+
+#include "../sim/Checkpoint.h"
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+// Shared memory of the blocks of kernels that use LDS/STS. Every such block
+// gets block_words zeroed words on its SM for as long as it is resident, and
+// an SM only admits such a block while its blocks' shared memory fits in
+// sm_words (a lone block is always admitted). Kernels without LDS/STS take
+// no shared memory.
+struct SharedMemoryConfig {
+    int block_words = 12288;    // 48 KB per block.
+    int sm_words = 24576;       // 96 KB per SM.
+    int num_banks = 32;         // Word-interleaved banks; 0 turns off bank-conflict modeling.
+    int latency_cycles = 0;     // Cycles after an access before its warp can issue again.
+};
+
+// Bank-conflict timing of one SM's shared memory. Word address a lives in
+// bank a % num_banks, and each bank serves one word per cycle: an access
+// takes as many cycles as the most distinct words any one bank has to serve
+// (lanes reading the same word get it in one broadcast). Accesses of
+// different warps queue behind each other.
+class SharedMemoryTiming {
+private:
+    SharedMemoryConfig config;
+    long long busy_until;
+    std::vector<std::pair<int, int>> bank_words;    // (bank, address), reused across accesses.
+
+public:
+    SharedMemoryTiming() : busy_until(0) {}
+
+    void setConfig(const SharedMemoryConfig& new_config) {
+        config = new_config;
+        config.block_words = std::max(config.block_words, 0);
+        config.sm_words = std::max(config.sm_words, 0);
+        config.num_banks = std::max(config.num_banks, 0);
+        config.latency_cycles = std::max(config.latency_cycles, 0);
+    }
+
+    const SharedMemoryConfig& getConfig() const {
+        return config;
+    }
+
+    void reset() {
+        busy_until = 0;
+    }
+
+    // Cycles the banks need to serve the addresses of one warp access.
+    int conflictWays(const int* addresses, int count) {
+        if (count <= 0 || config.num_banks <= 0) {
+            return 1;
+        }
+        bool contiguous = true;
+        for (int i = 1; i < count && contiguous; ++i) {
+            contiguous = addresses[i] == addresses[0] + i;
+        }
+        if (contiguous) {
+            return (count + config.num_banks - 1) / config.num_banks;
+        }
+        bank_words.clear();
+        for (int i = 0; i < count; ++i) {
+            int bank = addresses[i] % config.num_banks;
+            bank_words.emplace_back(bank < 0 ? bank + config.num_banks : bank, addresses[i]);
+        }
+        std::sort(bank_words.begin(), bank_words.end());
+        int ways = 0;
+        int run = 0;
+        for (size_t i = 0; i < bank_words.size(); ++i) {
+            if (i > 0 && bank_words[i] == bank_words[i - 1]) {
+                continue;
+            }
+            run = i > 0 && bank_words[i].first == bank_words[i - 1].first ? run + 1 : 1;
+            ways = std::max(ways, run);
+        }
+        return ways;
+    }
+
+    // Issues an access that needs ways bank cycles at cycle and returns the
+    // cycle its warp can issue again.
+    long long issue(long long cycle, int ways) {
+        long long start = std::max(cycle, busy_until);
+        busy_until = start + ways;
+        return busy_until + config.latency_cycles;
+    }
+
+    void saveState(CheckpointWriter& writer) const {
+        writer.write(config);
+        writer.write(busy_until);
+    }
+
+    bool restoreState(CheckpointReader& reader) {
+        SharedMemoryConfig saved_config;
+        if (!reader.read(saved_config)) {
+            return false;
+        }
+        setConfig(saved_config);
+        reader.read(busy_until);
+        return reader.ok();
+    }
+};
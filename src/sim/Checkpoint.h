@@ -0,0 +1,133 @@
+// src/sim/Checkpoint.h
+#pragma once
+
+#include "Log.h"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// On-disk simulator checkpoint: a CheckpointHeader, state_bytes of component
+// state written through a CheckpointWriter, padding up to page_data_offset,
+// then page_count global memory pages of page_bytes each. The page section
+// starts on a kCheckpointPageAlignment boundary so restoring can map it
+// instead of reading it. Everything is in host byte order.
+constexpr char kCheckpointMagic[8] = {'G', 'P', 'U', 'S', 'I', 'M', 'C', 'K'};
+constexpr uint32_t kCheckpointVersion = 8;
+constexpr uint64_t kCheckpointPageAlignment = 65536;
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_bytes;
+    uint64_t state_bytes;
+    uint64_t state_hash;        // fnv1aHash() of the state section.
+    uint64_t page_count;
+    uint64_t page_data_offset;
+};
+
+static_assert(sizeof(CheckpointHeader) == 48, "CheckpointHeader must stay 48 bytes");
+
+// Appends component state to a byte buffer. Values are trivially copyable
+// and written as-is; vectors and strings are prefixed with their length.
+class CheckpointWriter {
+private:
+    std::vector<char> buffer;
+
+public:
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "CheckpointWriter::write needs a trivially copyable type");
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T, typename Allocator>
+    void writeVector(const std::vector<T, Allocator>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "CheckpointWriter::writeVector needs a trivially copyable type");
+        write<uint64_t>(values.size());
+        if (!values.empty()) {
+            const char* bytes = reinterpret_cast<const char*>(values.data());
+            buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(T));
+        }
+    }
+
+    void writeString(const std::string& value) {
+        write<uint64_t>(value.size());
+        buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    const std::vector<char>& getData() const {
+        return buffer;
+    }
+};
+
+// Reads back what a CheckpointWriter wrote. A read past the end, or an
+// implausible length, marks the reader failed; later reads then fail too,
+// so callers can check ok() once after a group of reads.
+class CheckpointReader {
+private:
+    const char* data;
+    size_t size;
+    size_t offset;
+    bool failed;
+
+    bool take(void* destination, size_t bytes) {
+        if (failed || bytes > size - offset) {
+            failed = true;
+            return false;
+        }
+        if (bytes > 0) {
+            std::memcpy(destination, data + offset, bytes);
+        }
+        offset += bytes;
+        return true;
+    }
+
+public:
+    CheckpointReader(const char* data, size_t size) : data(data), size(size), offset(0), failed(false) {}
+
+    template <typename T>
+    bool read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "CheckpointReader::read needs a trivially copyable type");
+        return take(&value, sizeof(T));
+    }
+
+    template <typename T, typename Allocator>
+    bool readVector(std::vector<T, Allocator>& values) {
+        uint64_t count = 0;
+        if (!read(count) || count > (size - offset) / sizeof(T)) {
+            failed = true;
+            return false;
+        }
+        values.resize(static_cast<size_t>(count));
+        return take(values.data(), values.size() * sizeof(T));
+    }
+
+    bool readString(std::string& value) {
+        uint64_t length = 0;
+        if (!read(length) || length > size - offset) {
+            failed = true;
+            return false;
+        }
+        value.assign(data + offset, static_cast<size_t>(length));
+        offset += static_cast<size_t>(length);
+        return true;
+    }
+
+    // Marks the reader failed, for values that read fine but are invalid.
+    bool fail() {
+        failed = true;
+        return false;
+    }
+
+    bool ok() const {
+        return !failed;
+    }
+
+    bool atEnd() const {
+        return offset == size;
+    }
+};
@@ -2,117 +2,1453 @@
 #pragma once
 
 #include "../arch/ShaderCore.h"
+#include "../arch/LaneKernels.h"
 #include "../memory/GPUMemory.h"
+#include "../memory/MemoryPort.h"
+#include "../memory/DeviceAllocator.h"
 #include "../arch/Instruction.h"
+#include "../arch/KernelBinary.h"
 #include "Profiler.h" // Corrected path
+#include "ThreadPool.h"
+#include "Stream.h"
+#include "Checkpoint.h"
+#include "Log.h"
 
 #include <vector>
 #include <iostream>
 #include <numeric>
 #include <cmath>
 #include <chrono>
+#include <memory>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <cstdio>
+#include <string>
 
 class GPUSimulator {
 private:
+    static constexpr int kRegistersPerThread = 8;
+
     int num_sms;
     int threads_per_warp;
     int warps_per_sm;
 
     Profiler profiler;
     GPUMemory global_memory;
+    DeviceAllocator allocator;
     std::vector<ShaderCore> sms;
+    std::unique_ptr<ThreadPool> worker_pool;
+    std::unique_ptr<SharedCache> l2_cache;
+
+    // A kernel launch waiting on a stream or running in a batch.
+    struct PendingKernel {
+        std::shared_ptr<const DecodedKernel> kernel;
+        std::string name;
+        int grid_dim[3];
+        int block_dim[3];
+        long long first_block;      // Blocks of the grid this launch runs.
+        long long num_blocks;
+        int stream_id;
+        KernelLaunchResult outcome;
+        std::promise<KernelLaunchResult> result;
+    };
+
+    // An operation queued on a stream. Kernels that reach the head of their
+    // streams together run as one concurrent batch; everything else runs
+    // (instantly, in simulated time) as soon as it reaches the head.
+    struct StreamOp {
+        uint64_t sequence;
+        std::unique_ptr<PendingKernel> kernel;
+        std::function<void(long long cycle)> action;
+        std::shared_ptr<Event::State> wait_event;   // Waits for records_completed >= wait_record.
+        uint64_t wait_record;
+        long long until_cycle;      // Device cycle the op finishes at, if later than its start.
+    };
+
+    struct StreamQueue {
+        std::deque<StreamOp> ops;
+        long long completed_cycle = 0;      // Device cycle its latest operation finished.
+        uint64_t running_sequence = kNoSequence;  // Its kernel in the running batch.
+    };
+
+    static constexpr uint64_t kNoSequence = std::numeric_limits<uint64_t>::max();
+
+    // Kernels running on the SMs together. A batch that runs on deferred
+    // ports leaves global memory as it was at the start of the batch until
+    // the batch completes, so one the device stops part way can be saved in
+    // a checkpoint, resumed, or rerun serially from its start.
+    struct KernelBatch {
+        std::vector<std::unique_ptr<PendingKernel>> kernels;
+        std::vector<PendingKernel*> launched;       // Those with warps, in SM launch order.
+        std::vector<KernelLaunchConfig> configs;
+        std::vector<MemoryPort> ports;              // One per SM on the deferred path.
+        std::unique_ptr<Cache> l2_before;           // The L2 at the start, for a serial rerun.
+        std::vector<char> sm_success;
+        double duration_ms = 0;                     // Host time spent on the batch so far.
+        long long cycles = 0;
+    };
+
+    // Stream state, guarded by stream_mutex. The device thread drains the
+    // queues; host threads enqueue and wait for pending_ops to reach zero.
+    std::mutex stream_mutex;
+    std::condition_variable work_available;
+    std::condition_variable work_drained;
+    std::map<int, StreamQueue> streams;
+    int next_stream_id;
+    uint64_t next_sequence;
+    size_t pending_ops;
+    bool stopping;
+    long long device_cycle;
+    std::thread device_thread;
+
+    // Stopping part way (see setStopCycle()). The stopped batch waits here,
+    // its kernels still counted in pending_ops, until resume().
+    long long stop_cycle;
+    std::unique_ptr<KernelBatch> stopped_batch;
+    bool resume_requested;
+
+    bool executeAllSMsSerial() {
+        bool all_sms_completed = true;
+        for (ShaderCore& sm : sms) {
+            GPU_SIM_LOG(Trace, "\nExecuting warps on ShaderCore " << sm.getID() << "...");
+            MemoryPort port(global_memory);
+            port.setCycleOffset(static_cast<uint64_t>(device_cycle));
+            bool sm_success = sm.executeLaunches(port);
+            if (!sm_success) {
+                all_sms_completed = false;
+            }
+        }
+        return all_sms_completed;
+    }
+
+    // Starts a run of the batch on deferred ports: each SM gets its own
+    // MemoryPort, which leaves global memory untouched and records the words
+    // the SM read from it, and holds its timeline events.
+    void beginDeferredRun(KernelBatch& batch) {
+        batch.ports.clear();
+        batch.ports.reserve(sms.size());
+        for (ShaderCore& sm : sms) {
+            batch.ports.emplace_back(global_memory, true);
+            batch.ports.back().setCycleOffset(static_cast<uint64_t>(device_cycle));
+            sm.holdTimeline();
+        }
+        batch.l2_before = l2_cache ? std::make_unique<Cache>(l2_cache->snapshot()) : nullptr;
+        batch.sm_success.assign(sms.size(), 0);
+    }
+
+    // Runs every SM on its deferred port, or with resume continues those that
+    // stopped, on the pool workers if there are any. Returns false if an SM
+    // stopped at its stop cycle.
+    bool runDeferred(KernelBatch& batch, bool resume) {
+        auto run = [&](size_t i) {
+            if (!resume) {
+                batch.sm_success[i] = sms[i].executeLaunches(batch.ports[i]);
+            } else if (sms[i].isSuspended()) {
+                batch.sm_success[i] = sms[i].resumeLaunches(batch.ports[i]);
+            }
+        };
+        if (worker_pool) {
+            worker_pool->parallelFor(sms.size(), run);
+        } else {
+            for (size_t i = 0; i < sms.size(); ++i) {
+                run(i);
+            }
+        }
+        for (const ShaderCore& sm : sms) {
+            if (sm.isSuspended()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Ends a completed deferred run. If an SM read a word that a
+    // lower-numbered SM wrote or updated, the serial path would have shown
+    // it that SM's value: the run is then undone (ports discarded, the L2 and
+    // held timeline events restored) and false is returned so the caller
+    // runs the batch serially. Otherwise the ports are committed in SM order,
+    // which leaves global memory and the profiler's memory events exactly as
+    // executeAllSMsSerial() would. With host workers L2 hit counts depend on
+    // host timing either way.
+    bool commitDeferredRun(KernelBatch& batch, bool& all_sms_completed) {
+        std::vector<MemoryPort>& ports = batch.ports;
+        std::vector<AddressRange> modified;
+        for (size_t i = 0; i < sms.size(); ++i) {
+            if (i > 0 && rangesOverlap(ports[i].getReadRanges(), modified)) {
+                GPU_SIM_LOG(Info, "ShaderCore " << sms[i].getID() << " read global memory a lower-numbered SM"
+                            << " wrote in the same launch; running the launch serially.");
+                for (size_t j = 0; j < sms.size(); ++j) {
+                    ports[j].discard();
+                    sms[j].discardTimeline();
+                }
+                if (batch.l2_before) {
+                    l2_cache->restore(*batch.l2_before);
+                }
+                ports.clear();
+                return false;
+            }
+            std::vector<AddressRange> sm_modified = ports[i].getModifiedRanges();
+            modified.insert(modified.end(), sm_modified.begin(), sm_modified.end());
+            modified = coalesceRanges(std::move(modified));
+        }
+
+        all_sms_completed = true;
+        for (size_t i = 0; i < sms.size(); ++i) {
+            ports[i].commit();
+            sms[i].releaseTimeline();
+            if (!batch.sm_success[i]) {
+                all_sms_completed = false;
+            }
+        }
+        ports.clear();
+        return true;
+    }
+
+    // Converts a device stop cycle into the SMs' stop cycle for a batch that
+    // started at device_cycle.
+    void setSMStopCycles(long long stop) {
+        for (ShaderCore& sm : sms) {
+            sm.setStopCycle(stop < 0 ? -1 : std::max(stop - device_cycle, 0LL));
+        }
+    }
+
+    // Blocks are dealt round-robin to SMs; each SM materializes its blocks'
+    // warps only when it has resident slots for them.
+    void assignBlocks(const std::vector<PendingKernel*>& launched, const std::vector<KernelLaunchConfig>& configs,
+                      TimelineWriter* timeline) {
+        for (ShaderCore& sm : sms) {
+            sm.setTimelineWriter(timeline);
+            sm.clearWarps();
+            sm.setMaxResidentWarps(warps_per_sm);
+            for (size_t k = 0; k < launched.size(); ++k) {
+                sm.addKernel(*launched[k]->kernel, configs[k], sm.getID(), num_sms);
+            }
+        }
+    }
+
+    static std::string dimString(const int dim[3]) {
+        return "(" + std::to_string(dim[0]) + "," + std::to_string(dim[1]) + "," + std::to_string(dim[2]) + ")";
+    }
+
+    // Runs a batch of kernels from different streams concurrently on the SMs,
+    // starting at device_cycle, and fills in their outcomes and the cycles
+    // the batch took. Each SM admits the blocks of the batch's kernels in
+    // batch order. With a non-negative stop the SMs stop at device cycle stop,
+    // or as soon as their blocks are dispatched if the batch starts later;
+    // false is then returned and resumeKernelBatch() continues the batch.
+    bool runKernelBatch(KernelBatch& batch, long long stop) {
+        std::vector<PendingKernel*>& launched = batch.launched;
+        std::vector<KernelLaunchConfig>& configs = batch.configs;
+        for (std::unique_ptr<PendingKernel>& pending : batch.kernels) {
+            if (pending->kernel->getNumRegisters() != kRegistersPerThread) {
+                GPU_SIM_LOG(Warning, "Warning: Kernel was decoded for " << pending->kernel->getNumRegisters()
+                            << " registers per thread; redecoding for " << kRegistersPerThread << ".");
+                pending->kernel = std::make_shared<const DecodedKernel>(pending->kernel->getSource(), kRegistersPerThread);
+            }
+
+            GPU_SIM_LOG(Info, "\n--- Launching Kernel: " << pending->name << " ---");
+            if (pending->stream_id != 0) {
+                GPU_SIM_LOG(Info, "  Stream: " << pending->stream_id);
+            }
+            GPU_SIM_LOG(Info, "  Grid Dimensions: (" << pending->grid_dim[0] << ", " << pending->grid_dim[1] << ", " << pending->grid_dim[2] << ")");
+            GPU_SIM_LOG(Info, "  Block Dimensions: (" << pending->block_dim[0] << ", " << pending->block_dim[1] << ", " << pending->block_dim[2] << ")");
+
+            long long total_blocks = static_cast<long long>(pending->grid_dim[0]) * pending->grid_dim[1] * pending->grid_dim[2];
+            long long threads_per_block = static_cast<long long>(pending->block_dim[0]) * pending->block_dim[1] * pending->block_dim[2];
+            KernelLaunchConfig launch_config(pending->num_blocks, static_cast<int>(threads_per_block),
+                                             threads_per_warp, kRegistersPerThread);
+            launch_config.first_block = pending->first_block;
+            if (pending->num_blocks != total_blocks) {
+                GPU_SIM_LOG(Info, "  Blocks: " << pending->first_block << " to "
+                            << pending->first_block + pending->num_blocks - 1 << " of " << total_blocks);
+            }
+
+            GPU_SIM_LOG(Info, "  Total Threads to launch: " << launch_config.totalThreads());
+            GPU_SIM_LOG(Info, "  Total Warps to launch: " << launch_config.totalWarps());
+
+            pending->outcome = KernelLaunchResult();
+            pending->outcome.stream_id = pending->stream_id;
+            pending->outcome.start_cycle = device_cycle;
+            pending->outcome.end_cycle = device_cycle;
+            if (launch_config.totalWarps() == 0) {
+                GPU_SIM_LOG(Info, "No warps to launch. Kernel launch aborted.");
+                continue;
+            }
+            if (sms.empty()) {
+                GPU_SIM_LOG(Error, "Error: No ShaderCores available in GPUSimulator to launch warps.");
+                continue;
+            }
+            if (pending->kernel->getNumRewritten() > 0) {
+                GPU_SIM_LOG(Warning, "Warning: " << pending->kernel->getNumRewritten()
+                            << " kernel instruction(s) have invalid operands; see errors above.");
+            }
+            launched.push_back(pending.get());
+            configs.push_back(launch_config);
+        }
+        if (launched.empty()) {
+            batch.cycles = 0;
+            return true;
+        }
+
+        profiler.startProfiling();
+        auto segment_start_time = std::chrono::high_resolution_clock::now();
+        TimelineWriter* timeline = profiler.getActiveTimelineWriter();
+        if (timeline) {
+            timeline->setCycleOffset(device_cycle);
+        }
+
+        assignBlocks(launched, configs, timeline);
+        setSMStopCycles(stop);
+        if (stop >= 0 || worker_pool) {
+            beginDeferredRun(batch);
+            if (!runDeferred(batch, false)) {
+                batch.duration_ms += elapsedMilliseconds(segment_start_time);
+                return false;
+            }
+        }
+        finishKernelBatch(batch, segment_start_time);
+        return true;
+    }
+
+    // Continues a batch that stopped: the SMs that stopped run on to stop,
+    // or to completion if it is negative, and the batch is finished as by
+    // runKernelBatch().
+    bool resumeKernelBatch(KernelBatch& batch, long long stop) {
+        profiler.startProfiling();
+        auto segment_start_time = std::chrono::high_resolution_clock::now();
+        TimelineWriter* timeline = profiler.getActiveTimelineWriter();
+        if (timeline) {
+            timeline->setCycleOffset(device_cycle);
+        }
+        for (ShaderCore& sm : sms) {
+            sm.setTimelineWriter(timeline);
+        }
+        setSMStopCycles(stop);
+        if (!runDeferred(batch, true)) {
+            batch.duration_ms += elapsedMilliseconds(segment_start_time);
+            return false;
+        }
+        finishKernelBatch(batch, segment_start_time);
+        return true;
+    }
+
+    static double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        return elapsed.count();
+    }
+
+    // Completes a batch whose SMs have all finished: commits a deferred run,
+    // or runs the batch serially if there was none or it had to be undone,
+    // then reports each kernel to the profiler and fills in its outcome.
+    void finishKernelBatch(KernelBatch& batch, std::chrono::high_resolution_clock::time_point segment_start_time) {
+        const std::vector<PendingKernel*>& launched = batch.launched;
+        TimelineWriter* timeline = profiler.getActiveTimelineWriter();
+        bool all_sms_completed = false;
+        bool deferred = !batch.ports.empty();
+        if (!deferred || !commitDeferredRun(batch, all_sms_completed)) {
+            if (deferred) {
+                assignBlocks(launched, batch.configs, timeline);
+                setSMStopCycles(-1);
+            }
+            all_sms_completed = executeAllSMsSerial();
+        }
+        batch.l2_before.reset();
+
+        // SMs run concurrently in simulated time, so the batch takes as many
+        // cycles as the slowest SM, and each kernel ends when its last warp
+        // on any SM does.
+        long long batch_cycles = 0;
+        CacheStats l1_stats;
+        for (const ShaderCore& sm : sms) {
+            l1_stats.merge(sm.getL1Stats());
+            batch_cycles = std::max(batch_cycles, sm.getCyclesExecuted());
+        }
+        CacheStats l2_stats = l2_cache ? l2_cache->takeStats() : CacheStats();
+        const double kernel_duration_ms = batch.duration_ms + elapsedMilliseconds(segment_start_time);
+
+        const int concurrent_kernels = static_cast<int>(launched.size());
+        for (size_t k = 0; k < launched.size(); ++k) {
+            PendingKernel& pending = *launched[k];
+            const KernelProgram& kernel_program = pending.kernel->getSource();
+            long long kernel_cycles = 0;
+            long long functional_instructions = 0;
+            SampledCycles sampling;
+            long long sampled_upper = 0;
+            long long sampled_lower = 0;
+            long long active_lane_slots = 0;
+            long long lane_slots = 0;
+            std::vector<InstructionMemoryStats> memory_stats(kernel_program.size());
+            KernelCounters counters;
+            counters.instructions.resize(kernel_program.size());
+            for (const ShaderCore& sm : sms) {
+                if (k >= sm.getKernelStats().size()) {
+                    continue;
+                }
+                const SMKernelStats& sm_stats = sm.getKernelStats()[k];
+                kernel_cycles = std::max(kernel_cycles, sm_stats.completion_cycle);
+                functional_instructions += sm_stats.functional_instructions;
+                sampling.detailed_blocks += sm_stats.sampling.detailed_blocks;
+                sampling.total_blocks += sm_stats.sampling.total_blocks;
+                sampled_upper = std::max(sampled_upper, sm_stats.sampling.cycles + sm_stats.sampling.error_cycles);
+                sampled_lower = std::max(sampled_lower, sm_stats.sampling.cycles - sm_stats.sampling.error_cycles);
+                active_lane_slots += sm_stats.active_lane_slots;
+                lane_slots += sm_stats.lane_slots;
+                for (size_t pc = 0; pc < sm_stats.memory_stats.size() && pc < memory_stats.size(); ++pc) {
+                    memory_stats[pc].merge(sm_stats.memory_stats[pc]);
+                }
+                counters.totals.merge(sm_stats.counters);
+                counters.sms.push_back(SMCounters{sm.getID(), sm_stats.counters});
+                counters.warps.insert(counters.warps.end(), sm_stats.warp_counters.begin(), sm_stats.warp_counters.end());
+                for (size_t pc = 0; pc < sm_stats.instruction_counters.size() && pc < counters.instructions.size(); ++pc) {
+                    counters.instructions[pc].merge(sm_stats.instruction_counters[pc]);
+                }
+            }
+            std::sort(counters.warps.begin(), counters.warps.end(),
+                      [](const WarpCounters& a, const WarpCounters& b) { return a.warp_id < b.warp_id; });
+            for (const Instruction& instr : kernel_program) {
+                counters.listing.push_back(instr.toString());
+            }
+            const long long kernel_instructions = counters.totals.instructions_issued + functional_instructions;
+            if (concurrent_kernels == 1) {
+                kernel_cycles = batch_cycles;
+            }
+            // The kernel ends with its slowest SM, so its bound spans every
+            // SM's interval.
+            sampling.cycles = kernel_cycles;
+            if (sampling.isSampled()) {
+                sampling.error_cycles = std::max(sampled_upper - kernel_cycles, kernel_cycles - sampled_lower);
+                GPU_SIM_LOG(Info, "  Sampled: " << sampling.detailed_blocks << " of " << sampling.total_blocks
+                            << " blocks in detail, cycles +/- " << sampling.error_cycles << " (95%)");
+            }
+            std::vector<InstructionMemoryStats> memory_instructions;
+            for (size_t pc = 0; pc < memory_stats.size(); ++pc) {
+                if (memory_stats[pc].warp_requests > 0) {
+                    memory_stats[pc].pc = static_cast<int>(pc);
+                    memory_stats[pc].instruction = kernel_program[pc].toString();
+                    memory_instructions.push_back(memory_stats[pc]);
+                }
+            }
+            GPU_SIM_LOG(Info, "  Simulated cycles: " << kernel_cycles << ", warp instructions issued: " << kernel_instructions);
+
+            profiler.logKernelExecution(pending.name, dimString(pending.grid_dim), dimString(pending.block_dim),
+                                        kernel_duration_ms, kernel_cycles, kernel_instructions);
+            profiler.logInstructionMemoryStats(std::move(memory_instructions));
+            profiler.logKernelCounters(std::move(counters));
+            profiler.logKernelSampling(sampling);
+            // Concurrent kernels share the caches; the batch's counters go
+            // with its first kernel.
+            if (k == 0) {
+                profiler.logCacheStats(l1_stats, l2_stats);
+            }
+            profiler.logLaneUtilization(active_lane_slots, lane_slots);
+            profiler.logKernelTimeline(pending.stream_id, device_cycle, device_cycle + kernel_cycles, concurrent_kernels);
+            if (timeline) {
+                timeline->appendKernel(pending.name, pending.stream_id, device_cycle, device_cycle + kernel_cycles);
+            }
+
+            KernelLaunchResult& outcome = pending.outcome;
+            outcome.completed = all_sms_completed;
+            outcome.end_cycle = device_cycle + kernel_cycles;
+            outcome.warp_instructions = kernel_instructions;
+            outcome.cycle_error = sampling.error_cycles;
+            outcome.concurrent_kernels = concurrent_kernels;
+        }
+        profiler.stopProfiling();
+
+        if (all_sms_completed) {
+            GPU_SIM_LOG(Info, "\n--- Kernel Launch Completed Successfully ---");
+        } else {
+            GPU_SIM_LOG(Info, "\n--- Kernel Launch Completed with Issues ---");
+        }
+        batch.cycles = batch_cycles;
+    }
+
+    // Oldest operation of a stream that has not finished: its kernel in the
+    // running batch, or the head of its queue.
+    static uint64_t oldestUnfinished(const StreamQueue& queue) {
+        if (queue.running_sequence != kNoSequence) {
+            return queue.running_sequence;
+        }
+        return queue.ops.empty() ? kNoSequence : queue.ops.front().sequence;
+    }
+
+    // Whether the head op of stream_id may start, and if so the device cycle
+    // it starts at (after its stream, the event it waits for and, for the
+    // default stream, everything before it).
+    bool headReady(int stream_id, const StreamOp& op, long long& start_cycle) {
+        StreamQueue& queue = streams[stream_id];
+        start_cycle = queue.completed_cycle;
+        for (const auto& entry : streams) {
+            if (entry.first == stream_id) {
+                continue;
+            }
+            bool orders = stream_id == 0 || entry.first == 0;
+            if (orders && oldestUnfinished(entry.second) < op.sequence) {
+                return false;
+            }
+            if (orders) {
+                start_cycle = std::max(start_cycle, entry.second.completed_cycle);
+            }
+        }
+        if (op.wait_event) {
+            std::lock_guard<std::mutex> lock(op.wait_event->mutex);
+            if (op.wait_event->records_completed < op.wait_record) {
+                return false;
+            }
+            start_cycle = std::max(start_cycle, op.wait_event->cycle);
+        }
+        return true;
+    }
+
+    // Runs every ready non-kernel op and moves the ready kernels (at most one
+    // per stream) into batch. Called by the device thread with stream_mutex
+    // held.
+    void collectReadyWork(std::vector<std::unique_ptr<PendingKernel>>& batch) {
+        bool progressed = true;
+        while (progressed) {
+            progressed = false;
+            for (auto& entry : streams) {
+                StreamQueue& queue = entry.second;
+                while (!queue.ops.empty() && queue.running_sequence == kNoSequence) {
+                    StreamOp& op = queue.ops.front();
+                    long long start_cycle = 0;
+                    if (!headReady(entry.first, op, start_cycle)) {
+                        break;
+                    }
+                    if (op.kernel) {
+                        queue.running_sequence = op.sequence;
+                        queue.completed_cycle = start_cycle;
+                        batch.push_back(std::move(op.kernel));
+                        queue.ops.pop_front();
+                        break;
+                    }
+                    if (op.action) {
+                        op.action(start_cycle);
+                    }
+                    queue.completed_cycle = std::max(start_cycle, op.until_cycle);
+                    device_cycle = std::max(device_cycle, op.until_cycle);
+                    queue.ops.pop_front();
+                    pending_ops--;
+                    progressed = true;
+                }
+            }
+        }
+    }
+
+    void deviceLoop() {
+        std::unique_lock<std::mutex> lock(stream_mutex);
+        while (true) {
+            work_available.wait(lock, [this] {
+                return stopping || (pending_ops > 0 && (!stopped_batch || resume_requested));
+            });
+            if (pending_ops == 0 || (stopped_batch && !resume_requested)) {
+                return;
+            }
+            std::unique_ptr<KernelBatch> batch = std::move(stopped_batch);
+            const bool resuming = batch != nullptr;
+            resume_requested = false;
+            if (!resuming) {
+                batch = std::make_unique<KernelBatch>();
+                collectReadyWork(batch->kernels);
+                for (const std::unique_ptr<PendingKernel>& pending : batch->kernels) {
+                    device_cycle = std::max(device_cycle, streams[pending->stream_id].completed_cycle);
+                }
+            }
+            if (!batch->kernels.empty()) {
+                const long long stop = stop_cycle;
+                lock.unlock();
+                bool finished = resuming ? resumeKernelBatch(*batch, stop) : runKernelBatch(*batch, stop);
+                lock.lock();
+
+                if (!finished) {
+                    GPU_SIM_LOG(Info, "Device stopped at cycle " << stop << "; resume() continues the running kernels.");
+                    stop_cycle = -1;
+                    stopped_batch = std::move(batch);
+                    work_drained.notify_all();
+                    continue;
+                }
+                device_cycle += batch->cycles;
+                for (std::unique_ptr<PendingKernel>& pending : batch->kernels) {
+                    StreamQueue& queue = streams[pending->stream_id];
+                    queue.running_sequence = kNoSequence;
+                    queue.completed_cycle = pending->outcome.end_cycle;
+                    pending_ops--;
+                    pending->result.set_value(pending->outcome);
+                }
+            }
+            if (pending_ops == 0) {
+                work_drained.notify_all();
+            }
+        }
+    }
+
+    // Queues op on stream, starting the device thread on first use.
+    void enqueue(const Stream& stream, StreamOp op) {
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        op.sequence = next_sequence++;
+        streams[stream.getID()].ops.push_back(std::move(op));
+        pending_ops++;
+        if (!device_thread.joinable()) {
+            device_thread = std::thread(&GPUSimulator::deviceLoop, this);
+        }
+        work_available.notify_one();
+    }
+
+    // Runs work on the device thread in default-stream order and waits for it.
+    void runOnDefaultStream(const std::function<void()>& work) {
+        std::promise<void> done;
+        std::future<void> finished = done.get_future();
+        StreamOp op{};
+        op.action = [&work, &done](long long) {
+            work();
+            done.set_value();
+        };
+        enqueue(Stream(), std::move(op));
+        finished.wait();
+    }
+
+    // Drops a stopped batch without finishing it: what its ports staged is
+    // discarded, and its kernels' futures report a broken promise.
+    void abandonStoppedBatch() {
+        if (!stopped_batch) {
+            return;
+        }
+        for (MemoryPort& port : stopped_batch->ports) {
+            port.discard();
+        }
+        stopped_batch.reset();
+    }
+
+    // A kernel of a stopped batch, as saveCheckpoint() stores it: its source
+    // program rather than the decoded form, its launch and its config if it
+    // was launched on the SMs. Fails if the program cannot be encoded.
+    bool savePendingKernel(CheckpointWriter& writer, const KernelBatch& batch, const PendingKernel& pending) const {
+        std::vector<EncodedInstruction> encoded;
+        if (!encodeKernel(pending.kernel->getSource(), encoded)) {
+            return false;
+        }
+        writer.writeVector(encoded);
+        writer.write<uint8_t>(pending.kernel->getNumFused() > 0 ? 1 : 0);
+        writer.writeString(pending.name);
+        for (int d = 0; d < 3; ++d) {
+            writer.write<int32_t>(pending.grid_dim[d]);
+            writer.write<int32_t>(pending.block_dim[d]);
+        }
+        writer.write<int64_t>(pending.first_block);
+        writer.write<int64_t>(pending.num_blocks);
+        writer.write<int32_t>(pending.stream_id);
+        writer.write(pending.outcome);
+        auto launched = std::find(batch.launched.begin(), batch.launched.end(), &pending);
+        writer.write<uint8_t>(launched != batch.launched.end() ? 1 : 0);
+        if (launched != batch.launched.end()) {
+            writer.write(batch.configs[static_cast<size_t>(launched - batch.launched.begin())]);
+        }
+        return true;
+    }
+
+    bool restorePendingKernel(CheckpointReader& reader, KernelBatch& batch) {
+        std::vector<EncodedInstruction> encoded;
+        uint8_t fused = 0, launched = 0;
+        auto pending = std::make_unique<PendingKernel>();
+        int32_t dims[6] = {};
+        int64_t first_block = 0, num_blocks = 0;
+        int32_t stream_id = 0;
+        reader.readVector(encoded);
+        reader.read(fused);
+        reader.readString(pending->name);
+        for (int32_t& dim : dims) {
+            reader.read(dim);
+        }
+        reader.read(first_block);
+        reader.read(num_blocks);
+        reader.read(stream_id);
+        reader.read(pending->outcome);
+        reader.read(launched);
+        KernelLaunchConfig config(0, 0, 1, 0);
+        if (launched) {
+            reader.read(config);
+        }
+        if (!reader.ok()) {
+            return false;
+        }
+        pending->kernel = std::make_shared<const DecodedKernel>(decodeKernelBinary(encoded.data(), encoded.size()),
+                                                                kRegistersPerThread, fused != 0);
+        for (int d = 0; d < 3; ++d) {
+            pending->grid_dim[d] = dims[2 * d];
+            pending->block_dim[d] = dims[2 * d + 1];
+        }
+        pending->first_block = first_block;
+        pending->num_blocks = num_blocks;
+        pending->stream_id = stream_id;
+        if (launched) {
+            batch.launched.push_back(pending.get());
+            batch.configs.push_back(config);
+        }
+        batch.kernels.push_back(std::move(pending));
+        return true;
+    }
+
+    template <typename T>
+    bool checkBufferRange(const DeviceBuffer<T>& buffer, size_t offset, size_t count, const char* operation) const {
+        if (buffer.isNull() || offset > buffer.size() || count > buffer.size() - offset
+            || !global_memory.isValidRange(buffer.addressOf(offset), static_cast<int>(count))) {
+            GPU_SIM_LOG(Error, "Error: " << operation << " of " << count << " elements at offset " << offset
+                        << " is outside the " << buffer.size() << "-element buffer at address "
+                        << buffer.getAddress() << ".");
+            return false;
+        }
+        return true;
+    }
 
 public:
-    GPUSimulator(size_t global_memory_size, int num_sms, int threads_per_warp, int warps_per_sm)
-        : profiler(),
-          global_memory(global_memory_size, &profiler),
-          num_sms(num_sms),
+    // memory_page_bytes selects GPUMemory's page size (GPUMemory::kSmallPageBytes
+    // or GPUMemory::kLargePageBytes).
+    GPUSimulator(size_t global_memory_size, int num_sms, int threads_per_warp, int warps_per_sm,
+                 size_t memory_page_bytes = GPUMemory::kSmallPageBytes)
+        : num_sms(num_sms),
           threads_per_warp(threads_per_warp),
-          warps_per_sm(warps_per_sm)
+          warps_per_sm(warps_per_sm),
+          profiler(),
+          global_memory(global_memory_size, &profiler, memory_page_bytes),
+          allocator(global_memory),
+          next_stream_id(1),
+          next_sequence(0),
+          pending_ops(0),
+          stopping(false),
+          device_cycle(0),
+          stop_cycle(-1),
+          resume_requested(false)
     {
         if (num_sms <= 0 || threads_per_warp <= 0 || warps_per_sm <= 0) {
-            std::cerr << "Warning: GPUSimulator initialized with non-positive configuration values." << std::endl;
+            GPU_SIM_LOG(Warning, "Warning: GPUSimulator initialized with non-positive configuration values.");
         }
 
         for (int i = 0; i < num_sms; ++i) {
             sms.emplace_back(i);
         }
-        std::cout << "GPUSimulator initialized with " << num_sms << " ShaderCores." << std::endl;
+        GPU_SIM_LOG(Info, "GPUSimulator initialized with " << num_sms << " ShaderCores.");
+        const LaneKernels::Table& lane_kernels = LaneKernels::forWidth(threads_per_warp);
+        GPU_SIM_LOG(Info, "Lane kernels: " << LaneKernels::isaToString(lane_kernels.isa) << ", "
+                    << (lane_kernels.width > 0 ? "unrolled for " + std::to_string(lane_kernels.width) + " lanes"
+                                               : std::string("generic warp width")) << ".");
+        streams[0];
+    }
+
+    ~GPUSimulator() {
+        synchronize();
+        {
+            std::lock_guard<std::mutex> lock(stream_mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        if (device_thread.joinable()) {
+            device_thread.join();
+        }
+        abandonStoppedBatch();
+    }
+
+    GPUSimulator(const GPUSimulator&) = delete;
+    GPUSimulator& operator=(const GPUSimulator&) = delete;
+
+    // Runs the ShaderCores of each launch on a pool of num_workers host threads.
+    // A value of 0 or 1 selects the serial path. Memory images match the
+    // serial path; a launch in which an SM reads a word a lower-numbered SM
+    // writes is run serially (see executeAllSMsParallel()). This and the
+    // other setters below first wait for queued stream work to finish.
+    void setHostWorkerThreads(int num_workers) {
+        synchronize();
+        if (num_workers <= 1) {
+            worker_pool.reset();
+            return;
+        }
+        worker_pool = std::make_unique<ThreadPool>(static_cast<size_t>(num_workers));
+        GPU_SIM_LOG(Info, "GPUSimulator will run ShaderCores on " << num_workers << " host threads.");
+    }
+
+    int getHostWorkerThreads() const {
+        return worker_pool ? static_cast<int>(worker_pool->getNumWorkers()) : 1;
+    }
+
+    // Selects the warp issue policy and per-SM issue width (instructions issued
+    // per cycle) for subsequent launches. two_level_active_warps sizes the
+    // active set of the TwoLevel policy.
+    void setWarpScheduler(SchedulerPolicy policy, int issue_width = 1, int two_level_active_warps = 4) {
+        synchronize();
+        for (ShaderCore& sm : sms) {
+            sm.setScheduler(makeWarpScheduler(policy, static_cast<size_t>(std::max(two_level_active_warps, 1))));
+            sm.setIssueWidth(issue_width);
+        }
+        GPU_SIM_LOG(Info, "GPUSimulator using " << schedulerPolicyToString(policy)
+                    << " warp scheduler with issue width " << std::max(issue_width, 1) << ".");
+    }
+
+    // Configures the global memory timing model (segment size, latency and
+    // per-SM bandwidth) for subsequent launches.
+    void setMemoryTiming(const MemoryTimingConfig& config) {
+        synchronize();
+        if (!MemoryTimingConfig::isValidSegmentSize(config.segment_bytes)) {
+            GPU_SIM_LOG(Warning, "Warning: Unsupported memory segment size " << config.segment_bytes
+                        << " bytes; using 128.");
+        }
+        for (ShaderCore& sm : sms) {
+            sm.setMemoryTiming(config);
+        }
+    }
+
+    // Configures per-block shared memory (sizes, banks and latency) for
+    // subsequent launches.
+    void setSharedMemory(const SharedMemoryConfig& config) {
+        synchronize();
+        for (ShaderCore& sm : sms) {
+            sm.setSharedMemory(config);
+        }
+        GPU_SIM_LOG(Info, "GPUSimulator shared memory: " << config.block_words << " words per block, "
+                    << config.sm_words << " per SM, " << config.num_banks << " banks.");
+    }
+
+    // Sets how long serialized atomic updates of one word take, for
+    // subsequent launches. With host worker threads the SMs' atomics hit
+    // global memory in whatever order the threads reach them, so old values
+    // returned by ATOM (and CAS outcomes) can vary from run to run; the
+    // memory image after ADD and MAX cannot.
+    void setAtomicTiming(const AtomicTimingConfig& config) {
+        synchronize();
+        for (ShaderCore& sm : sms) {
+            sm.setAtomicTiming(config);
+        }
+        GPU_SIM_LOG(Info, "GPUSimulator atomics: " << config.cycles_per_update << " cycles per serialized update.");
+    }
+
+    // Turns on sampled simulation for subsequent launches: on each SM only
+    // every sample_period-th unit of its blocks runs cycle by cycle, the rest
+    // functionally, and the kernel's cycles are extrapolated with a 95% error
+    // bound (KernelLaunchResult::cycle_error). Kernels sharing the SMs with
+    // another one run in full detail.
+    void setSampling(const SamplingConfig& config) {
+        synchronize();
+        for (ShaderCore& sm : sms) {
+            sm.setSampling(config);
+        }
+        GPU_SIM_LOG(Info, "GPUSimulator sampling: " << (config.sample_period > 1
+                    ? "1 unit in " + std::to_string(config.sample_period) + " in detail." : "off."));
+    }
+
+    // Places a private L1 in front of global memory on every SM and an L2
+    // shared by all SMs behind them, for subsequent launches. A config with
+    // size_bytes 0 disables that level. The caches only model timing and hit
+    // rates; data is always read from and written to global memory. With
+    // host worker threads the SMs probe the L2 concurrently, so L2 counters
+    // (though never results) can vary from run to run.
+    void setCaches(const CacheConfig& l1_config, const CacheConfig& l2_config) {
+        synchronize();
+        l2_cache = l2_config.isEnabled() ? std::make_unique<SharedCache>(l2_config) : nullptr;
+        for (ShaderCore& sm : sms) {
+            sm.setCaches(l1_config, l2_cache.get());
+        }
+        GPU_SIM_LOG(Info, "GPUSimulator caches: L1 " << l1_config.size_bytes << " bytes per SM, L2 "
+                    << l2_config.size_bytes << " bytes shared.");
+    }
+
+    // Opt-in per-instruction register dumps (printed at the Trace log level).
+    void enableWarpStateDumpsForSM(int sm_id) {
+        if (sm_id < 0 || sm_id >= static_cast<int>(sms.size())) {
+            GPU_SIM_LOG(Error, "Error: Cannot enable state dumps for unknown ShaderCore " << sm_id << ".");
+            return;
+        }
+        sms[sm_id].setWarpStateDumps(true);
+    }
+
+    void enableWarpStateDumpsForWarp(int warp_id) {
+        for (ShaderCore& sm : sms) {
+            sm.addWarpStateDump(warp_id);
+        }
+    }
+
+    void disableWarpStateDumps() {
+        for (ShaderCore& sm : sms) {
+            sm.clearWarpStateDumps();
+        }
     }
 
     GPUMemory& getGlobalMemory() {
         return global_memory;
     }
 
+    DeviceAllocator& getAllocator() {
+        return allocator;
+    }
+
+    // Allocates count elements of global memory; see DeviceAllocator. The
+    // result is null if memory is exhausted.
+    template <typename T>
+    DeviceBuffer<T> deviceMalloc(size_t count) {
+        return allocator.allocateBuffer<T>(count);
+    }
+
+    // Frees buffer once all queued work has finished, and nulls the handle.
+    template <typename T>
+    bool deviceFree(DeviceBuffer<T>& buffer) {
+        synchronize();
+        return allocator.releaseBuffer(buffer);
+    }
+
+    // Synchronous bulk copies and fill on the default stream. Each moves the
+    // whole range with one page-wise copy and is logged as one transfer,
+    // rather than as per-element reads and writes.
+    template <typename T>
+    bool memcpyHostToDevice(const DeviceBuffer<T>& destination, const T* source, size_t count,
+                            size_t destination_offset = 0) {
+        if (!checkBufferRange(destination, destination_offset, count, "Host-to-device copy")) {
+            return false;
+        }
+        int address = destination.addressOf(destination_offset);
+        runOnDefaultStream([&] {
+            global_memory.copyIn(address, reinterpret_cast<const int*>(source), count);
+            profiler.logMemoryTransfer(TransferKind::HostToDevice, address, count * sizeof(T));
+        });
+        return true;
+    }
+
+    template <typename T>
+    bool memcpyDeviceToHost(T* destination, const DeviceBuffer<T>& source, size_t count,
+                            size_t source_offset = 0) {
+        if (!checkBufferRange(source, source_offset, count, "Device-to-host copy")) {
+            return false;
+        }
+        int address = source.addressOf(source_offset);
+        runOnDefaultStream([&] {
+            global_memory.copyOut(address, reinterpret_cast<int*>(destination), count);
+            profiler.logMemoryTransfer(TransferKind::DeviceToHost, address, count * sizeof(T));
+        });
+        return true;
+    }
+
+    // Sets every byte of count elements from offset to byte_value, like
+    // cudaMemset.
+    template <typename T>
+    bool memset(const DeviceBuffer<T>& destination, int byte_value, size_t count, size_t offset = 0) {
+        if (!checkBufferRange(destination, offset, count, "Memset")) {
+            return false;
+        }
+        int address = destination.addressOf(offset);
+        int word = static_cast<int>((byte_value & 0xff) * 0x01010101u);
+        runOnDefaultStream([&] {
+            global_memory.fill(address, word, count);
+            profiler.logMemoryTransfer(TransferKind::Memset, address, count * sizeof(T));
+        });
+        return true;
+    }
+
+    template <typename T>
+    bool memset(const DeviceBuffer<T>& destination, int byte_value) {
+        return memset(destination, byte_value, destination.size());
+    }
+
+    // Registers per thread that kernels are decoded for; use it when decoding
+    // kernels ahead of time (e.g. through a KernelCache).
+    static constexpr int getRegistersPerThread() {
+        return kRegistersPerThread;
+    }
+
+    // Launches a kernel on the default stream and waits for it to finish.
+    // kernel_name labels the launch in the profiler's reports.
     void launchKernel(const KernelProgram& kernel_program,
                       int grid_dim_x, int grid_dim_y, int grid_dim_z,
-                      int block_dim_x, int block_dim_y, int block_dim_z) {
+                      int block_dim_x, int block_dim_y, int block_dim_z,
+                      const std::string& kernel_name = "kernel") {
+        // Validate and decode the kernel once for the whole launch.
+        launchKernel(DecodedKernel(kernel_program, kRegistersPerThread),
+                     grid_dim_x, grid_dim_y, grid_dim_z, block_dim_x, block_dim_y, block_dim_z, kernel_name);
+    }
 
-        std::cout << "\n--- Launching Kernel ---" << std::endl;
-        std::cout << "  Grid Dimensions: (" << grid_dim_x << ", " << grid_dim_y << ", " << grid_dim_z << ")" << std::endl;
-        std::cout << "  Block Dimensions: (" << block_dim_x << ", " << block_dim_y << ", " << block_dim_z << ")" << std::endl;
+    // Launches an already decoded kernel, skipping validation.
+    void launchKernel(const DecodedKernel& decoded_kernel,
+                      int grid_dim_x, int grid_dim_y, int grid_dim_z,
+                      int block_dim_x, int block_dim_y, int block_dim_z,
+                      const std::string& kernel_name = "kernel") {
+        // The launch is waited for, so the kernel can be borrowed.
+        std::shared_ptr<const DecodedKernel> borrowed(std::shared_ptr<const DecodedKernel>(), &decoded_kernel);
+        launchKernelAsync(Stream(), borrowed, grid_dim_x, grid_dim_y, grid_dim_z,
+                          block_dim_x, block_dim_y, block_dim_z, kernel_name).wait();
+    }
+
+    // A new stream; see Stream for the ordering rules.
+    Stream createStream() {
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        int id = next_stream_id++;
+        streams[id];
+        return Stream(id);
+    }
 
+    // Queues a kernel launch on stream and returns immediately. The future
+    // becomes ready once the kernel has run; kernels that reach the head of
+    // different streams together run concurrently on the SMs.
+    std::future<KernelLaunchResult> launchKernelAsync(const Stream& stream, const KernelProgram& kernel_program,
+                                                      int grid_dim_x, int grid_dim_y, int grid_dim_z,
+                                                      int block_dim_x, int block_dim_y, int block_dim_z,
+                                                      const std::string& kernel_name = "kernel") {
+        return launchKernelAsync(stream, std::make_shared<const DecodedKernel>(kernel_program, kRegistersPerThread),
+                                 grid_dim_x, grid_dim_y, grid_dim_z, block_dim_x, block_dim_y, block_dim_z, kernel_name);
+    }
+
+    std::future<KernelLaunchResult> launchKernelAsync(const Stream& stream, std::shared_ptr<const DecodedKernel> kernel,
+                                                      int grid_dim_x, int grid_dim_y, int grid_dim_z,
+                                                      int block_dim_x, int block_dim_y, int block_dim_z,
+                                                      const std::string& kernel_name = "kernel") {
         long long total_blocks = static_cast<long long>(grid_dim_x) * grid_dim_y * grid_dim_z;
-        long long threads_per_block = static_cast<long long>(block_dim_x) * block_dim_y * block_dim_z;
-        long long total_threads = total_blocks * threads_per_block;
+        return launchKernelBlocksAsync(stream, std::move(kernel), grid_dim_x, grid_dim_y, grid_dim_z,
+                                       block_dim_x, block_dim_y, block_dim_z, 0, total_blocks, kernel_name);
+    }
 
-        long long total_warps = static_cast<long long>(std::ceil(static_cast<double>(total_threads) / threads_per_warp));
+    // Like launchKernelAsync(), but runs only num_blocks blocks of the grid
+    // starting at linear block index first_block (clamped to the grid). Their
+    // threads keep the IDs they have in the whole grid, and so address the
+    // same memory, which lets a grid be split across devices.
+    std::future<KernelLaunchResult> launchKernelBlocksAsync(const Stream& stream, std::shared_ptr<const DecodedKernel> kernel,
+                                                            int grid_dim_x, int grid_dim_y, int grid_dim_z,
+                                                            int block_dim_x, int block_dim_y, int block_dim_z,
+                                                            long long first_block, long long num_blocks,
+                                                            const std::string& kernel_name = "kernel") {
+        long long total_blocks = std::max(0LL, static_cast<long long>(grid_dim_x) * grid_dim_y * grid_dim_z);
+        first_block = std::min(std::max(first_block, 0LL), total_blocks);
+        auto pending = std::make_unique<PendingKernel>();
+        pending->first_block = first_block;
+        pending->num_blocks = std::min(std::max(num_blocks, 0LL), total_blocks - first_block);
+        pending->kernel = std::move(kernel);
+        pending->name = kernel_name;
+        pending->grid_dim[0] = grid_dim_x;
+        pending->grid_dim[1] = grid_dim_y;
+        pending->grid_dim[2] = grid_dim_z;
+        pending->block_dim[0] = block_dim_x;
+        pending->block_dim[1] = block_dim_y;
+        pending->block_dim[2] = block_dim_z;
+        pending->stream_id = stream.getID();
+        std::future<KernelLaunchResult> result = pending->result.get_future();
+        StreamOp op{};
+        op.kernel = std::move(pending);
+        enqueue(stream, std::move(op));
+        return result;
+    }
 
-        std::cout << "  Total Threads to launch: " << total_threads << std::endl;
-        std::cout << "  Total Warps to launch: " << total_warps << std::endl;
+    // Queues a copy of host_data into global memory at address. The data is
+    // captured now; the copy happens in stream order.
+    std::future<void> copyToDeviceAsync(const Stream& stream, int address, std::vector<int> host_data) {
+        auto done = std::make_shared<std::promise<void>>();
+        std::future<void> result = done->get_future();
+        auto data = std::make_shared<std::vector<int>>(std::move(host_data));
+        StreamOp op{};
+        op.action = [this, address, data, done](long long) {
+            int count = static_cast<int>(data->size());
+            if (!global_memory.isValidRange(address, count)) {
+                GPU_SIM_LOG(Error, "Error: Copy of " << count << " words to device address " << address
+                            << " is out of bounds. Memory size: " << global_memory.getSize());
+            } else {
+                global_memory.copyIn(address, data->data(), data->size());
+                profiler.logMemoryTransfer(TransferKind::HostToDevice, address, data->size() * sizeof(int));
+            }
+            done->set_value();
+        };
+        enqueue(stream, std::move(op));
+        return result;
+    }
 
-        if (total_warps == 0) {
-            std::cout << "No warps to launch. Kernel launch aborted." << std::endl;
-            return;
+    // Queues a copy of count words of global memory at address back to the
+    // host; the future holds them (empty if the range is out of bounds).
+    std::future<std::vector<int>> copyToHostAsync(const Stream& stream, int address, int count) {
+        auto done = std::make_shared<std::promise<std::vector<int>>>();
+        std::future<std::vector<int>> result = done->get_future();
+        StreamOp op{};
+        op.action = [this, address, count, done](long long) {
+            std::vector<int> data;
+            if (!global_memory.isValidRange(address, count)) {
+                GPU_SIM_LOG(Error, "Error: Copy of " << count << " words from device address " << address
+                            << " is out of bounds. Memory size: " << global_memory.getSize());
+            } else {
+                data.resize(count);
+                global_memory.copyOut(address, data.data(), data.size());
+                profiler.logMemoryTransfer(TransferKind::DeviceToHost, address, data.size() * sizeof(int));
+            }
+            done->set_value(std::move(data));
+        };
+        enqueue(stream, std::move(op));
+        return result;
+    }
+
+    // Queues a record of event on stream: it completes, with the stream's
+    // device cycle, once the work queued on stream before it has finished.
+    void recordEvent(const Stream& stream, const Event& event) {
+        std::shared_ptr<Event::State> state = event.state;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->records_enqueued++;
         }
+        StreamOp op{};
+        op.action = [state](long long cycle) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->records_completed++;
+            state->cycle = cycle;
+            state->completed.notify_all();
+        };
+        enqueue(stream, std::move(op));
+    }
 
-        profiler.startProfiling();
-        auto kernel_start_time = std::chrono::high_resolution_clock::now();
+    // Makes work queued on stream after this call wait until the latest
+    // record of event queued so far has completed. Waiting for an event that
+    // was never recorded does nothing.
+    void waitEvent(const Stream& stream, const Event& event) {
+        StreamOp op{};
+        {
+            std::lock_guard<std::mutex> lock(event.state->mutex);
+            op.wait_record = event.state->records_enqueued;
+        }
+        op.wait_event = event.state;
+        enqueue(stream, std::move(op));
+    }
+
+    // Makes all work queued after this call, on any stream, start no earlier
+    // than device cycle `cycle`: the device waits on something that finishes
+    // then outside it, such as a peer-to-peer copy. Returns immediately.
+    void waitUntilCycle(long long cycle) {
+        StreamOp op{};
+        op.until_cycle = cycle;
+        enqueue(Stream(), std::move(op));
+    }
+
+    // Blocks until all work queued on every stream has finished, or the
+    // device has stopped at the stop cycle. Configure the simulator, or read
+    // its memory and profiler, only after this (or after waiting for the
+    // work in question).
+    void synchronize() {
+        std::unique_lock<std::mutex> lock(stream_mutex);
+        work_drained.wait(lock, [this] { return pending_ops == 0 || (stopped_batch && !resume_requested); });
+    }
+
+    // Makes the device stop the kernels running at device cycle `cycle` part
+    // way, with their warps resident and their pending blocks not yet
+    // dispatched, and run nothing further until resume(); kernels that start
+    // later stop as soon as their first blocks are dispatched. synchronize()
+    // returns once the device has stopped, and saveCheckpoint() then saves
+    // the stopped kernels whole. The stop is disarmed once reached; a
+    // negative cycle disarms it. While it is armed, launches run on deferred
+    // ports as with host worker threads, so memory images are unchanged; with
+    // an L2, the cycles of a launch that stopped can differ slightly, since
+    // its SMs probe the L2 in a different order.
+    void setStopCycle(long long cycle) {
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        stop_cycle = cycle < 0 ? -1 : cycle;
+    }
 
-        std::vector<Warp> all_launched_warps;
-        all_launched_warps.reserve(total_warps);
+    // Whether the device has stopped at the stop cycle and waits for resume().
+    bool isStopped() {
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        return stopped_batch && !resume_requested;
+    }
 
-        for (long long i = 0; i < total_warps; ++i) {
-            all_launched_warps.emplace_back(i, threads_per_warp, 8);
+    // Continues the kernels the device stopped, in this simulator or in the
+    // checkpoint it restored, up to the stop cycle if one has been set since,
+    // and then the work queued behind them. Returns immediately, or false if
+    // nothing is stopped. Settings changed while stopped apply from here on.
+    bool resume() {
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        if (!stopped_batch || resume_requested) {
+            return false;
+        }
+        resume_requested = true;
+        if (!device_thread.joinable()) {
+            device_thread = std::thread(&GPUSimulator::deviceLoop, this);
         }
+        work_available.notify_one();
+        return true;
+    }
 
-        for (ShaderCore& sm : sms) {
-            sm = ShaderCore(sm.getID());
+    // Blocks until all work queued on stream so far has finished.
+    void synchronizeStream(const Stream& stream) {
+        Event done;
+        recordEvent(stream, done);
+        done.synchronize();
+    }
+
+    // Writes the simulator's state to path: global memory, the device
+    // allocator, the device timeline and streams, the L2 and every SM (issue
+    // policy, timing models and L1, sampling settings) and the profiler's
+    // counters and kernel traces. Queued work is finished first, unless the
+    // device stops at the stop cycle (see setStopCycle()): the kernels it
+    // stopped are then saved mid-launch, with every SM's resident warps
+    // (registers, pcs, SIMT stacks), blocks and shared memory, pending
+    // blocks, scheduler queues and in-flight timing, and what the launch
+    // has staged for global memory. Work queued behind them is not saved.
+    // No other host thread may queue or resume work meanwhile. Host settings
+    // (worker threads, state dumps, memory tracing, the stop cycle) are not
+    // saved. The file is written under a temporary name and renamed into
+    // place.
+    bool saveCheckpoint(const std::string& path) {
+        synchronize();
+        CheckpointWriter writer;
+        writer.write<int32_t>(num_sms);
+        writer.write<int32_t>(threads_per_warp);
+        writer.write<int32_t>(warps_per_sm);
+        writer.write<int32_t>(kRegistersPerThread);
+        writer.write<uint64_t>(global_memory.getSize());
+        KernelBatch* batch = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(stream_mutex);
+            batch = resume_requested ? nullptr : stopped_batch.get();
+            writer.write<int64_t>(device_cycle);
+            writer.write<int32_t>(next_stream_id);
+            writer.write<uint64_t>(streams.size());
+            for (const auto& entry : streams) {
+                writer.write<int32_t>(entry.first);
+                writer.write<int64_t>(entry.second.completed_cycle);
+            }
+        }
+        // The stopped kernels come before the SMs, whose launches refer to them.
+        writer.write<uint64_t>(batch ? batch->kernels.size() : 0);
+        if (batch) {
+            for (const std::unique_ptr<PendingKernel>& pending : batch->kernels) {
+                if (!savePendingKernel(writer, *batch, *pending)) {
+                    GPU_SIM_LOG(Error, "Error: Stopped kernel " << pending->name << " cannot be checkpointed.");
+                    return false;
+                }
+            }
+        }
+        writer.write<uint8_t>(l2_cache ? 1 : 0);
+        if (l2_cache) {
+            l2_cache->saveState(writer);
+        }
+        for (const ShaderCore& sm : sms) {
+            if (!sm.saveState(writer)) {
+                return false;
+            }
+        }
+        if (batch) {
+            writer.write<uint64_t>(batch->ports.size());
+            for (MemoryPort& port : batch->ports) {
+                port.saveState(writer);
+            }
+            writer.writeVector(batch->sm_success);
+            writer.write<uint8_t>(batch->l2_before ? 1 : 0);
+            if (batch->l2_before) {
+                batch->l2_before->saveState(writer);
+            }
+            writer.write(batch->duration_ms);
+        }
+        allocator.saveState(writer);
+        profiler.saveState(writer);
+        std::vector<uint64_t> pages = global_memory.getPopulatedPages();
+        writer.writeVector(pages);
+
+        const std::vector<char>& state = writer.getData();
+        CheckpointHeader header{};
+        std::memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+        header.version = kCheckpointVersion;
+        header.page_bytes = static_cast<uint32_t>(global_memory.getPageBytes());
+        header.state_bytes = state.size();
+        header.state_hash = fnv1aHash(state.data(), state.size());
+        header.page_count = pages.size();
+        header.page_data_offset = (sizeof(header) + state.size() + kCheckpointPageAlignment - 1)
+                                  / kCheckpointPageAlignment * kCheckpointPageAlignment;
+
+        std::string temp_path = path + ".tmp." + std::to_string(::getpid());
+        std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+        if (!file) {
+            GPU_SIM_LOG(Error, "Error: Could not open checkpoint " << temp_path << " for writing.");
+            return false;
+        }
+        std::vector<char> padding(header.page_data_offset - sizeof(header) - state.size(), 0);
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+            && std::fwrite(state.data(), 1, state.size(), file) == state.size()
+            && std::fwrite(padding.data(), 1, padding.size(), file) == padding.size();
+        for (size_t i = 0; i < pages.size() && ok; ++i) {
+            ok = std::fwrite(global_memory.getPageData(pages[i]), 1, header.page_bytes, file) == header.page_bytes;
+        }
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            GPU_SIM_LOG(Error, "Error: Failed to write checkpoint " << path << ".");
+            std::remove(temp_path.c_str());
+            return false;
         }
+        GPU_SIM_LOG(Info, "Checkpoint written to " << path << " (" << pages.size() << " memory pages, device cycle "
+                    << getDeviceCycle() << (batch ? ", " + std::to_string(batch->kernels.size()) + " kernel(s) stopped"
+                                                  : std::string()) << ").");
+        return true;
+    }
 
-        if (!sms.empty()) {
-            for (Warp& warp : all_launched_warps) {
-                int sm_idx = warp.getID() % num_sms;
-                sms[sm_idx].addWarp(std::move(warp));
+    // Replaces the simulator's state with a checkpoint written by a simulator
+    // of the same configuration (SMs, warp width, resident warps, memory and
+    // page size). Memory pages are mapped from the file copy-on-write rather
+    // than read, so restoring is cheap however large memory is, and the file
+    // is never modified. Queued work is finished first. Returns false if the
+    // file is not a valid checkpoint for this simulator; nothing is changed
+    // then unless the state section itself is malformed.
+    //
+    // Kernels the checkpoint was stopped in are restored stopped, replacing
+    // any this simulator had stopped, and run on after resume().
+    // stopped_launches, if given, receives their futures in launch order.
+    // Restoring fails while work is queued behind stopped kernels.
+    bool restoreCheckpoint(const std::string& path,
+                           std::vector<std::future<KernelLaunchResult>>* stopped_launches = nullptr) {
+        synchronize();
+        {
+            std::lock_guard<std::mutex> lock(stream_mutex);
+            if (pending_ops != (stopped_batch && !resume_requested ? stopped_batch->kernels.size() : 0)) {
+                GPU_SIM_LOG(Error, "Error: Cannot restore checkpoint " << path << " while work is queued behind stopped kernels.");
+                return false;
             }
-        } else {
-            std::cerr << "Error: No ShaderCores available in GPUSimulator to launch warps." << std::endl;
-            profiler.stopProfiling();
-            return;
+        }
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            GPU_SIM_LOG(Error, "Error: Could not open checkpoint " << path << ".");
+            return false;
+        }
+        CheckpointHeader header{};
+        std::vector<char> state;
+        bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+            && std::memcmp(header.magic, kCheckpointMagic, sizeof(kCheckpointMagic)) == 0
+            && header.version == kCheckpointVersion
+            && header.page_data_offset >= sizeof(header) + header.state_bytes
+            && header.page_data_offset % kCheckpointPageAlignment == 0;
+        if (ok) {
+            state.resize(static_cast<size_t>(header.state_bytes));
+            ok = std::fread(state.data(), 1, state.size(), file) == state.size()
+                && fnv1aHash(state.data(), state.size()) == header.state_hash;
+        }
+        long long file_size = -1;
+        if (ok && std::fseek(file, 0, SEEK_END) == 0) {
+            file_size = std::ftell(file);
+        }
+        std::fclose(file);
+        if (!ok || file_size < 0 || static_cast<uint64_t>(file_size)
+                < header.page_data_offset + header.page_count * header.page_bytes) {
+            GPU_SIM_LOG(Error, "Error: " << path << " is not a valid version " << kCheckpointVersion << " checkpoint.");
+            return false;
         }
 
-        bool all_sms_completed = true;
+        CheckpointReader reader(state.data(), state.size());
+        int32_t saved_sms = 0, saved_threads_per_warp = 0, saved_warps_per_sm = 0, saved_registers = 0;
+        uint64_t saved_memory_size = 0;
+        reader.read(saved_sms);
+        reader.read(saved_threads_per_warp);
+        reader.read(saved_warps_per_sm);
+        reader.read(saved_registers);
+        reader.read(saved_memory_size);
+        if (!reader.ok() || saved_sms != num_sms || saved_threads_per_warp != threads_per_warp
+            || saved_warps_per_sm != warps_per_sm || saved_registers != kRegistersPerThread
+            || saved_memory_size != global_memory.getSize() || header.page_bytes != global_memory.getPageBytes()) {
+            GPU_SIM_LOG(Error, "Error: Checkpoint " << path << " was written by a simulator with a different configuration.");
+            return false;
+        }
+
+        int64_t saved_device_cycle = 0;
+        int32_t saved_next_stream_id = 1;
+        uint64_t num_streams = 0;
+        std::map<int, long long> saved_streams;
+        reader.read(saved_device_cycle);
+        reader.read(saved_next_stream_id);
+        reader.read(num_streams);
+        for (uint64_t i = 0; i < num_streams && reader.ok(); ++i) {
+            int32_t stream_id = 0;
+            int64_t completed_cycle = 0;
+            reader.read(stream_id);
+            reader.read(completed_cycle);
+            saved_streams[stream_id] = completed_cycle;
+        }
+        uint64_t num_stopped = 0;
+        reader.read(num_stopped);
+        std::unique_ptr<KernelBatch> batch = num_stopped > 0 ? std::make_unique<KernelBatch>() : nullptr;
+        for (uint64_t i = 0; i < num_stopped && reader.ok(); ++i) {
+            restorePendingKernel(reader, *batch);
+        }
+        std::vector<const DecodedKernel*> launched_kernels;
+        if (batch) {
+            for (const PendingKernel* pending : batch->launched) {
+                launched_kernels.push_back(pending->kernel.get());
+            }
+        }
+        uint8_t has_l2 = 0;
+        reader.read(has_l2);
+        l2_cache = has_l2 ? std::make_unique<SharedCache>(CacheConfig()) : nullptr;
+        if (l2_cache) {
+            l2_cache->restoreState(reader);
+        }
         for (ShaderCore& sm : sms) {
-            std::cout << "\nExecuting warps on ShaderCore " << sm.getID() << "..." << std::endl;
-            bool sm_success = sm.executeWarps(kernel_program, global_memory);
-            if (!sm_success) {
-                all_sms_completed = false;
+            sm.setCaches(CacheConfig(), l2_cache.get());
+            if (reader.ok()) {
+                sm.restoreState(reader, launched_kernels);
             }
         }
+        if (batch && reader.ok()) {
+            uint64_t num_ports = 0;
+            reader.read(num_ports);
+            for (uint64_t i = 0; i < num_ports && reader.ok(); ++i) {
+                batch->ports.emplace_back(global_memory, true);
+                batch->ports.back().setCycleOffset(static_cast<uint64_t>(saved_device_cycle));
+                batch->ports.back().restoreState(reader);
+            }
+            uint8_t has_l2_before = 0;
+            reader.readVector(batch->sm_success);
+            reader.read(has_l2_before);
+            if (has_l2_before && reader.ok()) {
+                batch->l2_before = std::make_unique<Cache>();
+                batch->l2_before->restoreState(reader);
+            }
+            reader.read(batch->duration_ms);
+            if (num_ports != sms.size() || batch->sm_success.size() != sms.size()) {
+                reader.fail();
+            }
+        }
+        allocator.restoreState(reader);
+        profiler.restoreState(reader);
+        std::vector<uint64_t> pages;
+        reader.readVector(pages);
+        if (!reader.ok() || !reader.atEnd() || pages.size() != header.page_count
+            || !global_memory.restorePages(path, header.page_data_offset, pages)) {
+            GPU_SIM_LOG(Error, "Error: Checkpoint " << path << " is malformed; the simulator state is incomplete.");
+            return false;
+        }
 
-        auto kernel_end_time = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double, std::milli> kernel_duration = kernel_end_time - kernel_start_time;
-        profiler.logKernelExecution("SimpleAddKernel",
-                                    "(" + std::to_string(grid_dim_x) + "," + std::to_string(grid_dim_y) + "," + std::to_string(grid_dim_z) + ")",
-                                    "(" + std::to_string(block_dim_x) + "," + std::to_string(block_dim_y) + "," + std::to_string(block_dim_z) + ")",
-                                    kernel_duration.count());
-        profiler.stopProfiling();
-
-        if (all_sms_completed) {
-            std::cout << "\n--- Kernel Launch Completed Successfully ---" << std::endl;
-        } else {
-            std::cout << "\n--- Kernel Launch Completed with Issues ---" << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(stream_mutex);
+            abandonStoppedBatch();
+            streams.clear();
+            streams[0];
+            for (const auto& entry : saved_streams) {
+                streams[entry.first].completed_cycle = entry.second;
+            }
+            next_stream_id = saved_next_stream_id;
+            device_cycle = saved_device_cycle;
+            pending_ops = 0;
+            if (batch) {
+                for (std::unique_ptr<PendingKernel>& pending : batch->kernels) {
+                    streams[pending->stream_id].running_sequence = next_sequence++;
+                    pending_ops++;
+                    if (stopped_launches) {
+                        stopped_launches->push_back(pending->result.get_future());
+                    }
+                }
+            }
+            stopped_batch = std::move(batch);
+            resume_requested = false;
         }
+        GPU_SIM_LOG(Info, "Checkpoint " << path << " restored (" << pages.size() << " memory pages, device cycle "
+                    << saved_device_cycle << ", " << num_stopped << " kernel(s) stopped).");
+        return true;
+    }
+
+    // Device cycles simulated so far on the timeline shared by all streams.
+    long long getDeviceCycle() {
+        std::lock_guard<std::mutex> lock(stream_mutex);
+        return device_cycle;
+    }
+
+    Profiler& getProfiler() {
+        return profiler;
     }
 
     const Profiler& getProfiler() const {
@@ -0,0 +1,158 @@
+// src/sim/KernelCache.h
+#pragma once
+
+#include "../arch/Assembler.h"
+#include "../arch/DecodedKernel.h"
+#include "../arch/KernelBinary.h"
+#include "Log.h"
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstdio>
+
+// Cache of decoded, validated kernels keyed by a content hash, so a job that
+// launches the same generated kernels over and over assembles and validates
+// each one only once. Entries are kept in memory and, when a directory is
+// given, also as kernel binaries (<hash>.gkb) that later processes mmap
+// instead of parsing.
+//
+// Kernels are keyed either by their assembly text or by their encoded
+// instructions, together with the register count they were decoded for.
+// Program lookups compare the cached instructions against the program; text
+// lookups trust the 64-bit hash.
+class KernelCache {
+public:
+    struct Stats {
+        uint64_t memory_hits = 0;
+        uint64_t disk_hits = 0;
+        uint64_t misses = 0;
+    };
+
+private:
+    std::string directory;
+    std::unordered_map<uint64_t, std::shared_ptr<const DecodedKernel>> entries;
+    mutable std::mutex mutex;
+    Stats stats;
+
+    static uint64_t makeKey(uint64_t content_hash, char kind, int num_registers) {
+        uint64_t key = fnv1aHash(&kind, sizeof(kind), content_hash);
+        return fnv1aHash(&num_registers, sizeof(num_registers), key);
+    }
+
+    std::string pathFor(uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.gkb", static_cast<unsigned long long>(key));
+        return directory + "/" + name;
+    }
+
+    // Loads a cached binary; expected (if not null) must match its instructions.
+    std::shared_ptr<const DecodedKernel> loadFromDisk(uint64_t key, int num_registers,
+                                                      const std::vector<EncodedInstruction>* expected) const {
+        if (directory.empty()) {
+            return nullptr;
+        }
+        MappedKernelBinary binary(pathFor(key));
+        if (!binary.isValid() || !binary.hasDecoded() || binary.getHeader().num_registers != num_registers) {
+            return nullptr;
+        }
+        if (expected && (expected->size() != binary.size()
+                         || std::memcmp(expected->data(), binary.getInstructions(),
+                                        expected->size() * sizeof(EncodedInstruction)) != 0)) {
+            return nullptr;
+        }
+        auto kernel = std::make_shared<DecodedKernel>();
+        if (!DecodedKernel::fromDecoded(binary.toProgram(), binary.getDecoded(), num_registers,
+                                        binary.getHeader().num_rewritten, *kernel)) {
+            GPU_SIM_LOG(Warning, "Warning: Ignoring cached kernel " << pathFor(key) << " with invalid operands.");
+            return nullptr;
+        }
+        return kernel;
+    }
+
+    std::shared_ptr<const DecodedKernel> insert(uint64_t key, const KernelProgram& program, int num_registers) {
+        auto kernel = std::make_shared<const DecodedKernel>(program, num_registers);
+        if (!directory.empty()) {
+            writeKernelBinary(pathFor(key), program, kernel.get());
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.misses++;
+        return entries.emplace(key, kernel).first->second;
+    }
+
+    std::shared_ptr<const DecodedKernel> lookup(uint64_t key, int num_registers,
+                                                const std::vector<EncodedInstruction>* expected) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                stats.memory_hits++;
+                return it->second;
+            }
+        }
+        std::shared_ptr<const DecodedKernel> kernel = loadFromDisk(key, num_registers, expected);
+        if (!kernel) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.disk_hits++;
+        return entries.emplace(key, kernel).first->second;
+    }
+
+public:
+    // An empty directory keeps the cache in memory only. The directory must
+    // already exist.
+    explicit KernelCache(const std::string& cache_directory = "") : directory(cache_directory) {
+        while (directory.size() > 1 && directory.back() == '/') {
+            directory.pop_back();
+        }
+    }
+
+    KernelCache(const KernelCache&) = delete;
+    KernelCache& operator=(const KernelCache&) = delete;
+
+    const std::string& getDirectory() const {
+        return directory;
+    }
+
+    // Returns program decoded for num_registers registers per thread, or
+    // nullptr if it cannot be encoded.
+    std::shared_ptr<const DecodedKernel> get(const KernelProgram& program, int num_registers) {
+        std::vector<EncodedInstruction> encoded;
+        if (!encodeKernel(program, encoded)) {
+            return nullptr;
+        }
+        uint64_t key = makeKey(kernelContentHash(encoded), 'P', num_registers);
+        std::shared_ptr<const DecodedKernel> kernel = lookup(key, num_registers, &encoded);
+        return kernel ? kernel : insert(key, program, num_registers);
+    }
+
+    // Returns the kernel assembled from source, or nullptr if it does not
+    // assemble. A hit skips both assembly and validation.
+    std::shared_ptr<const DecodedKernel> getFromText(const std::string& source, int num_registers,
+                                                     std::string* error = nullptr) {
+        uint64_t key = makeKey(fnv1aHash(source.data(), source.size()), 'T', num_registers);
+        std::shared_ptr<const DecodedKernel> kernel = lookup(key, num_registers, nullptr);
+        if (kernel) {
+            return kernel;
+        }
+        KernelProgram program;
+        if (!KernelAssembler::assemble(source, program, error)) {
+            return nullptr;
+        }
+        return insert(key, program, num_registers);
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    // Drops the in-memory entries; files on disk are kept.
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+};
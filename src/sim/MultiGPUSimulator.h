@@ -0,0 +1,272 @@
+// src/sim/MultiGPUSimulator.h
+#pragma once
+
+#include "GPUSimulator.h"
+#include "Profiler.h"
+#include "Log.h"
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+
+// Interconnect between the devices of a MultiGPUSimulator. A peer copy of
+// B bytes occupies its link for ceil(B / bytes_per_cycle) cycles (0 means
+// unlimited bandwidth) and lands latency_cycles after that. With shared_link
+// all copies queue on one link, like GPUs behind a PCIe switch; otherwise
+// every ordered pair of devices has its own, like an NVLink mesh.
+struct InterconnectConfig {
+    int bytes_per_cycle = 64;
+    int latency_cycles = 1000;
+    bool shared_link = false;
+};
+
+// Device cycles one peer-to-peer copy spanned.
+struct PeerCopyResult {
+    bool completed = false;
+    long long start_cycle = 0;
+    long long end_cycle = 0;
+};
+
+// Outcome of a launch split across devices: every device's result, and the
+// span from the first device starting to the last one finishing.
+struct MultiDeviceLaunchResult {
+    bool completed = false;
+    long long start_cycle = 0;
+    long long end_cycle = 0;
+    std::vector<KernelLaunchResult> devices;
+
+    long long cycles() const {
+        return end_cycle - start_cycle;
+    }
+};
+
+// Contiguous range of a grid's blocks assigned to one device.
+struct BlockRange {
+    long long first_block = 0;
+    long long num_blocks = 0;
+};
+
+// A group of simulated GPUs. Each device is a full GPUSimulator with its own
+// global memory, SMs, profiler and device thread, so the devices simulate
+// concurrently on the host (and each can spread its SMs over host workers
+// too). Device cycles count from 0 on every device and are compared directly
+// when timing peer copies.
+class MultiGPUSimulator {
+private:
+    // Words moved per step of a peer copy between different devices.
+    static constexpr int kPeerCopyChunkWords = 1 << 16;
+
+    std::vector<std::unique_ptr<GPUSimulator>> devices;
+    InterconnectConfig interconnect;
+    std::mutex link_mutex;
+    std::map<std::pair<int, int>, long long> link_free_cycle;  // Keyed by (source, destination); (-1, -1) is the shared link.
+    uint64_t peer_copies;
+    uint64_t peer_bytes;
+
+    bool validDevice(int device) const {
+        return device >= 0 && device < static_cast<int>(devices.size());
+    }
+
+public:
+    MultiGPUSimulator(int num_devices, size_t global_memory_size, int num_sms, int threads_per_warp, int warps_per_sm,
+                      size_t memory_page_bytes = GPUMemory::kSmallPageBytes)
+        : peer_copies(0), peer_bytes(0) {
+        if (num_devices <= 0) {
+            GPU_SIM_LOG(Error, "MultiGPUSimulator: num_devices must be positive, using 1.");
+            num_devices = 1;
+        }
+        for (int d = 0; d < num_devices; ++d) {
+            devices.push_back(std::make_unique<GPUSimulator>(global_memory_size, num_sms, threads_per_warp,
+                                                             warps_per_sm, memory_page_bytes));
+        }
+        GPU_SIM_LOG(Info, "MultiGPUSimulator initialized with " << num_devices << " devices.");
+    }
+
+    int getNumDevices() const {
+        return static_cast<int>(devices.size());
+    }
+
+    GPUSimulator& getDevice(int device) {
+        return *devices.at(device);
+    }
+
+    // Host worker threads each device simulates its SMs on; see
+    // GPUSimulator::setHostWorkerThreads().
+    void setHostWorkerThreads(int workers_per_device) {
+        for (auto& device : devices) {
+            device->setHostWorkerThreads(workers_per_device);
+        }
+    }
+
+    // Configure the interconnect only while no peer copy is in flight.
+    void setInterconnect(const InterconnectConfig& config) {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        interconnect = config;
+        interconnect.bytes_per_cycle = std::max(interconnect.bytes_per_cycle, 0);
+        interconnect.latency_cycles = std::max(interconnect.latency_cycles, 0);
+    }
+
+    const InterconnectConfig& getInterconnect() const {
+        return interconnect;
+    }
+
+    // Blocks a split launch of total_blocks gives to device: contiguous
+    // ranges in device order, whose sizes differ by at most one.
+    BlockRange partitionBlocks(long long total_blocks, int device) const {
+        BlockRange range;
+        if (!validDevice(device) || total_blocks <= 0) {
+            return range;
+        }
+        long long n = static_cast<long long>(devices.size());
+        range.first_block = total_blocks * device / n;
+        range.num_blocks = total_blocks * (device + 1) / n - range.first_block;
+        return range;
+    }
+
+    // Launches one grid across all devices, each running its
+    // partitionBlocks() share on its default stream, and returns a result
+    // per device. Threads keep their IDs in the whole grid, so a kernel that
+    // indexes memory by thread ID touches the same addresses on whichever
+    // device runs it; the inputs it reads must be on that device.
+    std::vector<std::future<KernelLaunchResult>> launchKernelSplitAsync(const KernelProgram& kernel_program,
+                                                                         int grid_dim_x, int grid_dim_y, int grid_dim_z,
+                                                                         int block_dim_x, int block_dim_y, int block_dim_z,
+                                                                         const std::string& kernel_name = "kernel") {
+        auto kernel = std::make_shared<const DecodedKernel>(kernel_program, GPUSimulator::getRegistersPerThread());
+        long long total_blocks = static_cast<long long>(grid_dim_x) * grid_dim_y * grid_dim_z;
+        std::vector<std::future<KernelLaunchResult>> results;
+        for (int d = 0; d < getNumDevices(); ++d) {
+            BlockRange range = partitionBlocks(total_blocks, d);
+            if (range.num_blocks == 0) {
+                // More devices than blocks: this one has nothing to run.
+                std::promise<KernelLaunchResult> idle;
+                KernelLaunchResult result;
+                result.completed = true;
+                result.start_cycle = result.end_cycle = devices[d]->getDeviceCycle();
+                idle.set_value(result);
+                results.push_back(idle.get_future());
+                continue;
+            }
+            results.push_back(devices[d]->launchKernelBlocksAsync(Stream(), kernel, grid_dim_x, grid_dim_y, grid_dim_z,
+                                                                  block_dim_x, block_dim_y, block_dim_z,
+                                                                  range.first_block, range.num_blocks, kernel_name));
+        }
+        return results;
+    }
+
+    // Like launchKernelSplitAsync(), but waits for every device to finish.
+    MultiDeviceLaunchResult launchKernelSplit(const KernelProgram& kernel_program,
+                                              int grid_dim_x, int grid_dim_y, int grid_dim_z,
+                                              int block_dim_x, int block_dim_y, int block_dim_z,
+                                              const std::string& kernel_name = "kernel") {
+        auto futures = launchKernelSplitAsync(kernel_program, grid_dim_x, grid_dim_y, grid_dim_z,
+                                              block_dim_x, block_dim_y, block_dim_z, kernel_name);
+        MultiDeviceLaunchResult result;
+        result.completed = true;
+        for (size_t d = 0; d < futures.size(); ++d) {
+            KernelLaunchResult device_result = futures[d].get();
+            result.completed = result.completed && device_result.completed;
+            result.start_cycle = d == 0 ? device_result.start_cycle : std::min(result.start_cycle, device_result.start_cycle);
+            result.end_cycle = std::max(result.end_cycle, device_result.end_cycle);
+            result.devices.push_back(device_result);
+        }
+        GPU_SIM_LOG(Info, "Split kernel '" << kernel_name << "' across " << futures.size() << " devices: cycles "
+                    << result.start_cycle << " to " << result.end_cycle << ".");
+        return result;
+    }
+
+    // Copies count words from src_address on src_device to dst_address on
+    // dst_device and waits for it. The copy starts once both devices have
+    // finished their queued work and its link is free, and work queued on
+    // either device afterwards starts only once it has landed. A copy within
+    // one device takes no interconnect time. Like the other synchronous
+    // copies, the two devices must not get new work from other host threads
+    // while it runs.
+    PeerCopyResult copyPeer(int dst_device, int dst_address, int src_device, int src_address, int count) {
+        PeerCopyResult result;
+        if (!validDevice(dst_device) || !validDevice(src_device)) {
+            GPU_SIM_LOG(Error, "copyPeer: invalid device " << src_device << " -> " << dst_device << ".");
+            return result;
+        }
+        GPUSimulator& source = *devices[src_device];
+        GPUSimulator& destination = *devices[dst_device];
+        if (count < 0 || !source.getGlobalMemory().isValidRange(src_address, count)
+            || !destination.getGlobalMemory().isValidRange(dst_address, count)) {
+            GPU_SIM_LOG(Error, "copyPeer: invalid range of " << count << " words from " << src_address
+                        << " on device " << src_device << " to " << dst_address << " on device " << dst_device << ".");
+            return result;
+        }
+        source.synchronize();
+        destination.synchronize();
+
+        size_t bytes = static_cast<size_t>(count) * sizeof(int);
+        {
+            std::lock_guard<std::mutex> lock(link_mutex);
+            result.start_cycle = std::max(source.getDeviceCycle(), destination.getDeviceCycle());
+            result.end_cycle = result.start_cycle;
+            if (src_device != dst_device) {
+                long long& link_free = link_free_cycle[interconnect.shared_link ? std::make_pair(-1, -1)
+                                                                                 : std::make_pair(src_device, dst_device)];
+                result.start_cycle = std::max(result.start_cycle, link_free);
+                long long transfer_cycles = interconnect.bytes_per_cycle > 0
+                    ? static_cast<long long>((bytes + interconnect.bytes_per_cycle - 1) / interconnect.bytes_per_cycle)
+                    : 0;
+                link_free = result.start_cycle + transfer_cycles;
+                result.end_cycle = link_free + interconnect.latency_cycles;
+                peer_copies++;
+                peer_bytes += bytes;
+            }
+        }
+
+        // Within one device the ranges may overlap, so stage the whole copy.
+        int chunk_words = src_device == dst_device ? count : std::min(count, kPeerCopyChunkWords);
+        std::vector<int> staging(static_cast<size_t>(chunk_words));
+        for (int offset = 0; offset < count; offset += chunk_words) {
+            int words = std::min(chunk_words, count - offset);
+            source.getGlobalMemory().copyOut(src_address + offset, staging.data(), words);
+            destination.getGlobalMemory().copyIn(dst_address + offset, staging.data(), words);
+        }
+        source.getProfiler().logMemoryTransfer(TransferKind::DeviceToPeer, src_address, bytes);
+        destination.getProfiler().logMemoryTransfer(TransferKind::PeerToDevice, dst_address, bytes);
+
+        source.waitUntilCycle(result.end_cycle);
+        destination.waitUntilCycle(result.end_cycle);
+        GPU_SIM_LOG(Info, "Peer copy of " << bytes << " bytes from device " << src_device << " to device "
+                    << dst_device << ": cycles " << result.start_cycle << " to " << result.end_cycle << ".");
+        result.completed = true;
+        return result;
+    }
+
+    // Blocks until every device has finished its queued work.
+    void synchronize() {
+        for (auto& device : devices) {
+            device->synchronize();
+        }
+    }
+
+    // Latest device cycle any device has reached.
+    long long getDeviceCycle() {
+        long long cycle = 0;
+        for (auto& device : devices) {
+            cycle = std::max(cycle, device->getDeviceCycle());
+        }
+        return cycle;
+    }
+
+    // Peer copies between different devices so far, and the bytes they moved.
+    uint64_t getPeerCopyCount() {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        return peer_copies;
+    }
+
+    uint64_t getPeerCopyBytes() {
+        std::lock_guard<std::mutex> lock(link_mutex);
+        return peer_bytes;
+    }
+};
@@ -5,65 +5,482 @@
 #include <string>
 #include <chrono>
 #include <iostream>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include <iomanip>
+#include "Log.h"
+#include "TraceFile.h"
+#include "TimelineTrace.h"
+#include "Checkpoint.h"
+#include "../memory/MemoryTimingModel.h"
+#include "../arch/PerfCounters.h"
+#include "../arch/SampledSimulation.h"
 
 struct KernelTrace {
     std::string kernel_name;
     std::string grid_dim_str;
     std::string block_dim_str;
     double duration_ms;
+    long long simulated_cycles;
+    long long warp_instructions;
+    std::vector<InstructionMemoryStats> memory_instructions;
+    CacheStats cache_stats[kNumCacheLevels];
+    long long active_lane_slots;    // Lanes active summed over issued instructions.
+    long long lane_slots;           // Warp widths summed over issued instructions.
+    int stream_id;
+    long long start_cycle;          // Device timeline, shared by all streams.
+    long long end_cycle;
+    int concurrent_kernels;         // Kernels that shared the SMs, this one included.
+    KernelCounters counters;        // Simulated hardware counters by SM, warp and PC.
+    SampledCycles sampling;         // Blocks run in detail and the cycles' error bound, if sampled.
+
+    // Fraction of SIMD lanes doing useful work; below 1 under divergence or
+    // partially filled warps.
+    double laneUtilization() const {
+        return lane_slots > 0 ? static_cast<double>(active_lane_slots) / lane_slots : 0.0;
+    }
+};
+
+enum class MemoryOpType : uint8_t {
+    Read,
+    Write,
+    Allocate,
+    Release
+};
+
+constexpr size_t kNumMemoryOpTypes = 4;
+
+inline const char* memoryOpTypeToString(MemoryOpType op_type) {
+    switch (op_type) {
+        case MemoryOpType::Read:     return "read";
+        case MemoryOpType::Write:    return "write";
+        case MemoryOpType::Allocate: return "allocate";
+        case MemoryOpType::Release:  return "release";
+        default:                     return "unknown";
+    }
+}
+
+// Bulk host API transfers (GPUSimulator::memcpy*/memset, stream copies) and
+// peer-to-peer copies between devices (MultiGPUSimulator::copyPeer), which
+// the sending device logs as DeviceToPeer and the receiving one as
+// PeerToDevice. Each call is one transfer however many words it moves.
+enum class TransferKind : uint8_t {
+    HostToDevice,
+    DeviceToHost,
+    Memset,
+    DeviceToPeer,
+    PeerToDevice
 };
 
+constexpr size_t kNumTransferKinds = 5;
+
+inline const char* transferKindToString(TransferKind kind) {
+    switch (kind) {
+        case TransferKind::HostToDevice: return "host-to-device";
+        case TransferKind::DeviceToHost: return "device-to-host";
+        case TransferKind::Memset:       return "memset";
+        case TransferKind::DeviceToPeer: return "device-to-peer";
+        case TransferKind::PeerToDevice: return "peer-to-device";
+        default:                         return "unknown";
+    }
+}
+
 struct MemoryTrace {
-    std::string op_type;
+    MemoryOpType op_type;
     long long address;
     size_t size_bytes;
     double time_stamp_ms;
 };
 
+// Plain (non-atomic) per-op-type counters. Hot paths such as a per-SM
+// MemoryPort accumulate into one of these privately and hand it to
+// Profiler::mergeMemoryCounters() once, instead of touching shared state on
+// every access.
+struct MemoryCounters {
+    uint64_t operations[kNumMemoryOpTypes] = {};
+    uint64_t bytes[kNumMemoryOpTypes] = {};
+
+    void record(MemoryOpType op_type, size_t size_bytes, uint64_t count = 1) {
+        operations[static_cast<size_t>(op_type)] += count;
+        bytes[static_cast<size_t>(op_type)] += count * size_bytes;
+    }
+};
+
+// Host memory behind the simulated global memory. Only pages that were
+// written (resident) or mapped from a file take host memory; the rest of the
+// simulated address space reads as zeros.
+struct MemoryFootprint {
+    uint64_t virtual_bytes = 0;
+    uint64_t resident_bytes = 0;
+    uint64_t mapped_bytes = 0;
+    uint64_t page_bytes = 0;
+};
+
 class Profiler {
 private:
     std::vector<KernelTrace> kernel_traces;
-    std::vector<MemoryTrace> memory_traces;
     std::chrono::high_resolution_clock::time_point start_time;
     bool profiling_active;
 
+    // Always-on aggregate counters, indexed by MemoryOpType.
+    std::array<std::atomic<uint64_t>, kNumMemoryOpTypes> operation_counts;
+    std::array<std::atomic<uint64_t>, kNumMemoryOpTypes> operation_bytes;
+
+    // Optional sampled trace: every trace_sample_interval-th operation is kept
+    // in a ring buffer of trace_capacity entries, overwriting the oldest.
+    bool tracing_enabled;
+    size_t trace_capacity;
+    uint64_t trace_sample_interval;
+    std::atomic<uint64_t> trace_sample_tick;
+    mutable std::mutex trace_mutex;
+    std::vector<MemoryTrace> trace_ring;
+    size_t trace_ring_next;
+
+    // Cache counters summed over every logged kernel, indexed by CacheLevel.
+    CacheStats cache_totals[kNumCacheLevels];
+
+    MemoryFootprint memory_footprint;
+
+    // Bulk transfers, indexed by TransferKind.
+    std::array<std::atomic<uint64_t>, kNumTransferKinds> transfer_counts;
+    std::array<std::atomic<uint64_t>, kNumTransferKinds> transfer_bytes;
+
+    // Optional streaming export of every global memory access to disk.
+    std::unique_ptr<TraceWriter> trace_writer;
+
+    // Optional streaming export of SM and warp activity as a timeline.
+    std::unique_ptr<TimelineWriter> timeline_writer;
+
+    void recordTrace(MemoryOpType op_type, long long address, size_t size_bytes) {
+        if (trace_sample_tick.fetch_add(1, std::memory_order_relaxed) % trace_sample_interval != 0) {
+            return;
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start_time;
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        MemoryTrace trace{op_type, address, size_bytes, elapsed.count()};
+        if (trace_ring.size() < trace_capacity) {
+            trace_ring.push_back(trace);
+        } else {
+            trace_ring[trace_ring_next] = trace;
+        }
+        trace_ring_next = (trace_ring_next + 1) % trace_capacity;
+    }
+
 public:
-    Profiler() : profiling_active(false) {
-        std::cout << "Profiler initialized." << std::endl;
+    Profiler()
+        : profiling_active(false),
+          tracing_enabled(false),
+          trace_capacity(0),
+          trace_sample_interval(1),
+          trace_sample_tick(0),
+          trace_ring_next(0) {
+        for (size_t i = 0; i < kNumMemoryOpTypes; ++i) {
+            operation_counts[i].store(0, std::memory_order_relaxed);
+            operation_bytes[i].store(0, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < kNumTransferKinds; ++i) {
+            transfer_counts[i].store(0, std::memory_order_relaxed);
+            transfer_bytes[i].store(0, std::memory_order_relaxed);
+        }
+        GPU_SIM_LOG(Info, "Profiler initialized.");
     }
 
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
     void startProfiling() {
         start_time = std::chrono::high_resolution_clock::now();
         profiling_active = true;
-        std::cout << "Profiling started." << std::endl;
+        GPU_SIM_LOG(Info, "Profiling started.");
     }
 
     void stopProfiling() {
         profiling_active = false;
-        std::cout << "Profiling stopped." << std::endl;
+        if (trace_writer) {
+            trace_writer->flush();
+        }
+        if (timeline_writer) {
+            timeline_writer->flush();
+        }
+        GPU_SIM_LOG(Info, "Profiling stopped.");
+    }
+
+    bool isProfilingActive() const {
+        return profiling_active;
+    }
+
+    // Keeps a sampled trace of individual memory operations in a ring buffer
+    // of `capacity` entries, recording one of every `sample_interval`
+    // operations. A capacity of 0 disables tracing (the default); counters are
+    // collected either way.
+    void setMemoryTracing(size_t capacity, uint64_t sample_interval = 1) {
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        tracing_enabled = capacity > 0;
+        trace_capacity = capacity;
+        trace_sample_interval = sample_interval == 0 ? 1 : sample_interval;
+        trace_sample_tick.store(0, std::memory_order_relaxed);
+        trace_ring.clear();
+        trace_ring.reserve(capacity);
+        trace_ring_next = 0;
+    }
+
+    bool isMemoryTracingEnabled() const {
+        return tracing_enabled;
+    }
+
+    // Streams every global memory access of subsequent launches to `path` as
+    // fixed-size TraceRecords (see TraceFile.h), buffering at most
+    // records_per_chunk records in memory. Analyze with gpu_sim_trace.
+    bool openTraceFile(const std::string& path, size_t records_per_chunk = 4096) {
+        trace_writer = std::make_unique<TraceWriter>(path, records_per_chunk);
+        if (!trace_writer->isOpen()) {
+            trace_writer.reset();
+            return false;
+        }
+        GPU_SIM_LOG(Info, "Streaming memory trace to " << path << ".");
+        return true;
+    }
+
+    void closeTraceFile() {
+        if (trace_writer) {
+            trace_writer->close();
+            trace_writer.reset();
+        }
+    }
+
+    // Non-null only while a trace file is open and profiling is active.
+    TraceWriter* getActiveTraceWriter() const {
+        return profiling_active ? trace_writer.get() : nullptr;
+    }
+
+    // Streams the SM, warp and kernel activity of subsequent launches to
+    // `path` as a Chrome Trace Event JSON timeline (see TimelineTrace.h),
+    // buffering at most chunk_bytes of it in memory. The file is complete
+    // once closeTimelineFile() is called or the profiler is destroyed.
+    bool openTimelineFile(const std::string& path, size_t chunk_bytes = 1 << 20) {
+        timeline_writer = std::make_unique<TimelineWriter>(path, chunk_bytes);
+        if (!timeline_writer->isOpen()) {
+            timeline_writer.reset();
+            return false;
+        }
+        GPU_SIM_LOG(Info, "Streaming timeline to " << path << ".");
+        return true;
+    }
+
+    void closeTimelineFile() {
+        if (timeline_writer) {
+            timeline_writer->close();
+            timeline_writer.reset();
+        }
+    }
+
+    // Non-null only while a timeline file is open and profiling is active.
+    TimelineWriter* getActiveTimelineWriter() const {
+        return profiling_active ? timeline_writer.get() : nullptr;
     }
 
     void logKernelExecution(const std::string& kernel_name,
                             const std::string& grid_dim_str,
                             const std::string& block_dim_str,
-                            double duration_ms) {
+                            double duration_ms,
+                            long long simulated_cycles = 0,
+                            long long warp_instructions = 0) {
         if (profiling_active) {
-            kernel_traces.push_back({kernel_name, grid_dim_str, block_dim_str, duration_ms});
+            KernelTrace trace{};
+            trace.kernel_name = kernel_name;
+            trace.grid_dim_str = grid_dim_str;
+            trace.block_dim_str = block_dim_str;
+            trace.duration_ms = duration_ms;
+            trace.simulated_cycles = simulated_cycles;
+            trace.warp_instructions = warp_instructions;
+            trace.end_cycle = simulated_cycles;
+            trace.concurrent_kernels = 1;
+            kernel_traces.push_back(std::move(trace));
         }
     }
 
-    void logMemoryOperation(const std::string& op_type, long long address, size_t size_bytes) {
-        if (profiling_active) {
-            auto current_time = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double, std::milli> elapsed = current_time - start_time;
-            memory_traces.push_back({op_type, address, size_bytes, elapsed.count()});
+    // Attaches per-instruction coalescing statistics to the most recently
+    // logged kernel.
+    void logInstructionMemoryStats(std::vector<InstructionMemoryStats> stats) {
+        if (profiling_active && !kernel_traces.empty()) {
+            kernel_traces.back().memory_instructions = std::move(stats);
+        }
+    }
+
+    // Attaches the L1 (summed over SMs) and L2 counters of the most recently
+    // logged kernel and adds them to the running totals.
+    void logCacheStats(const CacheStats& l1, const CacheStats& l2) {
+        if (!profiling_active || kernel_traces.empty()) {
+            return;
+        }
+        KernelTrace& trace = kernel_traces.back();
+        trace.cache_stats[static_cast<size_t>(CacheLevel::L1)] = l1;
+        trace.cache_stats[static_cast<size_t>(CacheLevel::L2)] = l2;
+        cache_totals[static_cast<size_t>(CacheLevel::L1)].merge(l1);
+        cache_totals[static_cast<size_t>(CacheLevel::L2)].merge(l2);
+    }
+
+    // Attaches the simulated hardware counters of the most recently logged
+    // kernel.
+    void logKernelCounters(KernelCounters counters) {
+        if (profiling_active && !kernel_traces.empty()) {
+            kernel_traces.back().counters = std::move(counters);
+        }
+    }
+
+    // Attaches the active and total lane counts of the most recently logged
+    // kernel.
+    void logLaneUtilization(long long active_lane_slots, long long lane_slots) {
+        if (profiling_active && !kernel_traces.empty()) {
+            kernel_traces.back().active_lane_slots = active_lane_slots;
+            kernel_traces.back().lane_slots = lane_slots;
+        }
+    }
+
+    // Attaches how a sampled simulation extrapolated the most recently logged
+    // kernel's cycles.
+    void logKernelSampling(const SampledCycles& sampling) {
+        if (profiling_active && !kernel_traces.empty()) {
+            kernel_traces.back().sampling = sampling;
+        }
+    }
+
+    // Places the most recently logged kernel on the device timeline.
+    void logKernelTimeline(int stream_id, long long start_cycle, long long end_cycle, int concurrent_kernels) {
+        if (profiling_active && !kernel_traces.empty()) {
+            KernelTrace& trace = kernel_traces.back();
+            trace.stream_id = stream_id;
+            trace.start_cycle = start_cycle;
+            trace.end_cycle = end_cycle;
+            trace.concurrent_kernels = concurrent_kernels;
+        }
+    }
+
+    void logMemoryOperation(MemoryOpType op_type, long long address, size_t size_bytes) {
+        if (!profiling_active) {
+            return;
+        }
+        operation_counts[static_cast<size_t>(op_type)].fetch_add(1, std::memory_order_relaxed);
+        operation_bytes[static_cast<size_t>(op_type)].fetch_add(size_bytes, std::memory_order_relaxed);
+        if (tracing_enabled) {
+            recordTrace(op_type, address, size_bytes);
+        }
+    }
+
+    // Logs `count` operations of element_bytes each on consecutive elements
+    // starting at base_address, as one counter update.
+    void logMemoryRange(MemoryOpType op_type, long long base_address, size_t count, size_t element_bytes) {
+        if (!profiling_active || count == 0) {
+            return;
+        }
+        operation_counts[static_cast<size_t>(op_type)].fetch_add(count, std::memory_order_relaxed);
+        operation_bytes[static_cast<size_t>(op_type)].fetch_add(count * element_bytes, std::memory_order_relaxed);
+        if (tracing_enabled) {
+            for (size_t i = 0; i < count; ++i) {
+                recordTrace(op_type, base_address + static_cast<long long>(i), element_bytes);
+            }
+        }
+    }
+
+    void mergeMemoryCounters(const MemoryCounters& counters) {
+        if (!profiling_active) {
+            return;
         }
+        for (size_t i = 0; i < kNumMemoryOpTypes; ++i) {
+            operation_counts[i].fetch_add(counters.operations[i], std::memory_order_relaxed);
+            operation_bytes[i].fetch_add(counters.bytes[i], std::memory_order_relaxed);
+        }
+    }
+
+    // Logs a device allocation or release (MemoryOpType::Allocate/Release) of
+    // size_bytes at address. Like transfers, these are counted whether or not
+    // a kernel is being profiled.
+    void logAllocation(MemoryOpType op_type, long long address, size_t size_bytes) {
+        operation_counts[static_cast<size_t>(op_type)].fetch_add(1, std::memory_order_relaxed);
+        operation_bytes[static_cast<size_t>(op_type)].fetch_add(size_bytes, std::memory_order_relaxed);
+        if (tracing_enabled && profiling_active) {
+            recordTrace(op_type, address, size_bytes);
+        }
+    }
+
+    // Logs one bulk transfer of size_bytes at address. Transfers are host API
+    // calls, so they are counted whether or not a kernel is being profiled.
+    void logMemoryTransfer(TransferKind kind, long long address, size_t size_bytes) {
+        transfer_counts[static_cast<size_t>(kind)].fetch_add(1, std::memory_order_relaxed);
+        transfer_bytes[static_cast<size_t>(kind)].fetch_add(size_bytes, std::memory_order_relaxed);
+        GPU_SIM_LOG(Trace, "Transfer " << transferKindToString(kind) << " of " << size_bytes
+                    << " bytes at address " << address << ".");
+    }
+
+    uint64_t getTransferCount(TransferKind kind) const {
+        return transfer_counts[static_cast<size_t>(kind)].load(std::memory_order_relaxed);
+    }
+
+    uint64_t getTransferBytes(TransferKind kind) const {
+        return transfer_bytes[static_cast<size_t>(kind)].load(std::memory_order_relaxed);
+    }
+
+    uint64_t getMemoryOperationCount(MemoryOpType op_type) const {
+        return operation_counts[static_cast<size_t>(op_type)].load(std::memory_order_relaxed);
+    }
+
+    uint64_t getMemoryBytes(MemoryOpType op_type) const {
+        return operation_bytes[static_cast<size_t>(op_type)].load(std::memory_order_relaxed);
+    }
+
+    uint64_t getTotalMemoryOperations() const {
+        uint64_t total = 0;
+        for (size_t i = 0; i < kNumMemoryOpTypes; ++i) {
+            total += operation_counts[i].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Sampled traces currently held in the ring buffer, oldest first.
+    std::vector<MemoryTrace> getMemoryTraces() const {
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        if (trace_ring.size() < trace_capacity) {
+            return trace_ring;
+        }
+        std::vector<MemoryTrace> ordered;
+        ordered.reserve(trace_ring.size());
+        for (size_t i = 0; i < trace_ring.size(); ++i) {
+            ordered.push_back(trace_ring[(trace_ring_next + i) % trace_ring.size()]);
+        }
+        return ordered;
+    }
+
+    // Latest global memory footprint, reported by GPUMemory as pages are
+    // allocated or mapped.
+    void logMemoryFootprint(const MemoryFootprint& footprint) {
+        memory_footprint = footprint;
+    }
+
+    const MemoryFootprint& getMemoryFootprint() const {
+        return memory_footprint;
+    }
+
+    const CacheStats& getCacheStats(CacheLevel level) const {
+        return cache_totals[static_cast<size_t>(level)];
+    }
+
+    const std::vector<KernelTrace>& getKernelTraces() const {
+        return kernel_traces;
     }
 
     void printSummary() const {
         std::cout << "\n--- Profiling Summary ---" << std::endl;
 
-        if (kernel_traces.empty() && memory_traces.empty()) {
+        uint64_t total_memory_ops = getTotalMemoryOperations();
+        uint64_t total_transfers = 0;
+        for (size_t i = 0; i < kNumTransferKinds; ++i) {
+            total_transfers += getTransferCount(static_cast<TransferKind>(i));
+        }
+        if (kernel_traces.empty() && total_memory_ops == 0 && total_transfers == 0) {
             std::cout << "No profiling data collected." << std::endl;
             return;
         }
@@ -76,39 +493,98 @@ public:
                 std::cout << "  - Kernel: " << trace.kernel_name
                           << ", Grid: " << trace.grid_dim_str
                           << ", Block: " << trace.block_dim_str
-                          << ", Duration: " << trace.duration_ms << " ms" << std::endl;
+                          << ", Duration: " << trace.duration_ms << " ms";
+                if (trace.simulated_cycles > 0) {
+                    std::cout << ", Cycles: " << trace.simulated_cycles
+                              << ", Warp Instructions: " << trace.warp_instructions
+                              << ", IPC: " << static_cast<double>(trace.warp_instructions) / trace.simulated_cycles;
+                }
+                if (trace.lane_slots > 0) {
+                    std::cout << ", Lane Utilization: " << trace.laneUtilization() * 100.0 << "%";
+                }
+                if (trace.stream_id != 0 || trace.concurrent_kernels > 1) {
+                    std::cout << ", Stream: " << trace.stream_id << ", Device Cycles: ["
+                              << trace.start_cycle << ", " << trace.end_cycle << ")";
+                    if (trace.concurrent_kernels > 1) {
+                        std::cout << " with " << trace.concurrent_kernels - 1 << " concurrent kernel(s)";
+                    }
+                }
+                std::cout << std::endl;
+                if (trace.sampling.isSampled()) {
+                    std::cout << "      Sampled: " << trace.sampling.detailed_blocks << " of " << trace.sampling.total_blocks
+                              << " blocks in detail, cycles +/- " << trace.sampling.error_cycles
+                              << " (95%); counters, caches and coalescing cover the detailed blocks" << std::endl;
+                }
+                const PerfCounters& totals = trace.counters.totals;
+                if (totals.instructions_issued > 0) {
+                    std::cout << "      Counters: " << totals.active_cycles << " active SM cycles, stall warp-cycles:";
+                    for (size_t reason = 0; reason < kNumStallReasons; ++reason) {
+                        std::cout << (reason == 0 ? " " : ", ") << stallReasonToString(static_cast<StallReason>(reason))
+                                  << " " << totals.stall_cycles[reason];
+                    }
+                    std::cout << std::endl;
+                }
+                if (totals.shared_requests > 0) {
+                    std::cout << "      Shared Memory: " << totals.shared_requests << " warp accesses, "
+                              << totals.bank_conflict_cycles << " bank-conflict cycles" << std::endl;
+                }
+                if (totals.atomic_requests > 0) {
+                    std::cout << "      Atomics: " << totals.atomic_requests << " warp accesses, "
+                              << totals.atomic_contention_cycles << " contention cycles" << std::endl;
+                }
+                for (size_t level = 0; level < kNumCacheLevels; ++level) {
+                    const CacheStats& cache = trace.cache_stats[level];
+                    if (cache.accesses == 0) {
+                        continue;
+                    }
+                    std::cout << "      " << cacheLevelToString(static_cast<CacheLevel>(level))
+                              << ": " << cache.accesses << " accesses, " << cache.hits << " hits, "
+                              << cache.misses << " misses (hit rate "
+                              << static_cast<double>(cache.hits) * 100.0 / cache.accesses << "%), "
+                              << cache.evictions << " evictions, " << cache.writebacks << " writebacks" << std::endl;
+                }
+                for (const InstructionMemoryStats& stats : trace.memory_instructions) {
+                    std::cout << "      PC " << stats.pc << " " << stats.instruction
+                              << ": " << stats.warp_requests << " warp requests, "
+                              << stats.transactions << " transactions, coalescing efficiency "
+                              << stats.efficiency() * 100.0 << "%" << std::endl;
+                }
             }
         }
 
-        std::cout << "\nMemory Operations Summary (Total: " << memory_traces.size() << "):" << std::endl;
-        if (memory_traces.empty()) {
+        std::cout << "\nMemory Operations Summary (Total: " << total_memory_ops << "):" << std::endl;
+        if (total_memory_ops == 0) {
             std::cout << "  No memory operations logged." << std::endl;
         } else {
-            int reads = 0, writes = 0, allocates = 0, releases = 0;
-            size_t total_read_bytes = 0, total_written_bytes = 0;
-
-            for (const auto& trace : memory_traces) {
-                if (trace.op_type == "read") {
-                    reads++;
-                    total_read_bytes += trace.size_bytes;
-                } else if (trace.op_type == "write") {
-                    writes++;
-                    total_written_bytes += trace.size_bytes;
-                } else if (trace.op_type == "allocate") {
-                    allocates++;
-                } else if (trace.op_type == "release") {
-                    releases++;
-                }
+            std::cout << "  Reads: " << getMemoryOperationCount(MemoryOpType::Read)
+                      << " (" << getMemoryBytes(MemoryOpType::Read) << " bytes)" << std::endl;
+            std::cout << "  Writes: " << getMemoryOperationCount(MemoryOpType::Write)
+                      << " (" << getMemoryBytes(MemoryOpType::Write) << " bytes)" << std::endl;
+            std::cout << "  Allocates: " << getMemoryOperationCount(MemoryOpType::Allocate) << std::endl;
+            std::cout << "  Releases: " << getMemoryOperationCount(MemoryOpType::Release) << std::endl;
+        }
+        if (total_transfers > 0) {
+            std::cout << "  Transfers:";
+            for (size_t i = 0; i < kNumTransferKinds; ++i) {
+                TransferKind kind = static_cast<TransferKind>(i);
+                std::cout << (i == 0 ? " " : ", ") << transferKindToString(kind) << " "
+                          << getTransferCount(kind) << " (" << getTransferBytes(kind) << " bytes)";
             }
-            std::cout << "  Reads: " << reads << " (" << total_read_bytes << " bytes)" << std::endl;
-            std::cout << "  Writes: " << writes << " (" << total_written_bytes << " bytes)" << std::endl;
-            std::cout << "  Allocates: " << allocates << std::endl;
-            std::cout << "  Releases: " << releases << std::endl;
-
-            std::cout << "\n  Recent Memory Operations (up to 5):" << std::endl;
+            std::cout << std::endl;
+        }
+        if (total_memory_ops > 0 && memory_footprint.virtual_bytes > 0) {
+            std::cout << "  Footprint: " << memory_footprint.virtual_bytes << " bytes virtual, "
+                      << memory_footprint.resident_bytes << " resident, "
+                      << memory_footprint.mapped_bytes << " file-mapped ("
+                      << memory_footprint.page_bytes << "-byte pages)" << std::endl;
+        }
+        if (total_memory_ops > 0 && tracing_enabled) {
+            std::vector<MemoryTrace> traces = getMemoryTraces();
+            std::cout << "\n  Recent Memory Operations (up to 5, sampled 1 in "
+                      << trace_sample_interval << "):" << std::endl;
             int count = 0;
-            for (auto it = memory_traces.rbegin(); it != memory_traces.rend() && count < 5; ++it, ++count) {
-                std::cout << "    - Type: " << it->op_type
+            for (auto it = traces.rbegin(); it != traces.rend() && count < 5; ++it, ++count) {
+                std::cout << "    - Type: " << memoryOpTypeToString(it->op_type)
                           << ", Address: " << it->address
                           << ", Size: " << it->size_bytes << " bytes"
                           << ", Time: " << it->time_stamp_ms << " ms" << std::endl;
@@ -118,10 +594,268 @@ public:
         std::cout << "-------------------------" << std::endl;
     }
 
+    // Per-kernel hotspot report: the kernel listing annotated with issue and
+    // stall counts per instruction (the top_instructions costliest marked
+    // with '>'), the opcode mix, per-SM counters and the top_warps warps
+    // that stalled most.
+    void printHotspotReport(size_t top_instructions = 3, size_t top_warps = 5) const {
+        for (const KernelTrace& trace : kernel_traces) {
+            const KernelCounters& counters = trace.counters;
+            const PerfCounters& totals = counters.totals;
+            std::cout << "\n--- Hotspot Report: " << trace.kernel_name << " " << trace.grid_dim_str
+                      << "x" << trace.block_dim_str << " ---" << std::endl;
+            if (totals.instructions_issued == 0) {
+                std::cout << "  No instructions issued." << std::endl;
+                continue;
+            }
+            std::cout << "  " << totals.instructions_issued << " warp instructions, "
+                      << totals.active_cycles << " active SM cycles, "
+                      << totals.totalStallCycles() << " stall warp-cycles" << std::endl;
+            if (totals.shared_requests > 0) {
+                std::cout << "  " << totals.shared_requests << " shared memory accesses, "
+                          << totals.bank_conflict_cycles << " bank-conflict cycles" << std::endl;
+            }
+            if (totals.atomic_requests > 0) {
+                std::cout << "  " << totals.atomic_requests << " atomic accesses, "
+                          << totals.atomic_contention_cycles << " contention cycles" << std::endl;
+            }
+            std::cout << "  Opcodes:";
+            for (size_t op = 0; op < kNumOpCodes; ++op) {
+                if (totals.opcode_counts[op] > 0) {
+                    std::cout << " " << Instruction(static_cast<OpCode>(op)).opcodeToString()
+                              << " " << totals.opcode_counts[op];
+                }
+            }
+            std::cout << std::endl;
+
+            // An instruction's cost is the warp-cycles spent issuing it or
+            // waiting to issue it.
+            long long total_cost = totals.instructions_issued + totals.totalStallCycles();
+            std::vector<size_t> by_cost(counters.instructions.size());
+            for (size_t pc = 0; pc < by_cost.size(); ++pc) {
+                by_cost[pc] = pc;
+            }
+            auto cost = [&](size_t pc) {
+                return counters.instructions[pc].issued + counters.instructions[pc].totalStallCycles();
+            };
+            std::stable_sort(by_cost.begin(), by_cost.end(), [&](size_t a, size_t b) { return cost(a) > cost(b); });
+            std::vector<char> hot(by_cost.size(), 0);
+            for (size_t i = 0; i < by_cost.size() && i < top_instructions && cost(by_cost[i]) > 0; ++i) {
+                hot[by_cost[i]] = 1;
+            }
+
+            std::cout << "      PC    Issued  Lanes/Issue   MemLat  Throttle  Shared  Barrier  Atomic  NotSel   Cost%  Instruction"
+                      << std::endl;
+            std::ios_base::fmtflags flags = std::cout.flags();
+            std::cout << std::fixed << std::setprecision(1);
+            for (size_t pc = 0; pc < counters.instructions.size(); ++pc) {
+                const InstructionCounters& instruction = counters.instructions[pc];
+                double lanes_per_issue = instruction.issued > 0
+                    ? static_cast<double>(instruction.active_lanes) / instruction.issued : 0.0;
+                std::cout << "  " << (hot[pc] ? '>' : ' ') << std::setw(5) << pc
+                          << std::setw(10) << instruction.issued
+                          << std::setw(13) << lanes_per_issue
+                          << std::setw(9) << instruction.stall_cycles[static_cast<size_t>(StallReason::MemoryLatency)]
+                          << std::setw(10) << instruction.stall_cycles[static_cast<size_t>(StallReason::MemoryThrottle)]
+                          << std::setw(8) << instruction.stall_cycles[static_cast<size_t>(StallReason::SharedMemory)]
+                          << std::setw(9) << instruction.stall_cycles[static_cast<size_t>(StallReason::Barrier)]
+                          << std::setw(8) << instruction.stall_cycles[static_cast<size_t>(StallReason::Atomic)]
+                          << std::setw(8) << instruction.stall_cycles[static_cast<size_t>(StallReason::NotSelected)]
+                          << std::setw(8) << (total_cost > 0 ? cost(pc) * 100.0 / total_cost : 0.0)
+                          << "  " << (pc < counters.listing.size() ? counters.listing[pc] : "") << std::endl;
+            }
+            std::cout.flags(flags);
+
+            for (const SMCounters& sm : counters.sms) {
+                std::cout << "  SM " << sm.sm_id << ": " << sm.counters.instructions_issued << " instructions, "
+                          << sm.counters.active_cycles << " active cycles, "
+                          << sm.counters.totalStallCycles() << " stall warp-cycles" << std::endl;
+            }
+
+            std::vector<const WarpCounters*> stalled;
+            for (const WarpCounters& warp : counters.warps) {
+                stalled.push_back(&warp);
+            }
+            std::stable_sort(stalled.begin(), stalled.end(), [](const WarpCounters* a, const WarpCounters* b) {
+                return a->counters.totalStallCycles() > b->counters.totalStallCycles();
+            });
+            if (stalled.size() > top_warps) {
+                stalled.resize(top_warps);
+            }
+            std::cout << "  Most stalled warps:" << std::endl;
+            for (const WarpCounters* warp : stalled) {
+                std::cout << "    Warp " << warp->warp_id << " (SM " << warp->sm_id << ", cycles "
+                          << warp->admit_cycle << "-" << warp->retire_cycle << "): "
+                          << warp->counters.instructions_issued << " instructions, stall cycles:";
+                for (size_t reason = 0; reason < kNumStallReasons; ++reason) {
+                    std::cout << (reason == 0 ? " " : ", ") << stallReasonToString(static_cast<StallReason>(reason))
+                              << " " << warp->counters.stall_cycles[reason];
+                }
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    // Counters and kernel traces, for checkpoints. The sampled trace ring,
+    // trace file and profiling state are not saved.
+    void saveState(CheckpointWriter& writer) const {
+        for (size_t i = 0; i < kNumMemoryOpTypes; ++i) {
+            writer.write<uint64_t>(operation_counts[i].load(std::memory_order_relaxed));
+            writer.write<uint64_t>(operation_bytes[i].load(std::memory_order_relaxed));
+        }
+        for (size_t i = 0; i < kNumTransferKinds; ++i) {
+            writer.write<uint64_t>(transfer_counts[i].load(std::memory_order_relaxed));
+            writer.write<uint64_t>(transfer_bytes[i].load(std::memory_order_relaxed));
+        }
+        for (size_t level = 0; level < kNumCacheLevels; ++level) {
+            writer.write(cache_totals[level]);
+        }
+        writer.write<uint64_t>(kernel_traces.size());
+        for (const KernelTrace& trace : kernel_traces) {
+            writer.writeString(trace.kernel_name);
+            writer.writeString(trace.grid_dim_str);
+            writer.writeString(trace.block_dim_str);
+            writer.write(trace.duration_ms);
+            writer.write<int64_t>(trace.simulated_cycles);
+            writer.write<int64_t>(trace.warp_instructions);
+            writer.write<uint64_t>(trace.memory_instructions.size());
+            for (const InstructionMemoryStats& stats : trace.memory_instructions) {
+                writer.write<int32_t>(stats.pc);
+                writer.writeString(stats.instruction);
+                writer.write(stats.warp_requests);
+                writer.write(stats.transactions);
+                writer.write(stats.requested_bytes);
+                writer.write(stats.transferred_bytes);
+            }
+            for (size_t level = 0; level < kNumCacheLevels; ++level) {
+                writer.write(trace.cache_stats[level]);
+            }
+            writer.write<int64_t>(trace.active_lane_slots);
+            writer.write<int64_t>(trace.lane_slots);
+            writer.write<int32_t>(trace.stream_id);
+            writer.write<int64_t>(trace.start_cycle);
+            writer.write<int64_t>(trace.end_cycle);
+            writer.write<int32_t>(trace.concurrent_kernels);
+            writer.write(trace.counters.totals);
+            writer.write(trace.sampling);
+            writer.writeVector(trace.counters.sms);
+            writer.writeVector(trace.counters.warps);
+            writer.writeVector(trace.counters.instructions);
+            writer.write<uint64_t>(trace.counters.listing.size());
+            for (const std::string& line : trace.counters.listing) {
+                writer.writeString(line);
+            }
+        }
+    }
+
+    bool restoreState(CheckpointReader& reader) {
+        uint64_t values[2 * (kNumMemoryOpTypes + kNumTransferKinds)] = {};
+        for (uint64_t& value : values) {
+            reader.read(value);
+        }
+        CacheStats totals[kNumCacheLevels];
+        for (CacheStats& level_totals : totals) {
+            reader.read(level_totals);
+        }
+        std::vector<KernelTrace> traces;
+        uint64_t num_traces = 0;
+        reader.read(num_traces);
+        for (uint64_t t = 0; t < num_traces && reader.ok(); ++t) {
+            KernelTrace trace{};
+            int64_t simulated_cycles = 0, warp_instructions = 0, active_lanes = 0, lanes = 0, start = 0, end = 0;
+            int32_t stream_id = 0, concurrent = 1;
+            uint64_t num_stats = 0;
+            reader.readString(trace.kernel_name);
+            reader.readString(trace.grid_dim_str);
+            reader.readString(trace.block_dim_str);
+            reader.read(trace.duration_ms);
+            reader.read(simulated_cycles);
+            reader.read(warp_instructions);
+            reader.read(num_stats);
+            for (uint64_t i = 0; i < num_stats && reader.ok(); ++i) {
+                InstructionMemoryStats stats;
+                int32_t pc = 0;
+                reader.read(pc);
+                reader.readString(stats.instruction);
+                reader.read(stats.warp_requests);
+                reader.read(stats.transactions);
+                reader.read(stats.requested_bytes);
+                reader.read(stats.transferred_bytes);
+                stats.pc = pc;
+                trace.memory_instructions.push_back(stats);
+            }
+            for (CacheStats& level_stats : trace.cache_stats) {
+                reader.read(level_stats);
+            }
+            reader.read(active_lanes);
+            reader.read(lanes);
+            reader.read(stream_id);
+            reader.read(start);
+            reader.read(end);
+            reader.read(concurrent);
+            uint64_t listing_size = 0;
+            reader.read(trace.counters.totals);
+            reader.read(trace.sampling);
+            reader.readVector(trace.counters.sms);
+            reader.readVector(trace.counters.warps);
+            reader.readVector(trace.counters.instructions);
+            reader.read(listing_size);
+            for (uint64_t i = 0; i < listing_size && reader.ok(); ++i) {
+                std::string line;
+                reader.readString(line);
+                trace.counters.listing.push_back(std::move(line));
+            }
+            trace.simulated_cycles = simulated_cycles;
+            trace.warp_instructions = warp_instructions;
+            trace.active_lane_slots = active_lanes;
+            trace.lane_slots = lanes;
+            trace.stream_id = stream_id;
+            trace.start_cycle = start;
+            trace.end_cycle = end;
+            trace.concurrent_kernels = concurrent;
+            traces.push_back(std::move(trace));
+        }
+        if (!reader.ok()) {
+            GPU_SIM_LOG(Error, "Error: Checkpoint state for the profiler is malformed.");
+            return false;
+        }
+
+        size_t next = 0;
+        for (size_t i = 0; i < kNumMemoryOpTypes; ++i) {
+            operation_counts[i].store(values[next++], std::memory_order_relaxed);
+            operation_bytes[i].store(values[next++], std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < kNumTransferKinds; ++i) {
+            transfer_counts[i].store(values[next++], std::memory_order_relaxed);
+            transfer_bytes[i].store(values[next++], std::memory_order_relaxed);
+        }
+        for (size_t level = 0; level < kNumCacheLevels; ++level) {
+            cache_totals[level] = totals[level];
+        }
+        kernel_traces = std::move(traces);
+        return true;
+    }
+
     void clear() {
         kernel_traces.clear();
-        memory_traces.clear();
+        for (size_t level = 0; level < kNumCacheLevels; ++level) {
+            cache_totals[level] = CacheStats();
+        }
+        for (size_t i = 0; i < kNumMemoryOpTypes; ++i) {
+            operation_counts[i].store(0, std::memory_order_relaxed);
+            operation_bytes[i].store(0, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < kNumTransferKinds; ++i) {
+            transfer_counts[i].store(0, std::memory_order_relaxed);
+            transfer_bytes[i].store(0, std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(trace_mutex);
+            trace_ring.clear();
+            trace_ring_next = 0;
+            trace_sample_tick.store(0, std::memory_order_relaxed);
+        }
         profiling_active = false;
-        std::cout << "Profiler data cleared." << std::endl;
+        GPU_SIM_LOG(Info, "Profiler data cleared.");
     }
 };
@@ -0,0 +1,114 @@
+// src/sim/Stream.h
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+class GPUSimulator;
+
+// A queue of device work (kernel launches, copies, event records and waits)
+// on a GPUSimulator. Work on one stream runs in submission order; work on
+// different streams may overlap, and kernels from different streams share the
+// SMs. Stream 0 is the default stream: its work starts only after all work
+// submitted before it on any stream, and work submitted after it on any
+// stream waits for it. Streams are cheap handles created by
+// GPUSimulator::createStream().
+//
+// The device starts on queued work right away, and kernels share the SMs
+// only if they are ready when it picks up its next batch. How launches are
+// grouped, and so the device timeline, therefore depends on how fast the host
+// queues work; results do not, unless kernels on different streams race on
+// the same memory.
+class Stream {
+private:
+    int id;
+
+public:
+    explicit Stream(int stream_id = 0) : id(stream_id) {}
+
+    int getID() const {
+        return id;
+    }
+
+    bool isDefault() const {
+        return id == 0;
+    }
+
+    bool operator==(const Stream& other) const {
+        return id == other.id;
+    }
+
+    bool operator!=(const Stream& other) const {
+        return id != other.id;
+    }
+};
+
+// Marks a point in a stream. GPUSimulator::recordEvent() enqueues a record;
+// the event completes once the work before it on that stream has finished,
+// and holds the device cycle at which that happened. Other streams can wait
+// for it with GPUSimulator::waitEvent(). Copies of an Event share its state.
+class Event {
+private:
+    friend class GPUSimulator;
+
+    struct State {
+        std::mutex mutex;
+        std::condition_variable completed;
+        uint64_t records_enqueued = 0;
+        uint64_t records_completed = 0;
+        long long cycle = -1;
+    };
+
+    std::shared_ptr<State> state;
+
+public:
+    Event() : state(std::make_shared<State>()) {}
+
+    // True once every record enqueued so far has completed (and trivially
+    // for an event that was never recorded).
+    bool query() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->records_completed == state->records_enqueued;
+    }
+
+    // Blocks the calling host thread until query() is true.
+    void synchronize() const {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->completed.wait(lock, [this] { return state->records_completed == state->records_enqueued; });
+    }
+
+    bool isRecorded() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->records_completed > 0;
+    }
+
+    // Device cycle of the latest completed record, or -1.
+    long long getCycle() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->cycle;
+    }
+
+    // Simulated cycles between two completed events.
+    static long long elapsedCycles(const Event& start, const Event& end) {
+        return end.getCycle() - start.getCycle();
+    }
+};
+
+// Outcome of one kernel launch, delivered through the future that
+// GPUSimulator::launchKernelAsync() returns. Cycles are on the device
+// timeline shared by all streams.
+struct KernelLaunchResult {
+    bool completed = false;         // Every SM finished the kernel without issues.
+    int stream_id = 0;
+    long long start_cycle = 0;
+    long long end_cycle = 0;
+    long long warp_instructions = 0;
+    int concurrent_kernels = 1;     // Kernels (this one included) that shared the SMs with it.
+    long long cycle_error = 0;      // 95% error bound on cycles() under sampled simulation.
+
+    long long cycles() const {
+        return end_cycle - start_cycle;
+    }
+};
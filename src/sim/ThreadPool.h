@@ -0,0 +1,117 @@
+// src/sim/ThreadPool.h
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+// Fixed-size pool of host worker threads. Work is handed out as an index range
+// through parallelFor(); each worker keeps claiming indices until the range is
+// exhausted, so a worker may end up running several items (e.g. several SMs).
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+
+    const std::function<void(size_t)>* job;
+    size_t job_count;
+    std::atomic<size_t> next_index;
+    size_t generation;
+    size_t busy_workers;
+    bool stopping;
+    std::exception_ptr first_error;
+
+    void workerLoop() {
+        size_t seen_generation = 0;
+        while (true) {
+            const std::function<void(size_t)>* current_job = nullptr;
+            size_t count = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_ready.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping) {
+                    return;
+                }
+                seen_generation = generation;
+                current_job = job;
+                count = job_count;
+            }
+
+            for (size_t i = next_index.fetch_add(1); i < count; i = next_index.fetch_add(1)) {
+                try {
+                    (*current_job)(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!first_error) {
+                        first_error = std::current_exception();
+                    }
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy_workers == 0) {
+                work_done.notify_all();
+            }
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t num_workers)
+        : job(nullptr), job_count(0), next_index(0), generation(0), busy_workers(0), stopping(false) {
+        if (num_workers == 0) {
+            num_workers = 1;
+        }
+        workers.reserve(num_workers);
+        for (size_t i = 0; i < num_workers; ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_ready.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t getNumWorkers() const {
+        return workers.size();
+    }
+
+    // Runs fn(0) .. fn(count - 1) across the workers and blocks until all have
+    // returned. The first exception thrown by any item is rethrown here.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+        if (count == 0) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &fn;
+        job_count = count;
+        next_index.store(0);
+        first_error = nullptr;
+        busy_workers = workers.size();
+        generation++;
+        work_ready.notify_all();
+        work_done.wait(lock, [&] { return busy_workers == 0; });
+        job = nullptr;
+
+        if (first_error) {
+            std::exception_ptr error = first_error;
+            first_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+};
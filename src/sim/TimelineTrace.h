@@ -0,0 +1,230 @@
+// src/sim/TimelineTrace.h
+#pragma once
+
+#include "Log.h"
+#include "../arch/Instruction.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <set>
+#include <utility>
+#include <mutex>
+
+// One SM timeline event, in cycles relative to the start of the SM's
+// execution. Fixed-size so SMs can batch them cheaply.
+enum class TimelineEventKind : uint8_t {
+    WarpResident,       // A warp occupied a slot from start to end.
+    Issue,              // The warp in a slot issued an instruction at start.
+    MemoryRequest       // The warp's memory request issued at start completed at end.
+};
+
+struct TimelineEvent {
+    TimelineEventKind kind;
+    OpCode opcode;          // Issue, MemoryRequest.
+    int sm_id;
+    int slot;
+    int warp_id;
+    int pc;                 // Issue, MemoryRequest.
+    int value;              // Active lanes (Issue) or transactions (MemoryRequest).
+    long long start;
+    long long end;
+    uint64_t flow_id;       // MemoryRequest.
+};
+
+// Writes a Chrome Trace Event JSON file (loadable in chrome://tracing and
+// ui.perfetto.dev) through a chunk buffer of at most chunk_bytes, so memory
+// use stays bounded however long the run is. One simulated cycle is shown
+// as one microsecond.
+//
+// Process 0 ("Device") has a track per stream with a slice per kernel. Each
+// SM is process sm_id + 1 with a track per warp slot: warp residency slices
+// contain one-cycle issue slices, so gaps between them are stalls, and
+// memory requests are flow arrows from the issuing instruction to the
+// warp's first instruction after the data arrived.
+//
+// append() and appendKernel() may be called from several host threads;
+// SMs batch their events and append them a buffer at a time.
+class TimelineWriter {
+private:
+    std::FILE* file;
+    std::string chunk;
+    size_t chunk_bytes;
+    bool first_event;
+    long long cycle_offset;
+    uint64_t events_written;
+    std::set<std::pair<int, int>> named_tracks;
+    std::set<int> named_processes;
+    std::mutex mutex;
+
+    void flushLocked() {
+        if (file && !chunk.empty()) {
+            if (std::fwrite(chunk.data(), 1, chunk.size(), file) != chunk.size()) {
+                GPU_SIM_LOG(Error, "Error: Failed to write timeline events to disk.");
+            }
+        }
+        chunk.clear();
+    }
+
+    void emitLocked(const char* event) {
+        if (!first_event) {
+            chunk += ",\n";
+        }
+        first_event = false;
+        chunk += event;
+        events_written++;
+        if (chunk.size() >= chunk_bytes) {
+            flushLocked();
+        }
+    }
+
+    static std::string escapeJson(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) >= 0x20) {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    void nameTrackLocked(int pid, int tid, const char* process_name, const char* thread_name) {
+        char event[192];
+        if (named_processes.insert(pid).second) {
+            std::snprintf(event, sizeof(event),
+                          "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"%s\"}},\n"
+                          "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_sort_index\",\"args\":{\"sort_index\":%d}}",
+                          pid, process_name, pid, pid);
+            emitLocked(event);
+        }
+        if (named_tracks.insert(std::make_pair(pid, tid)).second) {
+            std::snprintf(event, sizeof(event),
+                          "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+                          pid, tid, thread_name);
+            emitLocked(event);
+        }
+    }
+
+    void emitEventLocked(const TimelineEvent& e) {
+        int pid = e.sm_id + 1;
+        char process_name[32];
+        char thread_name[32];
+        std::snprintf(process_name, sizeof(process_name), "SM %d", e.sm_id);
+        std::snprintf(thread_name, sizeof(thread_name), "Warp slot %d", e.slot);
+        nameTrackLocked(pid, e.slot, process_name, thread_name);
+
+        std::string opcode_name = Instruction(e.opcode).opcodeToString();
+        const char* opcode = opcode_name.c_str();
+        char event[256];
+        switch (e.kind) {
+            case TimelineEventKind::WarpResident:
+                std::snprintf(event, sizeof(event),
+                              "{\"ph\":\"X\",\"cat\":\"warp\",\"name\":\"Warp %d\",\"pid\":%d,\"tid\":%d,"
+                              "\"ts\":%lld,\"dur\":%lld,\"args\":{\"warp\":%d}}",
+                              e.warp_id, pid, e.slot, cycle_offset + e.start, e.end - e.start, e.warp_id);
+                emitLocked(event);
+                break;
+            case TimelineEventKind::Issue:
+                std::snprintf(event, sizeof(event),
+                              "{\"ph\":\"X\",\"cat\":\"issue\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,"
+                              "\"ts\":%lld,\"dur\":1,\"args\":{\"warp\":%d,\"pc\":%d,\"active_lanes\":%d}}",
+                              opcode, pid, e.slot, cycle_offset + e.start, e.warp_id, e.pc, e.value);
+                emitLocked(event);
+                break;
+            case TimelineEventKind::MemoryRequest:
+                std::snprintf(event, sizeof(event),
+                              "{\"ph\":\"s\",\"cat\":\"memory\",\"name\":\"%s\",\"id\":%llu,\"pid\":%d,\"tid\":%d,"
+                              "\"ts\":%lld,\"args\":{\"pc\":%d,\"transactions\":%d}}",
+                              opcode, static_cast<unsigned long long>(e.flow_id), pid, e.slot,
+                              cycle_offset + e.start, e.pc, e.value);
+                emitLocked(event);
+                std::snprintf(event, sizeof(event),
+                              "{\"ph\":\"f\",\"cat\":\"memory\",\"name\":\"%s\",\"id\":%llu,\"pid\":%d,\"tid\":%d,"
+                              "\"ts\":%lld}",
+                              opcode, static_cast<unsigned long long>(e.flow_id), pid, e.slot, cycle_offset + e.end);
+                emitLocked(event);
+                break;
+        }
+    }
+
+public:
+    TimelineWriter(const std::string& path, size_t chunk_bytes)
+        : file(std::fopen(path.c_str(), "w")),
+          chunk_bytes(chunk_bytes == 0 ? 1 : chunk_bytes),
+          first_event(true),
+          cycle_offset(0),
+          events_written(0) {
+        if (!file) {
+            GPU_SIM_LOG(Error, "Error: Could not open timeline file " << path << " for writing.");
+            return;
+        }
+        chunk.reserve(this->chunk_bytes + 512);
+        chunk = "{\"otherData\":{\"time_unit\":\"1 us = 1 simulated cycle\"},"
+                "\"traceEvents\":[\n";
+    }
+
+    ~TimelineWriter() {
+        close();
+    }
+
+    TimelineWriter(const TimelineWriter&) = delete;
+    TimelineWriter& operator=(const TimelineWriter&) = delete;
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    // Device cycle at which the SM cycles of the following appends start.
+    void setCycleOffset(long long offset) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cycle_offset = offset;
+    }
+
+    void append(const TimelineEvent* events, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i) {
+            emitEventLocked(events[i]);
+        }
+    }
+
+    // A kernel on stream_id's device track, in device cycles.
+    void appendKernel(const std::string& name, int stream_id, long long start_cycle, long long end_cycle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        char thread_name[32];
+        std::snprintf(thread_name, sizeof(thread_name), "Stream %d", stream_id);
+        nameTrackLocked(0, stream_id, "Device", thread_name);
+        std::string event = "{\"ph\":\"X\",\"cat\":\"kernel\",\"name\":\"" + escapeJson(name) + "\",\"pid\":0,\"tid\":"
+            + std::to_string(stream_id) + ",\"ts\":" + std::to_string(start_cycle)
+            + ",\"dur\":" + std::to_string(end_cycle - start_cycle) + "}";
+        emitLocked(event.c_str());
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushLocked();
+        if (file) {
+            std::fflush(file);
+        }
+    }
+
+    // Finishes the JSON document; events appended afterwards are dropped.
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!file) {
+            return;
+        }
+        chunk += "\n]}\n";
+        flushLocked();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    uint64_t getEventsWritten() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return events_written;
+    }
+};
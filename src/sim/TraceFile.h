@@ -0,0 +1,122 @@
+// src/sim/TraceFile.h
+#pragma once
+
+#include "Log.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mutex>
+
+// On-disk memory trace format: a TraceFileHeader followed by a flat array of
+// fixed-size TraceRecords in host byte order. Fixed-size records let readers
+// mmap the file and index it directly.
+constexpr char kTraceFileMagic[8] = {'G', 'P', 'U', 'S', 'I', 'M', 'T', 'R'};
+constexpr uint32_t kTraceFileVersion = 1;
+
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+// One global memory access. A contiguous warp access (e.g. a unit-stride LOAD)
+// is a single record whose size covers the whole span.
+struct TraceRecord {
+    uint8_t op_type;     // MemoryOpType
+    uint8_t reserved;
+    uint16_t sm_id;
+    uint32_t warp_id;
+    uint64_t cycle;      // Device cycle: the launch's start plus the SM's cycle.
+    uint64_t address;    // Word address of the first element.
+    uint32_t size_bytes;
+    uint32_t padding;
+};
+
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord must stay 32 bytes");
+
+// Appends TraceRecords to a file through a fixed-size chunk buffer, so memory
+// use is bounded no matter how long the run is. append() may be called from
+// several host threads; callers on hot paths should batch records and append
+// them a chunk at a time.
+class TraceWriter {
+private:
+    std::FILE* file;
+    std::vector<TraceRecord> chunk;
+    size_t chunk_records;
+    uint64_t records_written;
+    std::mutex mutex;
+
+    void flushLocked() {
+        if (file && !chunk.empty()) {
+            size_t written = std::fwrite(chunk.data(), sizeof(TraceRecord), chunk.size(), file);
+            if (written != chunk.size()) {
+                GPU_SIM_LOG(Error, "Error: Failed to write memory trace records to disk.");
+            }
+            records_written += written;
+        }
+        chunk.clear();
+    }
+
+public:
+    TraceWriter(const std::string& path, size_t records_per_chunk)
+        : file(std::fopen(path.c_str(), "wb")),
+          chunk_records(records_per_chunk == 0 ? 1 : records_per_chunk),
+          records_written(0) {
+        if (!file) {
+            GPU_SIM_LOG(Error, "Error: Could not open trace file " << path << " for writing.");
+            return;
+        }
+        TraceFileHeader header;
+        std::memcpy(header.magic, kTraceFileMagic, sizeof(header.magic));
+        header.version = kTraceFileVersion;
+        header.record_size = sizeof(TraceRecord);
+        std::fwrite(&header, sizeof(header), 1, file);
+        chunk.reserve(chunk_records);
+    }
+
+    ~TraceWriter() {
+        close();
+    }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    void append(const TraceRecord* records, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i) {
+            chunk.push_back(records[i]);
+            if (chunk.size() >= chunk_records) {
+                flushLocked();
+            }
+        }
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushLocked();
+        if (file) {
+            std::fflush(file);
+        }
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushLocked();
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    uint64_t getRecordsWritten() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return records_written + chunk.size();
+    }
+};
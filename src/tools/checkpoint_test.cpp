@@ -0,0 +1,209 @@
+// CppGPUSimulator/src/tools/checkpoint_test.cpp
+// Checks that a launch stopped part way and resumed, in the same simulator
+// or in a fresh one restored from a checkpoint, ends with the same global
+// memory image and cycles as one run uninterrupted. Each case runs a kernel
+// with divergent loops, shared memory and barriers, whose blocks outnumber
+// the SMs' resident slots, under every scheduler policy with and without
+// memory timing and host workers. Exits non-zero on any mismatch.
+
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "sim/GPUSimulator.h"
+#include "sim/Log.h"
+#include "arch/Assembler.h"
+
+static constexpr int kBlocks = 12;
+static constexpr int kBlockThreads = 48;
+static constexpr int kThreads = kBlocks * kBlockThreads;
+static constexpr int kValues = kThreads;
+static constexpr int kOutput = 2 * kThreads;
+static constexpr int kMemoryWords = 3 * kThreads + 1;
+static const char* const kCheckpointPath = "checkpoint_test.ckpt";
+
+// Thread t sums 0 .. Mem[t] - 1 onto Mem[kValues + t], so the lanes of a
+// warp loop a different number of times, and stores its sum plus the next
+// thread's, exchanged through shared memory across a barrier.
+static std::string exchangeKernel() {
+    return "LOAD R0, Mem[0]\n"
+           "LOAD R3, Mem[" + std::to_string(kValues) + "]\n"
+           "MOVI R1, 0\n"
+           "MOVI R2, 1\n"
+           "loop:\n"
+           "SETP.GE P0, R1, R0\n"
+           "@P0 BRA done\n"
+           "ADD R3, R3, R1\n"
+           "ADD R1, R1, R2\n"
+           "BRA loop\n"
+           "done:\n"
+           "STS Shared[0], R3\n"
+           "BAR\n"
+           "LDS R4, Shared[1]\n"
+           "ADD R5, R3, R4\n"
+           "STORE Mem[" + std::to_string(kOutput) + "], R5\n"
+           "HALT\n";
+}
+
+struct Setup {
+    SchedulerPolicy policy;
+    bool timed;
+    int host_workers;
+};
+
+struct Outcome {
+    std::vector<int> image;
+    KernelLaunchResult result;
+};
+
+static void configure(GPUSimulator& simulator, const Setup& setup) {
+    simulator.setWarpScheduler(setup.policy, 1, 2);
+    simulator.setHostWorkerThreads(setup.host_workers);
+    if (setup.timed) {
+        MemoryTimingConfig timing;
+        timing.latency_cycles = 30;
+        timing.cycles_per_transaction = 3;
+        simulator.setMemoryTiming(timing);
+    }
+    std::vector<int> input(2 * kThreads);
+    for (int i = 0; i < kThreads; ++i) {
+        input[i] = (i * 5 + i / 7) % 9;
+        input[kValues + i] = i * 31 - 500;
+    }
+    simulator.getGlobalMemory().copyIn(0, input.data(), input.size());
+}
+
+static Outcome finish(GPUSimulator& simulator, std::future<KernelLaunchResult>& launch) {
+    Outcome outcome;
+    outcome.result = launch.get();
+    outcome.image.resize(kMemoryWords);
+    simulator.getGlobalMemory().copyOut(0, outcome.image.data(), outcome.image.size());
+    return outcome;
+}
+
+static std::unique_ptr<GPUSimulator> makeSimulator() {
+    return std::make_unique<GPUSimulator>(kMemoryWords, 2, 16, 6);
+}
+
+static Outcome runUninterrupted(const KernelProgram& kernel, const Setup& setup) {
+    std::unique_ptr<GPUSimulator> simulator = makeSimulator();
+    configure(*simulator, setup);
+    std::future<KernelLaunchResult> launch = simulator->launchKernelAsync(
+        Stream(), kernel, kBlocks, 1, 1, kBlockThreads, 1, 1, "checkpoint_test");
+    return finish(*simulator, launch);
+}
+
+// Stops the launch at stop_cycle and resumes it in the same simulator.
+static bool runResumed(const KernelProgram& kernel, const Setup& setup, long long stop_cycle, Outcome& outcome) {
+    std::unique_ptr<GPUSimulator> simulator = makeSimulator();
+    configure(*simulator, setup);
+    simulator->setStopCycle(stop_cycle);
+    std::future<KernelLaunchResult> launch = simulator->launchKernelAsync(
+        Stream(), kernel, kBlocks, 1, 1, kBlockThreads, 1, 1, "checkpoint_test");
+    simulator->synchronize();
+    if (!simulator->isStopped() || !simulator->resume()) {
+        std::cout << "  launch did not stop at cycle " << stop_cycle << std::endl;
+        return false;
+    }
+    outcome = finish(*simulator, launch);
+    return true;
+}
+
+// Stops the launch at stop_cycle, checkpoints it and resumes it in a fresh
+// simulator restored from the checkpoint.
+static bool runRestored(const KernelProgram& kernel, const Setup& setup, long long stop_cycle, Outcome& outcome) {
+    {
+        std::unique_ptr<GPUSimulator> simulator = makeSimulator();
+        configure(*simulator, setup);
+        simulator->setStopCycle(stop_cycle);
+        simulator->launchKernelAsync(Stream(), kernel, kBlocks, 1, 1, kBlockThreads, 1, 1, "checkpoint_test");
+        simulator->synchronize();
+        if (!simulator->isStopped() || !simulator->saveCheckpoint(kCheckpointPath)) {
+            std::cout << "  launch did not stop at cycle " << stop_cycle << " and checkpoint" << std::endl;
+            return false;
+        }
+    }
+    std::unique_ptr<GPUSimulator> simulator = makeSimulator();
+    simulator->setHostWorkerThreads(setup.host_workers);
+    std::vector<std::future<KernelLaunchResult>> launches;
+    bool restored = simulator->restoreCheckpoint(kCheckpointPath, &launches);
+    std::remove(kCheckpointPath);
+    if (!restored || launches.size() != 1 || !simulator->resume()) {
+        std::cout << "  checkpoint did not restore the stopped launch" << std::endl;
+        return false;
+    }
+    outcome = finish(*simulator, launches[0]);
+    return true;
+}
+
+static bool compare(const std::string& name, const Outcome& expected, const Outcome& actual) {
+    int mismatches = 0;
+    for (size_t i = 0; i < expected.image.size(); ++i) {
+        if (expected.image[i] != actual.image[i]) {
+            if (mismatches == 0) {
+                std::cout << "  first mismatch at word " << i << ": uninterrupted " << expected.image[i]
+                          << ", resumed " << actual.image[i] << std::endl;
+            }
+            mismatches++;
+        }
+    }
+    bool same_cycles = expected.result.start_cycle == actual.result.start_cycle
+        && expected.result.end_cycle == actual.result.end_cycle;
+    bool passed = mismatches == 0 && same_cycles && actual.result.completed
+        && expected.result.warp_instructions == actual.result.warp_instructions;
+    std::cout << (passed ? "PASS " : "FAIL ") << name;
+    if (mismatches > 0) {
+        std::cout << ": " << mismatches << " differing words";
+    }
+    if (!same_cycles) {
+        std::cout << ": cycles " << actual.result.start_cycle << "-" << actual.result.end_cycle
+                  << ", uninterrupted " << expected.result.start_cycle << "-" << expected.result.end_cycle;
+    }
+    std::cout << std::endl;
+    return passed;
+}
+
+int main() {
+    Log::setLevel(LogLevel::Error);
+
+    KernelProgram kernel;
+    std::string error;
+    if (!KernelAssembler::assemble(exchangeKernel(), kernel, &error)) {
+        std::cout << "FAIL exchange kernel does not assemble: " << error << std::endl;
+        return 1;
+    }
+    const Setup setups[] = {
+        {SchedulerPolicy::LooseRoundRobin, false, 1},
+        {SchedulerPolicy::GreedyThenOldest, false, 1},
+        {SchedulerPolicy::TwoLevel, false, 1},
+        {SchedulerPolicy::LooseRoundRobin, true, 1},
+        {SchedulerPolicy::GreedyThenOldest, true, 1},
+        {SchedulerPolicy::TwoLevel, true, 1},
+        {SchedulerPolicy::GreedyThenOldest, true, 2},
+    };
+
+    int failures = 0;
+    for (const Setup& setup : setups) {
+        Outcome uninterrupted = runUninterrupted(kernel, setup);
+        std::string name = std::string(schedulerPolicyToString(setup.policy)) + (setup.timed ? ", timed" : "")
+            + ", " + std::to_string(setup.host_workers) + " host worker(s), stopped at ";
+        long long cycles = uninterrupted.result.cycles();
+        for (long long stop_cycle : {cycles / 5, cycles / 2, cycles * 4 / 5}) {
+            Outcome resumed;
+            Outcome restored;
+            std::string stopped = name + std::to_string(stop_cycle) + " of " + std::to_string(cycles);
+            if (!runResumed(kernel, setup, stop_cycle, resumed)
+                || !compare(stopped + ", resumed", uninterrupted, resumed)) {
+                failures++;
+            }
+            if (!runRestored(kernel, setup, stop_cycle, restored)
+                || !compare(stopped + ", restored", uninterrupted, restored)) {
+                failures++;
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+// CppGPUSimulator/src/tools/fusion_test.cpp
+// Checks that kernels decoded with superinstruction fusion leave the same
+// global memory image as unfused ones. Each case runs a kernel whose warps
+// read words that neighbouring warps store, once per scheduler policy, with
+// and without memory timing, host workers and sampling, and compares the
+// images word for word. Exits non-zero on any mismatch.
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <string>
+#include <utility>
+
+#include "sim/GPUSimulator.h"
+#include "sim/Log.h"
+#include "arch/Assembler.h"
+
+static constexpr int kBlocks = 6;
+static constexpr int kBlockThreads = 40;
+static constexpr int kMemoryWords = 512;
+
+// Thread t reads words t and t + 1 and stores to t + 1, which thread t + 1
+// reads: a LOAD/LOAD/ADD/STORE superinstruction over data shared between
+// warps.
+static const char* const kNeighbourSum =
+    "LOAD R0, Mem[0]\n"
+    "LOAD R1, Mem[1]\n"
+    "ADD R2, R0, R1\n"
+    "STORE Mem[1], R2\n"
+    "HALT\n";
+
+// An ADD/STORE and a MUL/STORE pair that store over words the preceding
+// thread loads.
+static const char* const kNeighbourScale =
+    "LOAD R0, Mem[1]\n"
+    "MOVI R1, 3\n"
+    "ADD R2, R0, R1\n"
+    "STORE Mem[0], R2\n"
+    "LOAD R3, Mem[2]\n"
+    "MUL R4, R3, R1\n"
+    "STORE Mem[1], R4\n"
+    "HALT\n";
+
+struct Setup {
+    SchedulerPolicy policy;
+    bool timed;
+    int host_workers;
+    int sample_period;
+};
+
+static std::vector<int> runKernel(const KernelProgram& program, const Setup& setup, bool fuse) {
+    GPUSimulator simulator(kMemoryWords, 2, 32, 4);
+    simulator.setWarpScheduler(setup.policy, 1, 2);
+    simulator.setHostWorkerThreads(setup.host_workers);
+    if (setup.timed) {
+        MemoryTimingConfig timing;
+        timing.latency_cycles = 20;
+        timing.cycles_per_transaction = 2;
+        simulator.setMemoryTiming(timing);
+    }
+    if (setup.sample_period > 1) {
+        SamplingConfig sampling;
+        sampling.sample_period = setup.sample_period;
+        sampling.unit_blocks = 1;
+        simulator.setSampling(sampling);
+    }
+    std::vector<int> input(kMemoryWords);
+    for (int i = 0; i < kMemoryWords; ++i) {
+        input[i] = i * 37 - 1000;
+    }
+    simulator.getGlobalMemory().copyIn(0, input.data(), input.size());
+    auto kernel = std::make_shared<const DecodedKernel>(program, GPUSimulator::getRegistersPerThread(), fuse);
+    simulator.launchKernelAsync(Stream(), kernel, kBlocks, 1, 1, kBlockThreads, 1, 1, "fusion_test").get();
+    std::vector<int> image(kMemoryWords);
+    simulator.getGlobalMemory().copyOut(0, image.data(), image.size());
+    return image;
+}
+
+int main() {
+    Log::setLevel(LogLevel::Error);
+
+    const std::pair<const char*, const char*> kernels[] = {
+        {"neighbour sum", kNeighbourSum},
+        {"neighbour scale", kNeighbourScale},
+    };
+    const std::vector<Setup> setups = {
+        {SchedulerPolicy::LooseRoundRobin, false, 1, 0},
+        {SchedulerPolicy::GreedyThenOldest, false, 1, 0},
+        {SchedulerPolicy::TwoLevel, false, 1, 0},
+        {SchedulerPolicy::LooseRoundRobin, true, 1, 0},
+        {SchedulerPolicy::GreedyThenOldest, true, 1, 0},
+        {SchedulerPolicy::TwoLevel, true, 1, 0},
+        {SchedulerPolicy::GreedyThenOldest, true, 2, 0},
+        {SchedulerPolicy::LooseRoundRobin, false, 1, 2},
+    };
+
+    int failures = 0;
+    for (const auto& named : kernels) {
+        KernelProgram program;
+        std::string error;
+        if (!KernelAssembler::assemble(named.second, program, &error)) {
+            std::cout << "FAIL " << named.first << " kernel does not assemble: " << error << std::endl;
+            failures++;
+            continue;
+        }
+        if (DecodedKernel(program, GPUSimulator::getRegistersPerThread()).getNumFused() == 0) {
+            std::cout << "FAIL " << named.first << " kernel has no superinstructions" << std::endl;
+            failures++;
+            continue;
+        }
+        for (const Setup& setup : setups) {
+            std::vector<int> unfused = runKernel(program, setup, false);
+            std::vector<int> fused = runKernel(program, setup, true);
+            int mismatches = 0;
+            for (size_t i = 0; i < unfused.size(); ++i) {
+                if (unfused[i] != fused[i]) {
+                    if (mismatches == 0) {
+                        std::cout << "  first mismatch at word " << i << ": unfused " << unfused[i]
+                                  << ", fused " << fused[i] << std::endl;
+                    }
+                    mismatches++;
+                }
+            }
+            std::cout << (mismatches == 0 ? "PASS " : "FAIL ") << named.first << ", "
+                      << schedulerPolicyToString(setup.policy) << (setup.timed ? ", timed" : "")
+                      << ", " << setup.host_workers << " host worker(s)";
+            if (setup.sample_period > 1) {
+                std::cout << ", sampled 1 in " << setup.sample_period;
+            }
+            if (mismatches > 0) {
+                std::cout << ": " << mismatches << " differing words";
+            }
+            std::cout << std::endl;
+            failures += mismatches > 0 ? 1 : 0;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+// CppGPUSimulator/src/tools/host_parallel_test.cpp
+// Checks that running the ShaderCores on host worker threads leaves the same
+// global memory image as the serial path. Each case launches a kernel on a
+// serial GPUSimulator and on ones with host workers, under every scheduler
+// policy with and without memory timing, and compares the images word for
+// word. Exits non-zero on any mismatch.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <utility>
+
+#include "sim/GPUSimulator.h"
+#include "sim/Log.h"
+#include "arch/Assembler.h"
+
+static constexpr int kBlocks = 512;
+static constexpr int kBlockThreads = 64;
+static constexpr int kThreads = kBlocks * kBlockThreads;
+static constexpr int kBins = 16;
+static constexpr int kValues = kThreads;
+static constexpr int kOutput = 2 * kThreads;
+static constexpr int kCounts = 3 * kThreads;
+static constexpr int kMaxima = kCounts + kBins;
+static constexpr int kMemoryWords = kMaxima + kBins;
+
+// Histogram of the bins in Mem[0 ..], with each bin's largest value from
+// Mem[kValues ..]: every SM updates the same words atomically while reading
+// its inputs and storing a per-thread output.
+static std::string histogramKernel() {
+    return "LOAD R0, Mem[0]\n"
+           "LOAD R2, Mem[" + std::to_string(kValues) + "]\n"
+           "MOVI R1, 1\n"
+           "ATOM.ADD Mem[" + std::to_string(kCounts) + " + R0], R1\n"
+           "ATOM.MAX Mem[" + std::to_string(kMaxima) + " + R0], R2\n"
+           "ADD R3, R0, R2\n"
+           "STORE Mem[" + std::to_string(kOutput) + "], R3\n"
+           "HALT\n";
+}
+
+// Element-wise kernel with no words shared between threads: plain loads
+// and stores, which host workers stage and commit in SM order.
+static std::string elementwiseKernel() {
+    return "LOAD R0, Mem[0]\n"
+           "LOAD R1, Mem[" + std::to_string(kValues) + "]\n"
+           "MUL R2, R0, R1\n"
+           "ADD R2, R2, R1\n"
+           "STORE Mem[" + std::to_string(kOutput) + "], R2\n"
+           "HALT\n";
+}
+
+// Thread t adds word t + 1 of Mem[kValues ..] to word t and stores the sum
+// over word t + 1, which thread t + 1 reads. The last thread of each block
+// reads a word the next block, on another SM, stores to.
+static std::string neighbourSumKernel() {
+    return "LOAD R0, Mem[" + std::to_string(kValues) + "]\n"
+           "LOAD R1, Mem[" + std::to_string(kValues + 1) + "]\n"
+           "ADD R2, R0, R1\n"
+           "STORE Mem[" + std::to_string(kValues + 1) + "], R2\n"
+           "HALT\n";
+}
+
+// Every thread takes a ticket from its bin's counter and stores it: the old
+// values ATOM returns depend on the order in which the SMs update a bin.
+static std::string ticketKernel() {
+    return "LOAD R0, Mem[0]\n"
+           "MOVI R1, 1\n"
+           "ATOM.ADD R2, Mem[" + std::to_string(kCounts) + " + R0], R1\n"
+           "STORE Mem[" + std::to_string(kOutput) + "], R2\n"
+           "HALT\n";
+}
+
+struct Setup {
+    SchedulerPolicy policy;
+    bool timed;
+};
+
+static std::vector<int> runKernel(const KernelProgram& kernel, const Setup& setup, int host_workers) {
+    GPUSimulator simulator(kMemoryWords, 4, 32, 8);
+    simulator.setHostWorkerThreads(host_workers);
+    simulator.setWarpScheduler(setup.policy);
+    if (setup.timed) {
+        MemoryTimingConfig timing;
+        timing.latency_cycles = 40;
+        timing.cycles_per_transaction = 4;
+        simulator.setMemoryTiming(timing);
+    }
+    std::vector<int> bins(kThreads);
+    std::vector<int> values(kThreads);
+    for (int i = 0; i < kThreads; ++i) {
+        bins[i] = (i * 7 + i / 97) % kBins;
+        values[i] = (i * 2654435761u) >> 8;
+    }
+    simulator.getGlobalMemory().copyIn(0, bins.data(), bins.size());
+    simulator.getGlobalMemory().copyIn(kValues, values.data(), values.size());
+    simulator.launchKernel(kernel, kBlocks, 1, 1, kBlockThreads, 1, 1, "host_parallel_test");
+    std::vector<int> image(kMemoryWords);
+    simulator.getGlobalMemory().copyOut(0, image.data(), image.size());
+    return image;
+}
+
+static bool compareImages(const std::string& name, const std::vector<int>& serial, const std::vector<int>& parallel) {
+    int mismatches = 0;
+    for (size_t i = 0; i < serial.size(); ++i) {
+        if (serial[i] != parallel[i]) {
+            if (mismatches == 0) {
+                std::cout << "  first mismatch at word " << i << ": serial " << serial[i]
+                          << ", parallel " << parallel[i] << std::endl;
+            }
+            mismatches++;
+        }
+    }
+    std::cout << (mismatches == 0 ? "PASS " : "FAIL ") << name;
+    if (mismatches > 0) {
+        std::cout << ": " << mismatches << " differing words";
+    }
+    std::cout << std::endl;
+    return mismatches == 0;
+}
+
+int main() {
+    Log::setLevel(LogLevel::Error);
+
+    int failures = 0;
+    const std::pair<const char*, std::string> kernels[] = {
+        {"element-wise", elementwiseKernel()},
+        {"histogram", histogramKernel()},
+        {"neighbour sum", neighbourSumKernel()},
+        {"ticket", ticketKernel()},
+    };
+    const Setup setups[] = {
+        {SchedulerPolicy::LooseRoundRobin, false},
+        {SchedulerPolicy::GreedyThenOldest, false},
+        {SchedulerPolicy::TwoLevel, false},
+        {SchedulerPolicy::LooseRoundRobin, true},
+        {SchedulerPolicy::GreedyThenOldest, true},
+        {SchedulerPolicy::TwoLevel, true},
+    };
+    for (const auto& named : kernels) {
+        KernelProgram kernel;
+        std::string error;
+        if (!KernelAssembler::assemble(named.second, kernel, &error)) {
+            std::cout << "FAIL " << named.first << " kernel does not assemble: " << error << std::endl;
+            failures++;
+            continue;
+        }
+        for (const Setup& setup : setups) {
+            std::vector<int> serial = runKernel(kernel, setup, 1);
+            std::string name = std::string(named.first) + ", " + schedulerPolicyToString(setup.policy)
+                + (setup.timed ? ", timed" : "");
+            for (int workers : {2, 4}) {
+                std::vector<int> parallel = runKernel(kernel, setup, workers);
+                if (!compareImages(name + ", " + std::to_string(workers) + " host workers", serial, parallel)) {
+                    failures++;
+                }
+            }
+            if (named.first == std::string("histogram")) {
+                int counted = 0;
+                for (int b = 0; b < kBins; ++b) {
+                    counted += serial[kCounts + b];
+                }
+                if (counted != kThreads) {
+                    std::cout << "FAIL serial histogram counts " << counted << " of " << kThreads << " threads"
+                              << std::endl;
+                    failures++;
+                }
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// CppGPUSimulator/src/tools/interpreter_bench.cpp
+// Microbenchmark of the warp interpreter. One warp repeatedly runs an
+// ALU-heavy kernel through four paths:
+//   generic  - Warp::executeInstruction(Instruction), decoding every call
+//   decoded  - Warp::step(DecodedKernel), one instruction per call
+//   threaded - Warp::run(DecodedKernel), direct-threaded through the kernel
+//   fused    - Warp::run with the kernel's superinstructions
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <algorithm>
+
+#include "arch/Warp.h"
+#include "arch/DecodedKernel.h"
+#include "memory/GPUMemory.h"
+#include "memory/MemoryPort.h"
+
+static constexpr int kRegisters = 8;
+
+static KernelProgram makeBenchKernel(int alu_ops) {
+    KernelProgram kernel;
+    kernel.emplace_back(OpCode::LOAD, 0, -1, -1, 0);
+    kernel.emplace_back(OpCode::LOAD, 1, -1, -1, 1024);
+    for (int i = 0; i < alu_ops; ++i) {
+        int dest = 2 + i % (kRegisters - 2);
+        if (i % 2 == 0) {
+            kernel.emplace_back(OpCode::ADD, dest, (dest + 1) % kRegisters, 1);
+        } else {
+            kernel.emplace_back(OpCode::MUL, dest, 0, (dest + 3) % kRegisters);
+        }
+    }
+    kernel.emplace_back(OpCode::STORE, -1, kRegisters - 1, -1, 2048);
+    kernel.emplace_back(OpCode::HALT);
+    return kernel;
+}
+
+static double timeIterations(int iterations, const std::function<void()>& body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        body();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    int lanes = 32;
+    int alu_ops = 64;
+    int iterations = 20000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--lanes" && i + 1 < argc) {
+            lanes = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--alu-ops" && i + 1 < argc) {
+            alu_ops = std::max(std::atoi(argv[++i]), 0);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(std::atoi(argv[++i]), 1);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--lanes N] [--alu-ops N] [--iterations N]" << std::endl;
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Log::setLevel(LogLevel::Error);
+    GPUMemory memory(4096);
+    MemoryPort port(memory);
+    KernelProgram kernel = makeBenchKernel(alu_ops);
+    DecodedKernel decoded(kernel, kRegisters, false);
+    DecodedKernel fused(kernel, kRegisters);
+    Warp warp(0, 0, lanes, kRegisters);
+
+    double generic_ns = timeIterations(iterations, [&]() {
+        warp.reset(0, 0, lanes, kRegisters);
+        for (const Instruction& instr : kernel) {
+            warp.executeInstruction(instr, port);
+        }
+    });
+    double decoded_ns = timeIterations(iterations, [&]() {
+        warp.reset(0, 0, lanes, kRegisters);
+        while (warp.step(decoded, port)) {
+        }
+    });
+    double threaded_ns = timeIterations(iterations, [&]() {
+        warp.reset(0, 0, lanes, kRegisters);
+        warp.run(decoded, port);
+    });
+    double fused_ns = timeIterations(iterations, [&]() {
+        warp.reset(0, 0, lanes, kRegisters);
+        warp.run(fused, port);
+    });
+
+    double instructions = static_cast<double>(iterations) * kernel.size();
+    std::cout << "Interpreter benchmark: " << kernel.size() << " instructions x " << iterations
+              << " iterations, " << lanes << " lanes, " << LaneKernels::isaToString(LaneKernels::forWidth(lanes).isa)
+              << " lane kernels" << (LaneKernels::forWidth(lanes).width > 0 ? " (unrolled)" : "")
+              << ", " << fused.getNumFused() << " superinstructions" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  generic:  " << generic_ns / instructions << " ns/warp-instruction" << std::endl;
+    std::cout << "  decoded:  " << decoded_ns / instructions << " ns/warp-instruction ("
+              << generic_ns / decoded_ns << "x)" << std::endl;
+    std::cout << "  threaded: " << threaded_ns / instructions << " ns/warp-instruction ("
+              << generic_ns / threaded_ns << "x)" << std::endl;
+    std::cout << "  fused:    " << fused_ns / instructions << " ns/warp-instruction ("
+              << generic_ns / fused_ns << "x)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,100 @@
+// CppGPUSimulator/src/tools/lane_kernels_test.cpp
+// Checks that the SIMD lane kernels and the scalar fallback leave identical
+// global memory images. Each case runs an ADD/MUL/LOAD/STORE kernel twice,
+// once with LaneKernels::forceScalar(true) and once with the detected ISA,
+// and compares the images word for word. Exits non-zero on any mismatch.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <climits>
+
+#include "sim/GPUSimulator.h"
+#include "sim/Log.h"
+#include "arch/LaneKernels.h"
+
+static constexpr int kInputA = 0;
+static constexpr int kInputB = 1024;
+static constexpr int kSum = 2048;
+static constexpr int kProduct = 3072;
+static constexpr int kMixed = 4096;
+static constexpr int kMemoryWords = 5120;
+
+static KernelProgram makeKernel() {
+    KernelProgram kernel;
+    kernel.emplace_back(OpCode::LOAD, 0, -1, -1, kInputA);
+    kernel.emplace_back(OpCode::LOAD, 1, -1, -1, kInputB);
+    kernel.emplace_back(OpCode::ADD, 2, 0, 1);
+    kernel.emplace_back(OpCode::MUL, 3, 0, 1);
+    kernel.emplace_back(OpCode::STORE, -1, 2, -1, kSum);
+    kernel.emplace_back(OpCode::STORE, -1, 3, -1, kProduct);
+    kernel.emplace_back(OpCode::MUL, 4, 2, 3);
+    kernel.emplace_back(OpCode::ADD, 4, 4, 0);
+    kernel.emplace_back(OpCode::STORE, -1, 4, -1, kMixed);
+    kernel.emplace_back(OpCode::HALT);
+    return kernel;
+}
+
+// Runs the kernel over `threads` threads in blocks of block_threads and
+// returns the whole memory image.
+static std::vector<int> runKernel(int warp_width, int threads, int block_threads, bool scalar) {
+    LaneKernels::forceScalar(scalar);
+    GPUSimulator simulator(kMemoryWords, 2, warp_width, 4);
+    std::vector<int> input_a(threads);
+    std::vector<int> input_b(threads);
+    for (int i = 0; i < threads; ++i) {
+        // Large and negative operands make ADD and MUL wrap around.
+        input_a[i] = i % 3 == 0 ? INT_MAX - i : i * 7919 - 40000;
+        input_b[i] = i % 5 == 0 ? INT_MIN + i : 65537 * (i + 1);
+    }
+    simulator.getGlobalMemory().copyIn(kInputA, input_a.data(), input_a.size());
+    simulator.getGlobalMemory().copyIn(kInputB, input_b.data(), input_b.size());
+    int blocks = (threads + block_threads - 1) / block_threads;
+    simulator.launchKernel(makeKernel(), blocks, 1, 1, block_threads, 1, 1, "lane_kernels_test");
+    std::vector<int> image(kMemoryWords);
+    simulator.getGlobalMemory().copyOut(0, image.data(), image.size());
+    return image;
+}
+
+int main() {
+    Log::setLevel(LogLevel::Error);
+    std::cout << "Detected lane kernels: "
+              << LaneKernels::isaToString(LaneKernels::forWidth(32).isa) << std::endl;
+
+    struct Case {
+        int warp_width;
+        int threads;
+        int block_threads;
+    };
+    // Specialized widths with full warps, a generic width, and blocks whose
+    // last warp is only partially filled (masked lanes).
+    const std::vector<Case> cases = {
+        {4, 1024, 64}, {8, 1024, 64}, {16, 1024, 128}, {32, 1024, 256}, {64, 1024, 256},
+        {12, 960, 96}, {32, 1000, 100}, {64, 999, 111},
+    };
+
+    int failures = 0;
+    for (const Case& c : cases) {
+        std::vector<int> scalar = runKernel(c.warp_width, c.threads, c.block_threads, true);
+        std::vector<int> simd = runKernel(c.warp_width, c.threads, c.block_threads, false);
+        int mismatches = 0;
+        for (size_t i = 0; i < scalar.size(); ++i) {
+            if (scalar[i] != simd[i]) {
+                if (mismatches == 0) {
+                    std::cout << "  first mismatch at word " << i << ": scalar " << scalar[i]
+                              << ", SIMD " << simd[i] << std::endl;
+                }
+                mismatches++;
+            }
+        }
+        std::cout << (mismatches == 0 ? "PASS" : "FAIL") << " warp width " << c.warp_width << ", "
+                  << c.threads << " threads in blocks of " << c.block_threads;
+        if (mismatches > 0) {
+            std::cout << ": " << mismatches << " differing words";
+        }
+        std::cout << std::endl;
+        failures += mismatches > 0 ? 1 : 0;
+    }
+    LaneKernels::forceScalar(false);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// CppGPUSimulator/src/tools/sim_bench.cpp
+// Google Benchmark suite over the simulator's own hot paths:
+//   BM_WarpExecuteInstruction   - Warp::executeInstruction, by warp width and kernel length
+//   BM_GPUMemoryRead/Write      - GPUMemory::read/write, by memory size and access stride
+//   BM_ProfilerLogMemoryOperation - Profiler::logMemoryOperation, by trace capacity
+//   BM_LaunchKernelSetup        - launchKernel on a HALT-only kernel (block/warp setup)
+//   BM_LaunchKernel             - full launches, by grid size, warp width, SM count and kernel length
+// Every benchmark reports sim_instructions_per_second (warp instructions, or
+// memory/profiler operations for the component benchmarks). Track
+// regressions with e.g.
+//   gpu_sim_bench --benchmark_out=bench.json --benchmark_out_format=json
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <future>
+
+#include "arch/Warp.h"
+#include "memory/GPUMemory.h"
+#include "memory/MemoryPort.h"
+#include "sim/GPUSimulator.h"
+#include "sim/Profiler.h"
+#include "sim/Log.h"
+
+static constexpr int kRegisters = 8;
+
+// Input A, input B and output regions used by the benchmark kernels.
+static constexpr int kInputA = 0;
+static constexpr int kInputB = 1 << 18;
+static constexpr int kOutput = 2 << 18;
+static constexpr size_t kLaunchMemoryWords = 3 << 18;
+
+// Two loads, alu_ops dependent ADD/MUL instructions, a store and HALT.
+static KernelProgram makeBenchKernel(int alu_ops) {
+    KernelProgram kernel;
+    kernel.emplace_back(OpCode::LOAD, 0, -1, -1, kInputA);
+    kernel.emplace_back(OpCode::LOAD, 1, -1, -1, kInputB);
+    for (int i = 0; i < alu_ops; ++i) {
+        int dest = 2 + i % (kRegisters - 2);
+        if (i % 2 == 0) {
+            kernel.emplace_back(OpCode::ADD, dest, (dest + 1) % kRegisters, 1);
+        } else {
+            kernel.emplace_back(OpCode::MUL, dest, 0, (dest + 3) % kRegisters);
+        }
+    }
+    kernel.emplace_back(OpCode::STORE, -1, kRegisters - 1, -1, kOutput);
+    kernel.emplace_back(OpCode::HALT);
+    return kernel;
+}
+
+static void reportRate(benchmark::State& state, int64_t operations) {
+    state.SetItemsProcessed(operations);
+    state.counters["sim_instructions_per_second"] =
+        benchmark::Counter(static_cast<double>(operations), benchmark::Counter::kIsRate);
+}
+
+// Args: lanes, ALU instructions in the kernel.
+static void BM_WarpExecuteInstruction(benchmark::State& state) {
+    int lanes = static_cast<int>(state.range(0));
+    KernelProgram kernel = makeBenchKernel(static_cast<int>(state.range(1)));
+    GPUMemory memory(kLaunchMemoryWords);
+    MemoryPort port(memory);
+    Warp warp(0, 0, lanes, kRegisters);
+    int64_t instructions = 0;
+    for (auto _ : state) {
+        warp.reset(0, 0, lanes, kRegisters);
+        for (const Instruction& instr : kernel) {
+            warp.executeInstruction(instr, port);
+        }
+        instructions += static_cast<int64_t>(kernel.size());
+    }
+    reportRate(state, instructions);
+}
+BENCHMARK(BM_WarpExecuteInstruction)->ArgsProduct({{4, 8, 16, 32}, {16, 64, 256}});
+
+// Args: memory size in words, stride between accesses in words. Each
+// iteration makes 4096 accesses walking through the whole memory.
+static constexpr int kMemoryAccessesPerIteration = 4096;
+
+static void BM_GPUMemoryRead(benchmark::State& state) {
+    size_t size = static_cast<size_t>(state.range(0));
+    size_t stride = static_cast<size_t>(state.range(1));
+    GPUMemory memory(size);
+    for (size_t address = 0; address < size; address += stride) {
+        memory.write(static_cast<int>(address), static_cast<int>(address));
+    }
+    size_t address = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < kMemoryAccessesPerIteration; ++i) {
+            benchmark::DoNotOptimize(memory.read(static_cast<int>(address)));
+            address = (address + stride) % size;
+        }
+    }
+    reportRate(state, state.iterations() * kMemoryAccessesPerIteration);
+}
+BENCHMARK(BM_GPUMemoryRead)->ArgsProduct({{1 << 12, 1 << 20, 1 << 24}, {1, 1024}});
+
+static void BM_GPUMemoryWrite(benchmark::State& state) {
+    size_t size = static_cast<size_t>(state.range(0));
+    size_t stride = static_cast<size_t>(state.range(1));
+    GPUMemory memory(size);
+    // Populate the touched pages first so only steady-state writes are timed.
+    for (size_t address = 0; address < size; address += stride) {
+        memory.write(static_cast<int>(address), 1);
+    }
+    size_t address = 0;
+    int value = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < kMemoryAccessesPerIteration; ++i) {
+            memory.write(static_cast<int>(address), ++value);
+            address = (address + stride) % size;
+        }
+    }
+    reportRate(state, state.iterations() * kMemoryAccessesPerIteration);
+}
+BENCHMARK(BM_GPUMemoryWrite)->ArgsProduct({{1 << 12, 1 << 20, 1 << 24}, {1, 1024}});
+
+// Arg: memory trace capacity (0 counts only).
+static void BM_ProfilerLogMemoryOperation(benchmark::State& state) {
+    Profiler profiler;
+    profiler.setMemoryTracing(static_cast<size_t>(state.range(0)));
+    profiler.startProfiling();
+    long long address = 0;
+    for (auto _ : state) {
+        profiler.logMemoryOperation(MemoryOpType::Read, address, sizeof(int));
+        address = (address + 1) & 0xFFFF;
+    }
+    profiler.stopProfiling();
+    reportRate(state, state.iterations());
+}
+BENCHMARK(BM_ProfilerLogMemoryOperation)->Arg(0)->Arg(64)->Arg(4096);
+
+// Launches kernel once per iteration and returns the warp instructions the
+// launches ran. Launches execute on the device thread, so these benchmarks
+// are timed in wall-clock time. Kernel traces are dropped between launches so the profiler
+// does not grow across iterations.
+static int64_t runLaunches(benchmark::State& state, GPUSimulator& simulator, const DecodedKernel& kernel,
+                           int grid_blocks, int block_threads) {
+    int64_t instructions = 0;
+    std::shared_ptr<const DecodedKernel> borrowed(std::shared_ptr<const DecodedKernel>(), &kernel);
+    for (auto _ : state) {
+        KernelLaunchResult result =
+            simulator.launchKernelAsync(Stream(), borrowed, grid_blocks, 1, 1, block_threads, 1, 1).get();
+        instructions += result.warp_instructions;
+        state.PauseTiming();
+        simulator.getProfiler().clear();
+        state.ResumeTiming();
+    }
+    return instructions;
+}
+
+// Args: grid blocks, lanes per warp, SMs. Blocks of two warps run a kernel
+// that halts immediately, so the time is block and warp setup.
+static void BM_LaunchKernelSetup(benchmark::State& state) {
+    int grid_blocks = static_cast<int>(state.range(0));
+    int lanes = static_cast<int>(state.range(1));
+    int num_sms = static_cast<int>(state.range(2));
+    GPUSimulator simulator(kLaunchMemoryWords, num_sms, lanes, 8);
+    KernelProgram program;
+    program.emplace_back(OpCode::HALT);
+    DecodedKernel kernel(program, GPUSimulator::getRegistersPerThread());
+    int64_t instructions = runLaunches(state, simulator, kernel, grid_blocks, 2 * lanes);
+    reportRate(state, instructions);
+    state.counters["warps_per_second"] = benchmark::Counter(
+        static_cast<double>(state.iterations()) * grid_blocks * 2, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_LaunchKernelSetup)
+    ->ArgNames({"blocks", "lanes", "sms"})
+    ->ArgsProduct({{16, 256}, {8, 32}, {1, 4}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// Args: grid blocks, lanes per warp, SMs, ALU instructions in the kernel.
+static void BM_LaunchKernel(benchmark::State& state) {
+    int grid_blocks = static_cast<int>(state.range(0));
+    int lanes = static_cast<int>(state.range(1));
+    int num_sms = static_cast<int>(state.range(2));
+    GPUSimulator simulator(kLaunchMemoryWords, num_sms, lanes, 8);
+    DecodedKernel kernel(makeBenchKernel(static_cast<int>(state.range(3))), GPUSimulator::getRegistersPerThread());
+    int64_t instructions = runLaunches(state, simulator, kernel, grid_blocks, 2 * lanes);
+    reportRate(state, instructions);
+}
+BENCHMARK(BM_LaunchKernel)
+    ->ArgNames({"blocks", "lanes", "sms", "alu_ops"})
+    ->ArgsProduct({{16, 256}, {8, 32}, {1, 4}, {16, 128}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+int main(int argc, char** argv) {
+    Log::setLevel(LogLevel::Error);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,164 @@
+// CppGPUSimulator/src/tools/trace_analyzer.cpp
+// Offline analyzer for memory trace files written by Profiler::openTraceFile().
+// The file is mmapped and scanned once; nothing is copied into memory.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sim/Profiler.h"
+#include "sim/TraceFile.h"
+
+struct SMTraffic {
+    uint64_t records = 0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t first_cycle = UINT64_MAX;
+    uint64_t last_cycle = 0;
+};
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " <trace-file> [--bucket-words N] [--top K]\n"
+              << "  --bucket-words N  Address hot spot granularity in words (default 32).\n"
+              << "  --top K           Number of hot spots to report (default 10)." << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::string path = argv[1];
+    uint64_t bucket_words = 32;
+    size_t top_k = 10;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bucket-words" && i + 1 < argc) {
+            bucket_words = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--top" && i + 1 < argc) {
+            top_k = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open trace file " << path << "." << std::endl;
+        return 1;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(TraceFileHeader)) {
+        std::cerr << "Error: " << path << " is too small to be a trace file." << std::endl;
+        close(fd);
+        return 1;
+    }
+    size_t file_size = static_cast<size_t>(file_stat.st_size);
+    void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: Could not mmap trace file " << path << "." << std::endl;
+        return 1;
+    }
+
+    const auto* header = static_cast<const TraceFileHeader*>(mapping);
+    if (std::memcmp(header->magic, kTraceFileMagic, sizeof(header->magic)) != 0
+        || header->version != kTraceFileVersion || header->record_size != sizeof(TraceRecord)) {
+        std::cerr << "Error: " << path << " is not a version " << kTraceFileVersion << " trace file." << std::endl;
+        munmap(mapping, file_size);
+        return 1;
+    }
+
+    const auto* records = reinterpret_cast<const TraceRecord*>(static_cast<const char*>(mapping) + sizeof(TraceFileHeader));
+    size_t num_records = (file_size - sizeof(TraceFileHeader)) / sizeof(TraceRecord);
+    madvise(mapping, file_size, MADV_SEQUENTIAL);
+
+    uint64_t op_records[kNumMemoryOpTypes] = {};
+    uint64_t op_bytes[kNumMemoryOpTypes] = {};
+    std::map<uint32_t, uint64_t> size_histogram;
+    std::map<uint16_t, SMTraffic> per_sm;
+    std::unordered_map<uint64_t, uint64_t> bucket_accesses;
+
+    for (size_t i = 0; i < num_records; ++i) {
+        const TraceRecord& record = records[i];
+        if (record.op_type >= kNumMemoryOpTypes) {
+            continue;
+        }
+        op_records[record.op_type]++;
+        op_bytes[record.op_type] += record.size_bytes;
+        size_histogram[record.size_bytes]++;
+
+        SMTraffic& sm = per_sm[record.sm_id];
+        sm.records++;
+        if (record.op_type == static_cast<uint8_t>(MemoryOpType::Read)) {
+            sm.bytes_read += record.size_bytes;
+        } else if (record.op_type == static_cast<uint8_t>(MemoryOpType::Write)) {
+            sm.bytes_written += record.size_bytes;
+        }
+        sm.first_cycle = std::min(sm.first_cycle, record.cycle);
+        sm.last_cycle = std::max(sm.last_cycle, record.cycle);
+
+        uint64_t words = std::max<uint64_t>(1, record.size_bytes / sizeof(int));
+        uint64_t first_bucket = record.address / bucket_words;
+        uint64_t last_bucket = (record.address + words - 1) / bucket_words;
+        for (uint64_t bucket = first_bucket; bucket <= last_bucket; ++bucket) {
+            bucket_accesses[bucket]++;
+        }
+    }
+
+    std::cout << "--- Trace " << path << " (" << num_records << " records) ---" << std::endl;
+
+    std::cout << "\nOperations:" << std::endl;
+    for (size_t op = 0; op < kNumMemoryOpTypes; ++op) {
+        if (op_records[op] == 0) {
+            continue;
+        }
+        std::cout << "  " << std::left << std::setw(9) << memoryOpTypeToString(static_cast<MemoryOpType>(op))
+                  << std::right << op_records[op] << " records, " << op_bytes[op] << " bytes" << std::endl;
+    }
+
+    std::cout << "\nAccess size histogram:" << std::endl;
+    for (const auto& entry : size_histogram) {
+        std::cout << "  " << std::setw(8) << entry.first << " bytes: " << entry.second << std::endl;
+    }
+
+    std::cout << "\nPer-SM bandwidth:" << std::endl;
+    for (const auto& entry : per_sm) {
+        const SMTraffic& sm = entry.second;
+        uint64_t cycles = sm.last_cycle - sm.first_cycle + 1;
+        double bytes_per_cycle = static_cast<double>(sm.bytes_read + sm.bytes_written) / static_cast<double>(cycles);
+        std::cout << "  SM " << entry.first << ": " << sm.records << " records, "
+                  << sm.bytes_read << " bytes read, " << sm.bytes_written << " bytes written over "
+                  << cycles << " cycles (" << std::fixed << std::setprecision(2) << bytes_per_cycle
+                  << " bytes/cycle)" << std::defaultfloat << std::endl;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> hot_spots(bucket_accesses.begin(), bucket_accesses.end());
+    size_t shown = std::min(top_k, hot_spots.size());
+    std::partial_sort(hot_spots.begin(), hot_spots.begin() + shown, hot_spots.end(),
+                      [](const auto& a, const auto& b) {
+                          return a.second != b.second ? a.second > b.second : a.first < b.first;
+                      });
+    std::cout << "\nAddress hot spots (" << bucket_words << "-word buckets, top " << shown << "):" << std::endl;
+    for (size_t i = 0; i < shown; ++i) {
+        uint64_t start = hot_spots[i].first * bucket_words;
+        std::cout << "  Mem[" << start << ".." << start + bucket_words - 1 << "]: "
+                  << hot_spots[i].second << " accesses" << std::endl;
+    }
+
+    munmap(mapping, file_size);
+    return 0;
+}